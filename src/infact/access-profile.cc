@@ -0,0 +1,111 @@
+// Copyright 2014, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   * Redistributions of source code must retain the above copyright
+//     notice, this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above
+//     copyright notice, this list of conditions and the following disclaimer
+//     in the documentation and/or other materials provided with the
+//     distribution.
+//   * Neither the name of Google Inc. nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+//
+//
+/// \file
+/// Implementation of the AccessProfile class.
+
+#include <algorithm>
+#include <sstream>
+#include <utility>
+
+#include "access-profile.h"
+
+namespace infact {
+
+using std::istringstream;
+using std::pair;
+
+void
+AccessProfile::Record(const string &varname) {
+  unordered_map<string, Access>::iterator it = accesses_.find(varname);
+  if (it != accesses_.end()) {
+    ++it->second.count;
+    return;
+  }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start_;
+  Access &access = accesses_[varname];
+  access.first_seconds = elapsed.count();
+  access.count = 1;
+}
+
+void
+AccessProfile::Write(ostream &os) const {
+  vector<string> variables = Variables();
+  for (size_t i = 0; i < variables.size(); ++i) {
+    const Access &access = accesses_.find(variables[i])->second;
+    os << variables[i] << " " << access.first_seconds << " " << access.count
+       << "\n";
+  }
+  os.flush();
+}
+
+bool
+AccessProfile::Read(istream &is) {
+  string line;
+  while (getline(is, line)) {
+    if (line.empty()) {
+      continue;
+    }
+    istringstream iss(line);
+    string varname;
+    Access access;
+    if (!(iss >> varname >> access.first_seconds >> access.count)) {
+      return false;
+    }
+    unordered_map<string, Access>::iterator it = accesses_.find(varname);
+    if (it == accesses_.end()) {
+      accesses_[varname] = access;
+    } else {
+      it->second.first_seconds =
+          std::min(it->second.first_seconds, access.first_seconds);
+      it->second.count += access.count;
+    }
+  }
+  return true;
+}
+
+vector<string>
+AccessProfile::Variables() const {
+  vector<pair<double, string> > firsts;
+  for (unordered_map<string, Access>::const_iterator it = accesses_.begin();
+       it != accesses_.end(); ++it) {
+    firsts.push_back(make_pair(it->second.first_seconds, it->first));
+  }
+  std::sort(firsts.begin(), firsts.end());
+  vector<string> variables;
+  for (size_t i = 0; i < firsts.size(); ++i) {
+    variables.push_back(firsts[i].second);
+  }
+  return variables;
+}
+
+}  // namespace infact
@@ -0,0 +1,103 @@
+// Copyright 2014, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   * Redistributions of source code must retain the above copyright
+//     notice, this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above
+//     copyright notice, this list of conditions and the following disclaimer
+//     in the documentation and/or other materials provided with the
+//     distribution.
+//   * Neither the name of Google Inc. nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+//
+//
+/// \file
+/// Provides the \link infact::AccessProfile AccessProfile \endlink
+/// class, which records when each variable of an \link
+/// infact::Interpreter Interpreter \endlink is first read, so that a
+/// later run may build the variables read soonest before any others.
+
+#ifndef INFACT_ACCESS_PROFILE_H_
+#define INFACT_ACCESS_PROFILE_H_
+
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace infact {
+
+using std::istream;
+using std::ostream;
+using std::string;
+using std::unordered_map;
+using std::vector;
+
+/// A record of the variables read through \link
+/// infact::Interpreter::Get Interpreter::Get\endlink, with the time of
+/// each variable&rsquo;s first read, relative to the construction of
+/// the profile, and its number of reads.
+///
+/// A profile is written as text, one variable per line, with the
+/// variable&rsquo;s name, the time of its first read in seconds and
+/// its number of reads separated by spaces.
+class AccessProfile {
+ public:
+  /// Constructs an empty profile whose clock starts now.
+  AccessProfile() : start_(std::chrono::steady_clock::now()) { }
+
+  /// Records a read of the specified variable.
+  void Record(const string &varname);
+
+  /// Writes this profile to the specified stream.
+  void Write(ostream &os) const;
+
+  /// Reads a profile written by \link Write \endlink from the specified
+  /// stream, merging it into this one.
+  ///
+  /// \return whether the stream held a well-formed profile
+  bool Read(istream &is);
+
+  /// Returns the names of all recorded variables in order of their
+  /// first reads.
+  vector<string> Variables() const;
+
+  /// Returns the number of recorded variables.
+  size_t size() const { return accesses_.size(); }
+
+ private:
+  /// The record of reads of a single variable.
+  struct Access {
+    /// The time of the first read, in seconds.
+    double first_seconds;
+    /// The number of reads.
+    size_t count;
+  };
+
+  std::chrono::steady_clock::time_point start_;
+  unordered_map<string, Access> accesses_;
+};
+
+}  // namespace infact
+
+#endif
@@ -0,0 +1,123 @@
+// Copyright 2014, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   * Redistributions of source code must retain the above copyright
+//     notice, this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above
+//     copyright notice, this list of conditions and the following disclaimer
+//     in the documentation and/or other materials provided with the
+//     distribution.
+//   * Neither the name of Google Inc. nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+//
+//
+/// \file
+/// Replacements for the global allocation functions that maintain the
+/// counts reported by \link infact::AllocationCounter AllocationCounter
+/// \endlink.  Only programs that measure allocations should link in
+/// this file.
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "alloc-counter.h"
+
+namespace {
+
+std::atomic<size_t> num_allocations(0);
+std::atomic<size_t> num_bytes(0);
+std::atomic<size_t> num_deallocations(0);
+
+void *CountedAllocate(size_t size) {
+  num_allocations.fetch_add(1, std::memory_order_relaxed);
+  num_bytes.fetch_add(size, std::memory_order_relaxed);
+  return malloc(size == 0 ? 1 : size);
+}
+
+void CountedFree(void *ptr) {
+  if (ptr != nullptr) {
+    num_deallocations.fetch_add(1, std::memory_order_relaxed);
+    free(ptr);
+  }
+}
+
+}  // namespace
+
+namespace infact {
+
+size_t AllocationCounter::allocations() {
+  return num_allocations.load(std::memory_order_relaxed);
+}
+
+size_t AllocationCounter::bytes() {
+  return num_bytes.load(std::memory_order_relaxed);
+}
+
+size_t AllocationCounter::deallocations() {
+  return num_deallocations.load(std::memory_order_relaxed);
+}
+
+}  // namespace infact
+
+void *operator new(size_t size) {
+  void *ptr = CountedAllocate(size);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void *operator new[](size_t size) {
+  return operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+  return CountedAllocate(size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+  return CountedAllocate(size);
+}
+
+void operator delete(void *ptr) noexcept {
+  CountedFree(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+  CountedFree(ptr);
+}
+
+void operator delete(void *ptr, const std::nothrow_t &) noexcept {
+  CountedFree(ptr);
+}
+
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept {
+  CountedFree(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+  CountedFree(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept {
+  CountedFree(ptr);
+}
@@ -0,0 +1,90 @@
+// Copyright 2014, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   * Redistributions of source code must retain the above copyright
+//     notice, this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above
+//     copyright notice, this list of conditions and the following disclaimer
+//     in the documentation and/or other materials provided with the
+//     distribution.
+//   * Neither the name of Google Inc. nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+//
+//
+/// \file
+/// Provides counts of heap allocations, for use by benchmarks and tests.
+/// A program obtains these counts by linking in alloc-counter.cc, which
+/// replaces the global <tt>operator new</tt> and <tt>operator delete</tt>
+/// with versions that count each call before deferring to
+/// <tt>malloc</tt> and <tt>free</tt>.
+
+#ifndef INFACT_ALLOC_COUNTER_H_
+#define INFACT_ALLOC_COUNTER_H_
+
+#include <cstddef>
+
+namespace infact {
+
+/// Provides the process-wide counts of heap allocations made through
+/// the global <tt>operator new</tt> since the program started.
+class AllocationCounter {
+ public:
+  /// Returns the number of allocations made so far.
+  static size_t allocations();
+  /// Returns the total number of bytes requested by all allocations made
+  /// so far.
+  static size_t bytes();
+  /// Returns the number of deallocations made so far.
+  static size_t deallocations();
+};
+
+/// Measures the heap allocations made between construction of an
+/// instance and each invocation of its accessors, for example:
+/// \code
+/// AllocationScope scope;
+/// Environment *env = new EnvironmentImpl();
+/// cout << scope.allocations() << " allocations" << endl;
+/// \endcode
+class AllocationScope {
+ public:
+  /// Starts measuring allocations.
+  AllocationScope() :
+      start_allocations_(AllocationCounter::allocations()),
+      start_bytes_(AllocationCounter::bytes()) { }
+
+  /// Returns the number of allocations made since construction.
+  size_t allocations() const {
+    return AllocationCounter::allocations() - start_allocations_;
+  }
+
+  /// Returns the number of bytes requested since construction.
+  size_t bytes() const {
+    return AllocationCounter::bytes() - start_bytes_;
+  }
+
+ private:
+  size_t start_allocations_;
+  size_t start_bytes_;
+};
+
+}  // namespace infact
+
+#endif
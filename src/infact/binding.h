@@ -0,0 +1,228 @@
+// Copyright 2014, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   * Redistributions of source code must retain the above copyright
+//     notice, this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above
+//     copyright notice, this list of conditions and the following disclaimer
+//     in the documentation and/or other materials provided with the
+//     distribution.
+//   * Neither the name of Google Inc. nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+//
+//
+/// \file
+/// Provides the \link infact::Binding Binding \endlink class, which
+/// maps the fields of a plain C++ struct to variables of an \link
+/// infact::EnvironmentImpl EnvironmentImpl\endlink, so that code on a
+/// hot path can read its configuration from the struct&rsquo;s fields
+/// rather than looking up each variable by name.
+
+#ifndef INFACT_BINDING_H_
+#define INFACT_BINDING_H_
+
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "environment-impl.h"
+#include "error.h"
+#include "factory.h"
+
+namespace infact {
+
+using std::ostringstream;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+/// A mapping from the fields of a struct of type <tt>S</tt> to the
+/// names of variables, for example:
+/// \code
+/// struct HandlerConfig {
+///   int timeout_ms;
+///   string backend;
+///   vector<double> weights;
+/// };
+///
+/// Binding<HandlerConfig> binding;
+/// binding.Add("timeout_ms", &HandlerConfig::timeout_ms)
+///        .Add("backend", &HandlerConfig::backend)
+///        .Add("weights", &HandlerConfig::weights, false);
+///
+/// HandlerConfig config;
+/// binding.Bind(interpreter.env(), &config);
+/// \endcode
+/// The \link Bind \endlink method checks every mapping against the
+/// environment once, resolving each to a pointer to the variable&rsquo;s
+/// value, and fills in the struct.  Thereafter, \link Refresh \endlink
+/// fills in a struct from those pointers without any hash lookups or
+/// <tt>dynamic_cast</tt>s, picking up any values assigned to the
+/// variables since.
+///
+/// The environment must outlive the binding.  Whenever variables have
+/// been defined, erased or assigned values of different types since the
+/// fields were last resolved, \link Refresh \endlink resolves them
+/// again, so that an optional variable defined after \link Bind
+/// \endlink is picked up, and a variable now of a type other than that
+/// of its field is an error rather than a stale value.
+///
+/// \tparam S the type of struct whose fields are bound
+template <typename S>
+class Binding {
+ public:
+  /// Constructs an empty binding.
+  Binding() : env_(nullptr), layout_version_(0), bound_(false) { }
+
+  /// Maps the specified field to the variable with the specified name.
+  ///
+  /// \tparam T the type of the field, which must be the type of the
+  ///           variable
+  ///
+  /// \param varname  the name of the variable
+  /// \param field    a pointer to the field of <tt>S</tt>
+  /// \param required whether it is an error for the variable to be
+  ///                 undefined; if the variable of an optional field is
+  ///                 undefined, that field is left unchanged
+  /// \return this binding, so that calls may be chained
+  template <typename T>
+  Binding &Add(const string &varname, T S::*field, bool required = true) {
+    slots_.push_back(unique_ptr<Slot>(new TypedSlot<T>(varname, field,
+                                                       required)));
+    bound_ = false;
+    return *this;
+  }
+
+  /// Resolves each field to the value of its variable in the specified
+  /// environment and sets the fields of the specified struct to those
+  /// values.  It is an error if a required variable is undefined or if
+  /// any defined variable is not of the type of its field.
+  ///
+  /// \param env    the environment holding the variables
+  /// \param config the struct whose fields are to be set
+  void Bind(const EnvironmentImpl *env, S *config) {
+    bound_ = false;
+    env_ = env;
+    Resolve();
+    bound_ = true;
+    Refresh(config);
+  }
+
+  /// Sets the fields of the specified struct to the current values of
+  /// their variables in the environment given to the most recent
+  /// invocation of \link Bind\endlink.  The fields are first resolved
+  /// again if the variables of that environment have been defined,
+  /// erased or retyped since they were last resolved, with the same
+  /// errors as \link Bind\endlink.
+  ///
+  /// \param config the struct whose fields are to be set
+  void Refresh(S *config) const {
+    if (!bound_) {
+      Error("Binding: error: Refresh called before Bind");
+    }
+    if (env_->layout_version() != layout_version_) {
+      Resolve();
+    }
+    for (typename vector<unique_ptr<Slot> >::const_iterator it =
+             slots_.begin();
+         it != slots_.end(); ++it) {
+      (*it)->Fill(config);
+    }
+  }
+
+  /// Returns the number of fields in this binding.
+  size_t size() const { return slots_.size(); }
+
+ private:
+  /// Resolves every field in the bound environment, recording the
+  /// environment&rsquo;s layout version at the time.
+  void Resolve() const {
+    for (typename vector<unique_ptr<Slot> >::const_iterator it =
+             slots_.begin();
+         it != slots_.end(); ++it) {
+      (*it)->Resolve(env_);
+    }
+    layout_version_ = env_->layout_version();
+  }
+
+  /// The mapping of a single field to its variable.
+  class Slot {
+   public:
+    virtual ~Slot() { }
+    /// Resolves the variable of this slot in the specified environment.
+    virtual void Resolve(const EnvironmentImpl *env) = 0;
+    /// Sets the field of this slot to the value of its variable.
+    virtual void Fill(S *config) const = 0;
+  };
+
+  /// The mapping of a field of type <tt>T</tt> to its variable.
+  template <typename T>
+  class TypedSlot : public Slot {
+   public:
+    TypedSlot(const string &varname, T S::*field, bool required) :
+        varname_(varname), field_(field), required_(required),
+        value_(nullptr) { }
+
+    virtual void Resolve(const EnvironmentImpl *env) {
+      value_ = env->Find<T>(varname_);
+      if (value_ != nullptr) {
+        return;
+      }
+      if (env->Defined(varname_)) {
+        ostringstream err_ss;
+        err_ss << "Binding: error: variable " << varname_ << " is of type "
+               << env->GetType(varname_) << " but field is of type "
+               << TypeName<T>().ToString();
+        Error(err_ss.str());
+      } else if (required_) {
+        ostringstream err_ss;
+        err_ss << "Binding: error: no value for required variable "
+               << varname_;
+        Error(err_ss.str());
+      }
+    }
+
+    virtual void Fill(S *config) const {
+      if (value_ != nullptr) {
+        config->*field_ = *value_;
+      }
+    }
+
+   private:
+    string varname_;
+    T S::*field_;
+    bool required_;
+    /// The value of the variable, or <tt>nullptr</tt> if it is undefined.
+    const T *value_;
+  };
+
+  vector<unique_ptr<Slot> > slots_;
+  const EnvironmentImpl *env_;
+  /// The layout version of the environment when the fields were last
+  /// resolved.
+  mutable size_t layout_version_;
+  bool bound_;
+};
+
+}  // namespace infact
+
+#endif
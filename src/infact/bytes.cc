@@ -0,0 +1,224 @@
+// Copyright 2014, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   * Redistributions of source code must retain the above copyright
+//     notice, this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above
+//     copyright notice, this list of conditions and the following disclaimer
+//     in the documentation and/or other materials provided with the
+//     distribution.
+//   * Neither the name of Google Inc. nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+//
+//
+/// \file
+/// Implementation of the \link infact::Bytes Bytes \endlink class and of
+/// base64 encoding and decoding.
+
+#include <cstring>
+
+#include "bytes.h"
+#include "error.h"
+
+namespace infact {
+
+namespace {
+
+const char kBase64Alphabet[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// Values in the decoding table other than the 64 sextets.
+const uint8_t kInvalid = 0xff;
+const uint8_t kSpace = 0xfe;
+const uint8_t kPad = 0xfd;
+
+// A table mapping each byte value to its six-bit value in the base64
+// alphabet, or to one of the three special values above.
+struct DecodingTable {
+  DecodingTable() {
+    memset(value, kInvalid, sizeof(value));
+    for (uint8_t i = 0; i < 64; ++i) {
+      value[static_cast<uint8_t>(kBase64Alphabet[i])] = i;
+    }
+    value[static_cast<uint8_t>(' ')] = kSpace;
+    value[static_cast<uint8_t>('\t')] = kSpace;
+    value[static_cast<uint8_t>('\n')] = kSpace;
+    value[static_cast<uint8_t>('\r')] = kSpace;
+    value[static_cast<uint8_t>('=')] = kPad;
+  }
+  uint8_t value[256];
+};
+
+// Returns the decoding table, constructing it upon first use.
+const uint8_t *DecodingTableValues() {
+  static const DecodingTable table;
+  return table.value;
+}
+
+// Returns the mask of the bits of the final character of base64 text
+// that are not part of any byte, given the number of characters of the
+// final quantum before padding, which must be two or three.
+inline uint32_t UnusedBitsMask(size_t num_chars) {
+  return num_chars == 2 ? 0xf : 0x3;
+}
+
+}  // namespace
+
+bool
+Bytes::operator==(const Bytes &other) const {
+  return size_ == other.size_ &&
+      (size_ == 0 || memcmp(data_.get(), other.data_.get(), size_) == 0);
+}
+
+void
+Bytes::Reserve(size_t capacity) {
+  if (capacity <= capacity_) {
+    return;
+  }
+  void *buffer = nullptr;
+  if (posix_memalign(&buffer, kAlignment, capacity) != 0) {
+    Error("Bytes: error: could not allocate aligned buffer");
+  }
+  if (size_ > 0) {
+    memcpy(buffer, data_.get(), size_);
+  }
+  data_.reset(static_cast<uint8_t *>(buffer), free);
+  capacity_ = capacity;
+}
+
+size_t
+Base64Decoder::Decode(const char *text, size_t length) {
+  const uint8_t *in = reinterpret_cast<const uint8_t *>(text);
+  // Every four characters yield at most three bytes, so reserve once
+  // for the whole piece and write through a raw pointer.
+  size_t start_size = bytes_.size();
+  uint8_t *out = bytes_.Grow(length / 4 * 3 + 3);
+  uint8_t *out_start = out;
+  const uint8_t *table = DecodingTableValues();
+  size_t i = 0;
+
+  // Fast path: whole quanta of four valid characters, which is all
+  // there is in the body of an unbroken base64 literal.
+  if (num_chars_ % 4 == 0 && num_padding_ == 0) {
+    while (i + 4 <= length) {
+      uint8_t a = table[in[i]];
+      uint8_t b = table[in[i + 1]];
+      uint8_t c = table[in[i + 2]];
+      uint8_t d = table[in[i + 3]];
+      if ((a | b | c | d) & 0xc0) {
+        break;
+      }
+      uint32_t quantum = (a << 18) | (b << 12) | (c << 6) | d;
+      out[0] = static_cast<uint8_t>(quantum >> 16);
+      out[1] = static_cast<uint8_t>(quantum >> 8);
+      out[2] = static_cast<uint8_t>(quantum);
+      out += 3;
+      i += 4;
+      num_chars_ += 4;
+    }
+  }
+
+  // Slow path: whitespace, padding and quanta split across pieces.
+  for (; i < length; ++i) {
+    uint8_t value = table[in[i]];
+    if (value == kSpace) {
+      continue;
+    }
+    if (value == kInvalid || (value != kPad && num_padding_ > 0) ||
+        (value == kPad && num_chars_ % 4 < 2)) {
+      break;
+    }
+    if (value == kPad) {
+      // Bits left over after the final byte must be zero, so that each
+      // blob has just one encoding.
+      if (num_padding_ == 0 &&
+          (bits_ & UnusedBitsMask(num_chars_ % 4)) != 0) {
+        break;
+      }
+      ++num_padding_;
+      value = 0;
+    }
+    bits_ = (bits_ << 6) | value;
+    if (++num_chars_ % 4 == 0) {
+      size_t num_bytes = 3 - num_padding_;
+      for (size_t j = 0; j < num_bytes; ++j) {
+        *out++ = static_cast<uint8_t>(bits_ >> (16 - 8 * j));
+      }
+      bits_ = 0;
+    }
+  }
+  bytes_.Truncate(start_size + (out - out_start));
+  return i;
+}
+
+bool
+Base64Decoder::Finish(Bytes *bytes) {
+  size_t remainder = num_chars_ % 4;
+  if (remainder == 1) {
+    return false;
+  }
+  if (remainder > 1) {
+    // Unpadded input: the final two or three characters hold one or
+    // two bytes.
+    if (num_padding_ > 0 || (bits_ & UnusedBitsMask(remainder)) != 0) {
+      return false;
+    }
+    uint32_t bits = bits_ << (6 * (4 - remainder));
+    uint8_t *out = bytes_.Grow(remainder - 1);
+    for (size_t j = 0; j < remainder - 1; ++j) {
+      out[j] = static_cast<uint8_t>(bits >> (16 - 8 * j));
+    }
+  }
+  *bytes = bytes_;
+  bytes_ = Bytes();
+  bits_ = 0;
+  num_chars_ = 0;
+  num_padding_ = 0;
+  return true;
+}
+
+string
+Base64Encode(const Bytes &bytes) {
+  string encoded;
+  encoded.reserve((bytes.size() + 2) / 3 * 4);
+  size_t i = 0;
+  for (; i + 3 <= bytes.size(); i += 3) {
+    uint32_t quantum = (bytes[i] << 16) | (bytes[i + 1] << 8) | bytes[i + 2];
+    encoded += kBase64Alphabet[(quantum >> 18) & 0x3f];
+    encoded += kBase64Alphabet[(quantum >> 12) & 0x3f];
+    encoded += kBase64Alphabet[(quantum >> 6) & 0x3f];
+    encoded += kBase64Alphabet[quantum & 0x3f];
+  }
+  size_t remainder = bytes.size() - i;
+  if (remainder > 0) {
+    uint32_t quantum = bytes[i] << 16;
+    if (remainder == 2) {
+      quantum |= bytes[i + 1] << 8;
+    }
+    encoded += kBase64Alphabet[(quantum >> 18) & 0x3f];
+    encoded += kBase64Alphabet[(quantum >> 12) & 0x3f];
+    encoded += remainder == 2 ? kBase64Alphabet[(quantum >> 6) & 0x3f] : '=';
+    encoded += '=';
+  }
+  return encoded;
+}
+
+}  // namespace infact
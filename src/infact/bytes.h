@@ -0,0 +1,161 @@
+// Copyright 2014, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   * Redistributions of source code must retain the above copyright
+//     notice, this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above
+//     copyright notice, this list of conditions and the following disclaimer
+//     in the documentation and/or other materials provided with the
+//     distribution.
+//   * Neither the name of Google Inc. nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+//
+//
+/// \file
+/// Provides the \link infact::Bytes Bytes \endlink class, an immutable
+/// binary blob, and a base64 decoder that fills one incrementally.
+
+#ifndef INFACT_BYTES_H_
+#define INFACT_BYTES_H_
+
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+namespace infact {
+
+using std::shared_ptr;
+using std::string;
+
+/// A contiguous sequence of bytes, held in a buffer aligned to \link
+/// kAlignment \endlink bytes so that it may be reinterpreted directly
+/// as, say, an array of floats.
+///
+/// As with \link infact::Tensor Tensor \endlink, copies share the same
+/// buffer, so a blob should be treated as immutable once it has been
+/// built.
+class Bytes {
+ public:
+  /// The alignment, in bytes, of the buffer.
+  static const size_t kAlignment = 64;
+
+  /// Constructs an empty blob.
+  Bytes() : size_(0), capacity_(0) { }
+
+  /// Returns the number of bytes in this blob.
+  size_t size() const { return size_; }
+
+  /// Returns whether this blob is empty.
+  bool empty() const { return size_ == 0; }
+
+  /// Returns the number of bytes allocated for the buffer of this blob.
+  size_t capacity() const { return capacity_; }
+
+  /// Returns a pointer to the first byte, or <tt>nullptr</tt> if this
+  /// blob has never held any bytes.
+  const uint8_t *data() const { return data_.get(); }
+
+  /// Returns the byte at the specified offset.
+  uint8_t operator[](size_t i) const { return data_.get()[i]; }
+
+  /// Returns a pointer to the first byte of this blob.
+  const uint8_t *begin() const { return data_.get(); }
+
+  /// Returns a pointer just past the last byte of this blob.
+  const uint8_t *end() const { return data_.get() + size_; }
+
+  /// Returns whether this blob holds the same bytes as the specified one.
+  bool operator==(const Bytes &other) const;
+
+  bool operator!=(const Bytes &other) const { return !(*this == other); }
+
+  /// Ensures the buffer of this blob can hold at least the specified
+  /// number of bytes without reallocation.  Like \link Grow \endlink,
+  /// this method is intended only for use while building a blob.
+  void Reserve(size_t capacity);
+
+  /// Extends this blob by the specified number of bytes, growing its
+  /// buffer geometrically as needed, and returns a pointer to the
+  /// first of the new, uninitialized bytes.
+  uint8_t *Grow(size_t num_bytes) {
+    if (size_ + num_bytes > capacity_) {
+      size_t capacity = capacity_ == 0 ? 64 : 2 * capacity_;
+      Reserve(capacity < size_ + num_bytes ? size_ + num_bytes : capacity);
+    }
+    uint8_t *start = data_.get() + size_;
+    size_ += num_bytes;
+    return start;
+  }
+
+  /// Shrinks this blob to the specified number of bytes.
+  void Truncate(size_t size) {
+    if (size < size_) {
+      size_ = size;
+    }
+  }
+
+ private:
+  size_t size_;
+  size_t capacity_;
+  shared_ptr<uint8_t> data_;
+};
+
+/// Decodes base64 text (RFC 4648, with optional <tt>'='</tt> padding)
+/// into a \link Bytes \endlink buffer.  Text may be supplied in
+/// arbitrarily sized pieces, so that a caller can decode straight from
+/// a stream without first assembling the whole text; whitespace within
+/// the text is ignored.
+class Base64Decoder {
+ public:
+  /// Constructs a decoder whose output is an empty blob.
+  Base64Decoder() : bits_(0), num_chars_(0), num_padding_(0) { }
+
+  /// Decodes the specified piece of base64 text.
+  ///
+  /// \param text   the text to decode
+  /// \param length the number of characters of <tt>text</tt> to decode
+  /// \return the offset of the first invalid character in
+  ///         <tt>text</tt>, or <tt>length</tt> if all were valid; padding
+  ///         is invalid if the character before it has bits set that
+  ///         are not part of any byte
+  size_t Decode(const char *text, size_t length);
+
+  /// Completes decoding, returning whether the text seen so far was a
+  /// whole number of base64 quanta, or unpadded text whose final
+  /// character has no bits set that are not part of any byte.
+  ///
+  /// \param[out] bytes the decoded blob
+  bool Finish(Bytes *bytes);
+
+ private:
+  Bytes bytes_;
+  uint32_t bits_;
+  size_t num_chars_;
+  size_t num_padding_;
+};
+
+/// Returns the base64 encoding of the specified blob, with padding.
+string Base64Encode(const Bytes &bytes);
+
+}  // namespace infact
+
+#endif
@@ -0,0 +1,206 @@
+// Copyright 2014, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   * Redistributions of source code must retain the above copyright
+//     notice, this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above
+//     copyright notice, this list of conditions and the following disclaimer
+//     in the documentation and/or other materials provided with the
+//     distribution.
+//   * Neither the name of Google Inc. nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+//
+//
+/// \file
+/// Test driver that checks the asymptotic complexity of evaluating
+/// specifications.  Each workload is evaluated at sizes
+/// <i>n</i>, 2<i>n</i>, 4<i>n</i> and 8<i>n</i> along one dimension (input
+/// length, number of variables, vector length or nesting depth), and
+/// the driver fails if the number of heap allocations, or the number of
+/// bytes they request, grows faster than <i>n</i> log <i>n</i>.  Counting
+/// allocations rather than timing evaluation makes the test
+/// deterministic, so that an accidentally quadratic change fails here
+/// rather than surfacing as a slow configuration in production.
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "alloc-counter.h"
+#include "example.h"
+#include "interpreter.h"
+
+using namespace std;
+using namespace infact;
+
+/// The factor by which a count may exceed the <i>n</i> log <i>n</i>
+/// envelope before a workload fails, to absorb the rounding of
+/// container growth policies.
+const double kSlack = 1.1;
+
+/// Returns a spec assigning a newly constructed object to the same
+/// variable <tt>n</tt> times, so that only the input length grows.
+string
+RepeatedAssignments(size_t n) {
+  ostringstream oss;
+  for (size_t i = 0; i < n; ++i) {
+    oss << "p = PersonImpl(name(\"Fred\"), cm_height(" << i << "), "
+        << "birthday(DateImpl(year(1970), month(11), day(5))));\n";
+  }
+  return oss.str();
+}
+
+/// Returns a spec defining <tt>n</tt> distinct object variables.
+string
+ManyVariables(size_t n) {
+  ostringstream oss;
+  for (size_t i = 0; i < n; ++i) {
+    oss << "c" << i << " = Cow(name(\"c" << i << "\"), age(" << i << "));\n";
+  }
+  return oss.str();
+}
+
+/// Returns a spec defining a vector of <tt>n</tt> objects.
+string
+ObjectVector(size_t n) {
+  ostringstream oss;
+  oss << "Animal[] herd = {";
+  for (size_t i = 0; i < n; ++i) {
+    oss << (i > 0 ? ", " : "") << "Cow(name(\"c" << i << "\"))";
+  }
+  oss << "};\n";
+  return oss.str();
+}
+
+/// Returns a spec defining a vector of <tt>n</tt> integer literals.
+string
+IntVector(size_t n) {
+  ostringstream oss;
+  oss << "int[] v = {";
+  for (size_t i = 0; i < n; ++i) {
+    oss << (i > 0 ? ", " : "") << i;
+  }
+  oss << "};\n";
+  return oss.str();
+}
+
+/// Returns a spec defining an object nested <tt>n</tt> levels deep.
+string
+NestedObjects(size_t n) {
+  ostringstream oss;
+  oss << "c = ";
+  for (size_t i = 0; i < n; ++i) {
+    oss << "Cow(name(\"c" << i << "\"), calf(";
+  }
+  oss << "nullptr";
+  for (size_t i = 0; i < n; ++i) {
+    oss << "))";
+  }
+  oss << ";\n";
+  return oss.str();
+}
+
+/// A family of specs that grow along a single dimension.
+struct Workload {
+  /// The name of the workload.
+  const char *name;
+  /// The smallest size at which the workload is evaluated.
+  size_t size;
+  /// Whether the number of bytes allocated, and not just the number of
+  /// allocations, must stay within the envelope.
+  bool check_bytes;
+  /// Returns the spec of the workload at the specified size.
+  string (*spec)(size_t n);
+};
+
+/// Evaluates the specified spec in a new interpreter, reporting the
+/// number of allocations made and the bytes they requested.
+void
+Measure(const string &spec, size_t *allocations, size_t *bytes) {
+  Interpreter interpreter;
+  AllocationScope scope;
+  interpreter.EvalString(spec);
+  *allocations = scope.allocations();
+  *bytes = scope.bytes();
+}
+
+/// Returns whether a count growing from <tt>count</tt> at size
+/// <tt>n</tt> to <tt>next_count</tt> at size 2<tt>n</tt> stays within
+/// the <i>n</i> log <i>n</i> envelope, reporting the outcome to
+/// <tt>cerr</tt>.
+bool
+CheckGrowth(const string &name, const string &counter, size_t n,
+            size_t count, size_t next_count) {
+  // An n log n count grows by a factor of 2 log(2n) / log(n) when n
+  // doubles, whereas a quadratic one grows by a factor of 4.
+  double envelope = 2.0 * log2(2.0 * n) / log2(static_cast<double>(n));
+  double ratio = static_cast<double>(next_count) / count;
+  bool ok = ratio <= envelope * kSlack;
+  cerr << (ok ? "PASS" : "FAIL") << " " << name << " " << counter
+       << " n=" << n << ": " << count << " -> " << next_count
+       << " (ratio " << ratio << ", envelope " << envelope << ")" << endl;
+  return ok;
+}
+
+/// Evaluates the specified workload at four successive doublings of
+/// its size and checks the growth of its counts between each.
+///
+/// \return whether the workload stayed within the envelope
+bool
+TestWorkload(const Workload &workload) {
+  bool ok = true;
+  size_t n = workload.size;
+  size_t allocations, bytes;
+  Measure(workload.spec(n), &allocations, &bytes);
+  for (int i = 0; i < 3; ++i, n *= 2) {
+    size_t next_allocations, next_bytes;
+    Measure(workload.spec(2 * n), &next_allocations, &next_bytes);
+    ok &= CheckGrowth(workload.name, "allocations", n,
+                      allocations, next_allocations);
+    if (workload.check_bytes) {
+      ok &= CheckGrowth(workload.name, "bytes", n, bytes, next_bytes);
+    }
+    allocations = next_allocations;
+    bytes = next_bytes;
+  }
+  return ok;
+}
+
+int
+main(int argc, char **argv) {
+  // The bytes allocated for nested objects grow quadratically with
+  // depth, since each object's PostInit method receives its own spec,
+  // which contains the specs of all the objects nested within it.
+  const Workload workloads[] = {
+    { "input-length", 100, true, RepeatedAssignments },
+    { "num-variables", 100, true, ManyVariables },
+    { "object-vector-length", 100, true, ObjectVector },
+    { "int-vector-length", 1000, true, IntVector },
+    { "nesting-depth", 25, false, NestedObjects },
+  };
+  bool ok = true;
+  for (size_t i = 0; i < sizeof(workloads) / sizeof(workloads[0]); ++i) {
+    ok &= TestWorkload(workloads[i]);
+  }
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,228 @@
+// Copyright 2014, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   * Redistributions of source code must retain the above copyright
+//     notice, this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above
+//     copyright notice, this list of conditions and the following disclaimer
+//     in the documentation and/or other materials provided with the
+//     distribution.
+//   * Neither the name of Google Inc. nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+//
+//
+//
+//
+/// \file
+/// Implementation of the \link infact::ConcurrentEnvironment
+/// ConcurrentEnvironment \endlink class, including the epochs that
+/// determine when replaced tables may be freed.
+
+#include <cstdint>
+#include <vector>
+
+#include "concurrent-environment.h"
+
+namespace infact {
+
+namespace {
+
+// The state of a thread that reads tables.  Records are shared by all
+// environments and never freed: the record of an exiting thread is
+// reused by the next new thread.
+struct ReaderRecord {
+  ReaderRecord() : epoch(0), in_use(true), next(nullptr) { }
+
+  // The global epoch when the thread began its current read, or 0 if
+  // it is not reading.
+  std::atomic<uint64_t> epoch;
+  // Whether the record belongs to a running thread.
+  std::atomic<bool> in_use;
+  // The next record in the list of all records.
+  ReaderRecord *next;
+  // Keeps the records of different threads on different cache lines.
+  char padding[64];
+};
+
+// A table that has been replaced, and the global epoch when it was.
+struct RetiredTable {
+  const void *table;
+  void (*destroy)(const void *table);
+  uint64_t epoch;
+};
+
+std::atomic<uint64_t> global_epoch(1);
+std::atomic<ReaderRecord *> reader_records(nullptr);
+
+std::mutex retired_mutex;
+std::vector<RetiredTable> retired_tables;
+
+// Returns an unused record, creating one if there is none.
+ReaderRecord *
+AcquireRecord() {
+  for (ReaderRecord *record = reader_records.load(); record != nullptr;
+       record = record->next) {
+    bool in_use = false;
+    if (record->in_use.compare_exchange_strong(in_use, true)) {
+      return record;
+    }
+  }
+  ReaderRecord *record = new ReaderRecord();
+  ReaderRecord *head = reader_records.load();
+  do {
+    record->next = head;
+  } while (!reader_records.compare_exchange_weak(head, record));
+  return record;
+}
+
+// Holds the record of the calling thread, releasing it when the thread
+// exits.
+struct ThreadRecord {
+  ThreadRecord() : record(AcquireRecord()) { }
+  ~ThreadRecord() {
+    record->epoch.store(0);
+    record->in_use.store(false);
+  }
+  ReaderRecord *record;
+};
+
+thread_local ThreadRecord thread_record;
+
+// Marks the calling thread as reading for the lifetime of this object,
+// so that no table it loads is freed in the meantime.
+class ReadGuard {
+ public:
+  ReadGuard() : record_(thread_record.record) {
+    record_->epoch.store(global_epoch.load());
+  }
+  ~ReadGuard() { record_->epoch.store(0, std::memory_order_release); }
+
+ private:
+  ReaderRecord *record_;
+};
+
+// Frees the retired tables that no reader can still be using: those
+// retired before the earliest epoch at which a current read began.
+void
+Reclaim() {
+  uint64_t min_epoch = UINT64_MAX;
+  for (ReaderRecord *record = reader_records.load(); record != nullptr;
+       record = record->next) {
+    uint64_t epoch = record->epoch.load();
+    if (epoch != 0 && epoch < min_epoch) {
+      min_epoch = epoch;
+    }
+  }
+  std::vector<RetiredTable> reclaimable;
+  {
+    std::lock_guard<std::mutex> lock(retired_mutex);
+    size_t num_kept = 0;
+    for (size_t i = 0; i < retired_tables.size(); ++i) {
+      if (retired_tables[i].epoch < min_epoch) {
+        reclaimable.push_back(retired_tables[i]);
+      } else {
+        retired_tables[num_kept++] = retired_tables[i];
+      }
+    }
+    retired_tables.resize(num_kept);
+  }
+  for (size_t i = 0; i < reclaimable.size(); ++i) {
+    reclaimable[i].destroy(reclaimable[i].table);
+  }
+}
+
+// Frees a table once no reader can be using it.  A reader that loaded
+// the table announced an epoch no later than the one returned here,
+// since it read the global epoch before the table was replaced.
+void
+Retire(const void *table, void (*destroy)(const void *table)) {
+  RetiredTable retired;
+  retired.table = table;
+  retired.destroy = destroy;
+  retired.epoch = global_epoch.fetch_add(1);
+  {
+    std::lock_guard<std::mutex> lock(retired_mutex);
+    retired_tables.push_back(retired);
+  }
+  Reclaim();
+}
+
+}  // namespace
+
+const size_t ConcurrentEnvironment::kNumShards;
+
+ConcurrentEnvironment::ConcurrentEnvironment() { }
+
+ConcurrentEnvironment::~ConcurrentEnvironment() {
+  for (size_t i = 0; i < kNumShards; ++i) {
+    delete shards_[i].table.load();
+  }
+  Reclaim();
+}
+
+string
+ConcurrentEnvironment::GetType(const string &varname) const {
+  shared_ptr<const Value> value = Find(varname);
+  return value.get() == nullptr ? "" : value->type();
+}
+
+bool
+ConcurrentEnvironment::Erase(const string &varname) {
+  return Publish(varname, shared_ptr<const Value>());
+}
+
+shared_ptr<const ConcurrentEnvironment::Value>
+ConcurrentEnvironment::Find(const string &varname) const {
+  const Shard &shard = ShardOf(varname);
+  ReadGuard guard;
+  const Table *table = shard.table.load();
+  Table::const_iterator it = table->find(varname);
+  return it == table->end() ? shared_ptr<const Value>() : it->second;
+}
+
+bool
+ConcurrentEnvironment::Publish(const string &varname,
+                               const shared_ptr<const Value> &value) {
+  Shard &shard = ShardOf(varname);
+  const Table *old_table = nullptr;
+  bool defined = false;
+  {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    old_table = shard.table.load();
+    defined = old_table->count(varname) != 0;
+    if (value.get() == nullptr && !defined) {
+      return false;
+    }
+    Table *table = new Table(*old_table);
+    if (value.get() != nullptr) {
+      (*table)[varname] = value;
+    } else {
+      table->erase(varname);
+    }
+    shard.table.store(table);
+  }
+  Retire(old_table, [](const void *table) {
+      delete static_cast<const Table *>(table);
+    });
+  return defined;
+}
+
+}  // namespace infact
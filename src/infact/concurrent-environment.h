@@ -0,0 +1,222 @@
+// Copyright 2014, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   * Redistributions of source code must retain the above copyright
+//     notice, this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above
+//     copyright notice, this list of conditions and the following disclaimer
+//     in the documentation and/or other materials provided with the
+//     distribution.
+//   * Neither the name of Google Inc. nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+//
+//
+//
+//
+/// \file
+/// Provides the \link infact::ConcurrentEnvironment ConcurrentEnvironment
+/// \endlink class, a mapping from variables to values that may be read
+/// and written from many threads at once.
+
+#ifndef INFACT_CONCURRENT_ENVIRONMENT_H_
+#define INFACT_CONCURRENT_ENVIRONMENT_H_
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "environment-impl.h"
+#include "factory.h"
+
+namespace infact {
+
+using std::shared_ptr;
+using std::string;
+using std::unordered_map;
+
+/// A mapping from variables to typed values that host code may read and
+/// write from many threads while the process runs, for example to apply
+/// runtime overrides of settings read by worker threads.
+///
+/// Variables are spread over \link kNumShards \endlink shards by a hash
+/// of their names.  Each shard publishes an immutable table through an
+/// atomic pointer: a read loads the table and looks up the variable
+/// without taking any lock, while a write copies the table of its shard
+/// under that shard&rsquo;s mutex and publishes the copy, so that writes
+/// to different shards proceed in parallel.  Replaced tables are freed
+/// only once no reader can still be using them, which is tracked with
+/// per-thread epochs.
+///
+/// Values are immutable once set, and are shared between the
+/// environment and readers: \link GetShared \endlink returns a value
+/// without copying it, and it remains valid after the variable is
+/// reassigned.  Unlike an \link infact::EnvironmentImpl EnvironmentImpl
+/// \endlink, this class does not evaluate specifications; its variables
+/// are set from C++, or imported from an environment with \link Import
+/// \endlink.
+class ConcurrentEnvironment {
+ public:
+  /// The number of shards across which variables are spread.
+  static const size_t kNumShards = 64;
+
+  /// Constructs an empty environment.
+  ConcurrentEnvironment();
+
+  /// Destroys this environment.  No other thread may be accessing it.
+  virtual ~ConcurrentEnvironment();
+
+  /// Sets the specified variable to a copy of the specified value,
+  /// replacing any previous value, whatever its type.
+  template <typename T>
+  void Set(const string &varname, const T &value) {
+    Publish(varname, shared_ptr<const Value>(new TypedValue<T>(value)));
+  }
+
+  /// Retrieves a copy of the value of the specified variable.
+  ///
+  /// \return whether the variable is defined with a value of type
+  ///         <tt>T</tt>
+  template <typename T>
+  bool Get(const string &varname, T *value) const {
+    shared_ptr<const T> shared = GetShared<T>(varname);
+    if (shared.get() == nullptr) {
+      return false;
+    }
+    *value = *shared;
+    return true;
+  }
+
+  /// Returns the value of the specified variable without copying it, or
+  /// <tt>nullptr</tt> if the variable is not defined with a value of
+  /// type <tt>T</tt>.
+  template <typename T>
+  shared_ptr<const T> GetShared(const string &varname) const {
+    shared_ptr<const Value> value = Find(varname);
+    if (value.get() == nullptr || value->tag() != TypedValue<T>::Tag()) {
+      return shared_ptr<const T>();
+    }
+    const TypedValue<T> *typed = static_cast<const TypedValue<T> *>(
+        value.get());
+    return shared_ptr<const T>(value, &typed->value());
+  }
+
+  /// Copies the value of the specified variable of the specified
+  /// environment into this one.
+  ///
+  /// \return whether the variable is defined in that environment with
+  ///         a value of type <tt>T</tt>
+  template <typename T>
+  bool Import(const EnvironmentImpl &env, const string &varname) {
+    T value;
+    if (!env.Get(varname, &value)) {
+      return false;
+    }
+    Set(varname, value);
+    return true;
+  }
+
+  /// Returns whether the specified variable is defined.
+  bool Defined(const string &varname) const {
+    return Find(varname).get() != nullptr;
+  }
+
+  /// Returns the type name of the specified variable, such as
+  /// <tt>"int"</tt> or <tt>"Animal[]"</tt>, or the empty string if it
+  /// is not defined.
+  string GetType(const string &varname) const;
+
+  /// Removes the specified variable.
+  ///
+  /// \return whether the variable was defined
+  bool Erase(const string &varname);
+
+ private:
+  /// The value of a variable, of any type.
+  class Value {
+   public:
+    virtual ~Value() { }
+
+    /// Returns an address that uniquely identifies the type of this
+    /// value.
+    virtual const void *tag() const = 0;
+
+    /// Returns the type name of this value.
+    virtual string type() const = 0;
+  };
+
+  /// The value of a variable of a particular type.
+  template <typename T>
+  class TypedValue : public Value {
+   public:
+    explicit TypedValue(const T &value) : value_(value) { }
+
+    /// Returns the address identifying type <tt>T</tt>.
+    static const void *Tag() {
+      static const char tag = 0;
+      return &tag;
+    }
+
+    virtual const void *tag() const { return Tag(); }
+
+    virtual string type() const { return TypeName<T>().ToString(); }
+
+    const T &value() const { return value_; }
+
+   private:
+    T value_;
+  };
+
+  /// An immutable table of the variables of a shard.
+  typedef unordered_map<string, shared_ptr<const Value> > Table;
+
+  /// A shard of variables.
+  struct Shard {
+    Shard() : table(new Table()) { }
+
+    /// The current table of this shard.
+    std::atomic<const Table *> table;
+    /// Serializes writes to this shard.
+    std::mutex mutex;
+  };
+
+  /// Returns the value of the specified variable, or <tt>nullptr</tt>
+  /// if it is not defined.
+  shared_ptr<const Value> Find(const string &varname) const;
+
+  /// Sets the value of the specified variable, or removes it if the
+  /// value is <tt>nullptr</tt>.
+  ///
+  /// \return whether the variable was previously defined
+  bool Publish(const string &varname, const shared_ptr<const Value> &value);
+
+  /// Returns the shard holding the specified variable.
+  Shard &ShardOf(const string &varname) const {
+    return shards_[std::hash<string>()(varname) % kNumShards];
+  }
+
+  mutable Shard shards_[kNumShards];
+};
+
+}  // namespace infact
+
+#endif
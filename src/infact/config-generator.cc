@@ -0,0 +1,269 @@
+// Copyright 2014, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   * Redistributions of source code must retain the above copyright
+//     notice, this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above
+//     copyright notice, this list of conditions and the following disclaimer
+//     in the documentation and/or other materials provided with the
+//     distribution.
+//   * Neither the name of Google Inc. nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+//
+//
+/// \file
+/// Implementation of the \link infact::ConfigGenerator ConfigGenerator
+/// \endlink class.
+
+#include <cstdlib>
+#include <sstream>
+
+#include "config-generator.h"
+
+namespace infact {
+
+using std::ostringstream;
+
+namespace {
+
+// The kinds of statements, and the type of the variable each defines.
+const char *kKinds[] = {
+  "int", "double", "string", "int[]", "date", "person", "cow", "sheep", "owner"
+};
+const char *kKindTypes[] = {
+  "int", "double", "string", "int[]", "Date", "Person", "Animal", "Animal",
+  "PetOwner"
+};
+const size_t kNumKinds = sizeof(kKinds) / sizeof(const char *);
+
+}  // namespace
+
+ConfigOptions::ConfigOptions() :
+    num_statements(1000), reference_density(0.2), max_depth(3),
+    mean_vector_length(10), mean_string_length(8), seed(1) {
+  for (size_t i = 0; i < kNumKinds; ++i) {
+    mix[kKinds[i]] = 1.0;
+  }
+}
+
+bool
+ConfigOptions::ParseMix(const string &mix_spec) {
+  map<string, double> new_mix;
+  for (size_t i = 0; i < kNumKinds; ++i) {
+    new_mix[kKinds[i]] = 0.0;
+  }
+  std::istringstream iss(mix_spec);
+  string entry;
+  while (std::getline(iss, entry, ',')) {
+    size_t equals_pos = entry.find('=');
+    if (equals_pos == string::npos) {
+      return false;
+    }
+    string kind = entry.substr(0, equals_pos);
+    if (new_mix.find(kind) == new_mix.end()) {
+      return false;
+    }
+    new_mix[kind] = atof(entry.c_str() + equals_pos + 1);
+  }
+  mix = new_mix;
+  return true;
+}
+
+ConfigGenerator::ConfigGenerator(const ConfigOptions &options) :
+    options_(options), random_(options.seed) { }
+
+string
+ConfigGenerator::Generate() {
+  ostringstream oss;
+  Generate(oss);
+  return oss.str();
+}
+
+void
+ConfigGenerator::Generate(ostream &os) {
+  vector<double> weights;
+  for (size_t i = 0; i < kNumKinds; ++i) {
+    map<string, double>::const_iterator it = options_.mix.find(kKinds[i]);
+    weights.push_back(it == options_.mix.end() ? 0.0 : it->second);
+  }
+  std::discrete_distribution<size_t> kind_distribution(weights.begin(),
+                                                       weights.end());
+  variables_.clear();
+  for (size_t i = 0; i < options_.num_statements; ++i) {
+    size_t kind = kind_distribution(random_);
+    ostringstream name_oss;
+    name_oss << "v" << i;
+    string name = name_oss.str();
+    os << kKindTypes[kind] << " " << name << " = ";
+    // The value of each statement is a fresh value or, sometimes, a copy
+    // of an existing variable.
+    if (!MaybeWriteReference(os, kKindTypes[kind])) {
+      switch (kind) {
+        case 0: WriteInt(os); break;
+        case 1: WriteDouble(os); break;
+        case 2: WriteString(os); break;
+        case 3: WriteIntVector(os); break;
+        case 4: WriteDate(os, 1); break;
+        case 5: WritePerson(os, 1); break;
+        case 6: WriteCow(os, 1); break;
+        case 7: WriteSheep(os, 1); break;
+        default: WriteOwner(os, 1); break;
+      }
+    }
+    os << ";\n";
+    variables_[kKindTypes[kind]].push_back(name);
+  }
+}
+
+void
+ConfigGenerator::WriteInt(ostream &os) {
+  os << Uniform(0, 100000);
+}
+
+void
+ConfigGenerator::WriteDouble(ostream &os) {
+  os << Uniform(0, 100000) << "." << Uniform(0, 999);
+}
+
+void
+ConfigGenerator::WriteString(ostream &os) {
+  size_t max_length = options_.mean_string_length > 1 ?
+      2 * options_.mean_string_length - 1 : 1;
+  size_t length = Uniform(1, max_length);
+  os << '"';
+  for (size_t i = 0; i < length; ++i) {
+    os << static_cast<char>('a' + Uniform(0, 25));
+  }
+  os << '"';
+}
+
+void
+ConfigGenerator::WriteIntVector(ostream &os) {
+  size_t length = Uniform(0, 2 * options_.mean_vector_length);
+  os << "{";
+  for (size_t i = 0; i < length; ++i) {
+    os << (i == 0 ? "" : ", ");
+    if (!MaybeWriteReference(os, "int")) {
+      WriteInt(os);
+    }
+  }
+  os << "}";
+}
+
+void
+ConfigGenerator::WriteDate(ostream &os, size_t depth) {
+  os << "DateImpl(year(" << Uniform(1900, 2020) << "), month("
+     << Uniform(1, 12) << "), day(" << Uniform(1, 28) << "))";
+}
+
+void
+ConfigGenerator::WritePerson(ostream &os, size_t depth) {
+  os << "PersonImpl(name(";
+  WriteString(os);
+  os << "), cm_height(" << Uniform(50, 220) << ")";
+  ostringstream birthday_oss;
+  if (MaybeWriteReference(birthday_oss, "Date")) {
+    os << ", birthday(" << birthday_oss.str() << ")";
+  } else if (depth < options_.max_depth) {
+    os << ", birthday(";
+    WriteDate(os, depth + 1);
+    os << ")";
+  }
+  os << ")";
+}
+
+void
+ConfigGenerator::WriteCow(ostream &os, size_t depth) {
+  static const char *colors[] = { "BROWN", "WHITE", "BLACK_AND_WHITE" };
+  os << "Cow(name(";
+  WriteString(os);
+  os << "), age(" << Uniform(0, 20) << "), color(" << colors[Uniform(0, 2)]
+     << "))";
+}
+
+void
+ConfigGenerator::WriteSheep(ostream &os, size_t depth) {
+  os << "Sheep(name(";
+  WriteString(os);
+  os << "), age(" << Uniform(0, 15) << "), counts(";
+  if (!MaybeWriteReference(os, "int[]")) {
+    WriteIntVector(os);
+  }
+  os << "))";
+}
+
+void
+ConfigGenerator::WriteOwner(ostream &os, size_t depth) {
+  size_t num_pets = Uniform(0, 2 * options_.mean_vector_length);
+  os << "HumanPetOwner(pets({";
+  size_t num_written = 0;
+  for (size_t i = 0; i < num_pets; ++i) {
+    ostringstream pet_oss;
+    WriteAnimal(pet_oss, depth + 1);
+    if (!pet_oss.str().empty()) {
+      os << (num_written++ == 0 ? "" : ", ") << pet_oss.str();
+    }
+  }
+  os << "}))";
+}
+
+void
+ConfigGenerator::WriteAnimal(ostream &os, size_t depth) {
+  if (MaybeWriteReference(os, "Animal")) {
+    return;
+  }
+  if (depth > options_.max_depth) {
+    // Too deep for a nested spec, so use a reference, if possible.
+    map<string, vector<string> >::const_iterator it =
+        variables_.find("Animal");
+    if (it != variables_.end() && !it->second.empty()) {
+      os << it->second[Uniform(0, it->second.size() - 1)];
+    }
+    return;
+  }
+  if (Uniform(0, 1) == 0) {
+    WriteCow(os, depth);
+  } else {
+    WriteSheep(os, depth);
+  }
+}
+
+bool
+ConfigGenerator::MaybeWriteReference(ostream &os, const string &type) {
+  map<string, vector<string> >::const_iterator it = variables_.find(type);
+  if (it == variables_.end() || it->second.empty()) {
+    return false;
+  }
+  std::bernoulli_distribution reference(options_.reference_density);
+  if (!reference(random_)) {
+    return false;
+  }
+  os << it->second[Uniform(0, it->second.size() - 1)];
+  return true;
+}
+
+size_t
+ConfigGenerator::Uniform(size_t min, size_t max) {
+  std::uniform_int_distribution<size_t> distribution(min, max);
+  return distribution(random_);
+}
+
+}  // namespace infact
@@ -0,0 +1,137 @@
+// Copyright 2014, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   * Redistributions of source code must retain the above copyright
+//     notice, this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above
+//     copyright notice, this list of conditions and the following disclaimer
+//     in the documentation and/or other materials provided with the
+//     distribution.
+//   * Neither the name of Google Inc. nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+//
+//
+/// \file
+/// Provides the \link infact::ConfigGenerator ConfigGenerator \endlink
+/// class, which writes synthetic but realistic specification files
+/// using the example classes, for load testing.
+
+#ifndef INFACT_CONFIG_GENERATOR_H_
+#define INFACT_CONFIG_GENERATOR_H_
+
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace infact {
+
+using std::map;
+using std::ostream;
+using std::string;
+using std::vector;
+
+/// The parameters of a generated specification file.
+struct ConfigOptions {
+  /// Constructs a set of options with moderate defaults.
+  ConfigOptions();
+
+  /// Parses a statement mix of the form <tt>kind=weight,...</tt>, such as
+  /// <tt>"int=1,person=2"</tt>, replacing the current mix.
+  ///
+  /// \return whether the mix could be parsed; if not, the mix is
+  ///         left unchanged
+  bool ParseMix(const string &mix_spec);
+
+  /// The number of statements to generate.
+  size_t num_statements;
+  /// The probability that a value that may refer to a previously-defined
+  /// variable (such as a vector element or an object member) does so.
+  double reference_density;
+  /// The maximum nesting depth of object specs, where a top-level spec
+  /// has depth 1; more deeply nested objects become variable references
+  /// or are omitted.
+  size_t max_depth;
+  /// The mean length of vector literals, whose lengths are uniformly
+  /// distributed between 0 and twice this value.
+  size_t mean_vector_length;
+  /// The mean length of string literals, whose lengths are uniformly
+  /// distributed between 1 and twice this value.
+  size_t mean_string_length;
+  /// The relative weight of each kind of statement, keyed by one of
+  /// <tt>int</tt>, <tt>double</tt>, <tt>string</tt>, <tt>int[]</tt>,
+  /// <tt>date</tt>, <tt>person</tt>, <tt>cow</tt>, <tt>sheep</tt> or
+  /// <tt>owner</tt>.
+  map<string, double> mix;
+  /// The seed of the random number generator, so that output is
+  /// reproducible.
+  unsigned seed;
+};
+
+/// Writes a specification file, one statement per line, whose shape is
+/// determined by a \link ConfigOptions \endlink instance.
+class ConfigGenerator {
+ public:
+  /// Constructs a generator with the specified options.
+  explicit ConfigGenerator(const ConfigOptions &options);
+
+  /// Writes a specification file to the specified stream.
+  void Generate(ostream &os);
+
+  /// Returns a newly generated specification file as a string.
+  string Generate();
+
+ private:
+  // Each of the following writes a value of the kind in its name to the
+  // specified stream, at the specified nesting depth.
+  void WriteInt(ostream &os);
+  void WriteDouble(ostream &os);
+  void WriteString(ostream &os);
+  void WriteIntVector(ostream &os);
+  void WriteDate(ostream &os, size_t depth);
+  void WritePerson(ostream &os, size_t depth);
+  void WriteCow(ostream &os, size_t depth);
+  void WriteSheep(ostream &os, size_t depth);
+  void WriteOwner(ostream &os, size_t depth);
+
+  /// Writes the value of an Animal member or vector element: either a
+  /// reference to an Animal variable or a nested Cow or Sheep spec.
+  void WriteAnimal(ostream &os, size_t depth);
+
+  /// With probability <tt>reference_density</tt>, writes the name of a
+  /// random, previously-defined variable of the specified type.
+  ///
+  /// \return whether a reference was written
+  bool MaybeWriteReference(ostream &os, const string &type);
+
+  /// Returns a uniformly-distributed integer in [min, max].
+  size_t Uniform(size_t min, size_t max);
+
+  ConfigOptions options_;
+  std::mt19937 random_;
+  /// The names of all variables defined so far, keyed by type.
+  map<string, vector<string> > variables_;
+};
+
+}  // namespace infact
+
+#endif
@@ -0,0 +1,145 @@
+// Copyright 2014, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   * Redistributions of source code must retain the above copyright
+//     notice, this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above
+//     copyright notice, this list of conditions and the following disclaimer
+//     in the documentation and/or other materials provided with the
+//     distribution.
+//   * Neither the name of Google Inc. nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+//
+//
+/// \file
+/// Implementation of the ConfigHolder class.
+
+#include <fstream>
+#include <sstream>
+
+#include "config-holder.h"
+#include "error.h"
+#include "file-loader.h"
+
+namespace infact {
+
+using std::ifstream;
+using std::ostringstream;
+
+const size_t ConfigHolder::kDefaultNumRetained;
+
+size_t
+ConfigHolder::Load(const string &filename) {
+  ifstream file(filename.c_str());
+  if (!file) {
+    ostringstream err_ss;
+    err_ss << "ConfigHolder: error: could not open file " << filename;
+    Error(err_ss.str());
+  }
+  ostringstream spec_ss;
+  spec_ss << file.rdbuf();
+  return LoadString(spec_ss.str());
+}
+
+size_t
+ConfigHolder::LoadString(const string &spec) {
+  std::lock_guard<std::mutex> load_lock(load_mutex_);
+  shared_ptr<const Generation> previous = current();
+  shared_ptr<Generation> generation(new Generation(next_id_++));
+  Evaluate(spec, previous.get(), generation.get());
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  generations_.push_back(generation);
+  // A rollback made while evaluating stands.
+  if (current() == previous) {
+    std::atomic_store(&current_, shared_ptr<const Generation>(generation));
+  }
+  while (generations_.size() > num_retained_) {
+    generations_.pop_front();
+  }
+  return generation->id();
+}
+
+void
+ConfigHolder::Evaluate(const string &spec, const Generation *previous,
+                       Generation *generation) {
+  StreamTokenizer st(spec);
+  string rejected;
+  generation->indexed_ = generation->index_.Add(st, &rejected);
+  if (!generation->indexed_) {
+    // Without one statement per variable, there is no telling which
+    // variables are unchanged.
+    generation->interpreter_->EvalString(spec);
+    return;
+  }
+  const StatementIndex &index = generation->index_;
+  bool compare = previous != nullptr && previous->indexed_;
+  vector<bool> unchanged(index.size(), false);
+  for (size_t i = 0; i < index.size(); ++i) {
+    const StatementIndex::Statement &statement = index.statement(i);
+    size_t previous_index = compare ?
+        previous->index_.Find(statement.varname) : StatementIndex::kNone;
+    if (previous_index != StatementIndex::kNone) {
+      const StatementIndex::Statement &previous_statement =
+          previous->index_.statement(previous_index);
+      // Identical text refers to the same variables, so the statement
+      // is unchanged if each of them is, unless it reads files, whose
+      // contents may have changed.
+      unchanged[i] = previous_statement.text == statement.text &&
+          previous_statement.dependencies.size() ==
+          statement.dependencies.size() &&
+          FindFileReferences(statement.text, nullptr) == 0;
+      for (size_t j = 0; j < statement.dependencies.size(); ++j) {
+        unchanged[i] = unchanged[i] && unchanged[statement.dependencies[j]];
+      }
+    }
+    if (unchanged[i]) {
+      generation->env_->CopyVariableFrom(previous->env_, statement.varname);
+      ++generation->num_shared_;
+    } else {
+      generation->interpreter_->EvalString(statement.text);
+    }
+  }
+}
+
+bool
+ConfigHolder::Rollback(size_t id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (size_t i = 0; i < generations_.size(); ++i) {
+    if (generations_[i]->id() == id) {
+      std::atomic_store(&current_, generations_[i]);
+      return true;
+    }
+  }
+  return false;
+}
+
+vector<size_t>
+ConfigHolder::RetainedIds() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  vector<size_t> ids;
+  for (size_t i = 0; i < generations_.size(); ++i) {
+    ids.push_back(generations_[i]->id());
+  }
+  return ids;
+}
+
+}  // namespace infact
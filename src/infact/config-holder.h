@@ -0,0 +1,189 @@
+// Copyright 2014, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   * Redistributions of source code must retain the above copyright
+//     notice, this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above
+//     copyright notice, this list of conditions and the following disclaimer
+//     in the documentation and/or other materials provided with the
+//     distribution.
+//   * Neither the name of Google Inc. nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+//
+//
+/// \file
+/// Provides the \link infact::ConfigHolder ConfigHolder \endlink class,
+/// which retains several evaluated generations of a configuration so
+/// that a misbehaving reload may be rolled back instantly.
+
+#ifndef INFACT_CONFIG_HOLDER_H_
+#define INFACT_CONFIG_HOLDER_H_
+
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "environment-impl.h"
+#include "interpreter.h"
+#include "statement-index.h"
+
+namespace infact {
+
+using std::deque;
+using std::shared_ptr;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+/// Holds the current configuration of a process along with the last
+/// few configurations it replaced, each evaluated from a specification.
+///
+/// Each load evaluates a new generation and makes it current.  A
+/// variable whose statement is textually identical to the one in the
+/// current generation, and whose dependencies are likewise unchanged,
+/// is not evaluated again but copied from the current generation, so
+/// that its objects are shared rather than constructed anew.  Retaining
+/// a generation therefore costs memory mainly for the variables that
+/// differ from its neighbors.  Statements that read files are always
+/// evaluated again, since the files may have changed.
+///
+/// Readers obtain the current generation with \link current \endlink,
+/// which never blocks, and may keep using a generation for as long as
+/// they hold it, even after it is no longer retained.  Switching back
+/// to any retained generation with \link Rollback \endlink only
+/// publishes a pointer, however large the configuration, and does not
+/// wait for a load in progress.  Loads are serialized with each other.
+class ConfigHolder {
+ public:
+  /// The default number of generations retained.
+  static const size_t kDefaultNumRetained = 4;
+
+  /// An immutable, evaluated configuration.
+  class Generation {
+   public:
+    /// Returns the identifier of this generation, which increases with
+    /// every load.
+    size_t id() const { return id_; }
+
+    /// Returns the environment holding the variables of this generation.
+    const EnvironmentImpl &env() const { return *env_; }
+
+    /// Retrieves the value of the specified variable.
+    ///
+    /// \return whether the variable is defined with a value of type
+    ///         <tt>T</tt>
+    template <typename T>
+    bool Get(const string &varname, T *value) const {
+      return env_->Get(varname, value);
+    }
+
+    /// Returns the number of variables of this generation copied from
+    /// the generation that was current when it was loaded.
+    size_t num_shared() const { return num_shared_; }
+
+   private:
+    friend class ConfigHolder;
+
+    explicit Generation(size_t id) :
+        id_(id), interpreter_(new Interpreter()),
+        env_(interpreter_->env()), indexed_(false), num_shared_(0) { }
+
+    size_t id_;
+    /// The interpreter that evaluated this generation, which owns its
+    /// environment.
+    unique_ptr<Interpreter> interpreter_;
+    EnvironmentImpl *env_;
+    /// The statements of this generation, against which the next load
+    /// is compared.
+    StatementIndex index_;
+    /// Whether the statements could be indexed; if not, none of the
+    /// variables of this generation are shared with the next.
+    bool indexed_;
+    size_t num_shared_;
+  };
+
+  /// Constructs a holder without any generations.
+  ///
+  /// \param num_retained the number of generations to retain, including
+  ///                     the current one; at least one is always retained
+  explicit ConfigHolder(size_t num_retained = kDefaultNumRetained) :
+      num_retained_(num_retained == 0 ? 1 : num_retained), next_id_(1) { }
+
+  /// Evaluates the specified file as a new generation and makes it
+  /// current, discarding the oldest retained generation if there are
+  /// too many.  As with \link LoadString\endlink, a rollback made
+  /// during the load stands.
+  ///
+  /// \return the identifier of the new generation
+  size_t Load(const string &filename);
+
+  /// Evaluates the specified string as a new generation and makes it
+  /// current, discarding the oldest retained generation if there are
+  /// too many.  If \link Rollback \endlink made another generation
+  /// current while the new one was being evaluated, the rollback
+  /// stands: the new generation is retained but not made current, so
+  /// that it may be made current later by passing its identifier to
+  /// \link Rollback\endlink.
+  ///
+  /// \return the identifier of the new generation
+  size_t LoadString(const string &spec);
+
+  /// Returns the current generation, or <tt>nullptr</tt> if nothing
+  /// has been loaded.
+  shared_ptr<const Generation> current() const {
+    return std::atomic_load(&current_);
+  }
+
+  /// Makes the retained generation with the specified identifier
+  /// current.  Newer generations remain retained, so that this may
+  /// itself be undone.
+  ///
+  /// \return whether the generation is retained
+  bool Rollback(size_t id);
+
+  /// Returns the identifiers of the retained generations, oldest first.
+  vector<size_t> RetainedIds() const;
+
+ private:
+  /// Evaluates the specified statements into the specified generation,
+  /// copying unchanged variables from the specified previous generation,
+  /// which may be <tt>nullptr</tt>.
+  static void Evaluate(const string &spec, const Generation *previous,
+                       Generation *generation);
+
+  size_t num_retained_;
+  size_t next_id_;
+  /// The retained generations, oldest first.
+  deque<shared_ptr<const Generation> > generations_;
+  /// The current generation, accessed atomically.
+  shared_ptr<const Generation> current_;
+  /// Serializes loads.
+  std::mutex load_mutex_;
+  /// Guards the retained generations.
+  mutable std::mutex mutex_;
+};
+
+}  // namespace infact
+
+#endif
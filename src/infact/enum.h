@@ -0,0 +1,325 @@
+// Copyright 2014, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   * Redistributions of source code must retain the above copyright
+//     notice, this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above
+//     copyright notice, this list of conditions and the following disclaimer
+//     in the documentation and/or other materials provided with the
+//     distribution.
+//   * Neither the name of Google Inc. nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+//
+//
+/// \file
+/// Provides support for enumerated types whose values may be specified
+/// by name, both as variables and as members of \link infact::Factory
+/// Factory\endlink-constructible objects.
+
+#ifndef INFACT_ENUM_H_
+#define INFACT_ENUM_H_
+
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "environment.h"
+#include "error.h"
+#include "factory.h"
+#include "stream-init.h"
+#include "stream-tokenizer.h"
+
+namespace infact {
+
+using std::ostringstream;
+using std::string;
+using std::unordered_map;
+using std::unordered_set;
+using std::vector;
+
+/// An interface for all \link Enum \endlink instances, allowing an \link
+/// infact::Environment Environment \endlink to create variable maps
+/// for every registered enumerated type and to recognize the names of
+/// their values.
+class EnumBase {
+ public:
+  virtual ~EnumBase() { }
+  /// Returns the name of the enumerated type, as it appears in type
+  /// specifiers.
+  virtual const string BaseName() const = 0;
+  /// Collects the names of the values registered for this enumerated type.
+  ///
+  /// \param[out] names a set to be modified by this method so that it
+  ///                   contains the names of the registered values
+  virtual void CollectNames(unordered_set<string> &names) const = 0;
+
+  virtual VarMapBase *CreateVarMap(Environment *env) const = 0;
+
+  virtual VarMapBase *CreateVectorVarMap(Environment *env) const = 0;
+};
+
+/// A class to hold all \link Enum \endlink instances that have been created.
+class EnumContainer {
+ public:
+  typedef vector<EnumBase *>::iterator iterator;
+
+  /// Adds the specified enumerated type to this container.
+  static void Add(EnumBase *enum_type) {
+    enums()->push_back(enum_type);
+  }
+
+  /// Clears this container of enumerated types.
+  static void Clear() {
+    if (enums_ != nullptr) {
+      for (iterator it = enums_->begin(); it != enums_->end(); ++it) {
+        delete *it;
+      }
+      delete enums_;
+      enums_ = nullptr;
+    }
+  }
+
+  // Provide two methods to iterate over the EnumBase instances held
+  // by this EnumContainer.  Unlike FactoryContainer, it is perfectly
+  // normal for there to be no enumerated types at all.
+  static iterator begin() { return enums()->begin(); }
+  static iterator end() { return enums()->end(); }
+
+ private:
+  static vector<EnumBase *> *enums() {
+    if (enums_ == nullptr) {
+      enums_ = new vector<EnumBase *>();
+    }
+    return enums_;
+  }
+
+  static vector<EnumBase *> *enums_;
+};
+
+/// Holds the mapping between the names and values of the enumerated
+/// type <tt>E</tt>.  Names are resolved to values once, while parsing,
+/// so that objects may compare integral values rather than strings at
+/// run-time, and so that misspelled names are caught when a
+/// specification is read.
+///
+/// An enumerated type is made available by the \link IMPLEMENT_ENUM
+/// \endlink macro, and each of its values by the \link
+/// REGISTER_ENUM_VALUE \endlink macro, for example:
+/// \code
+/// // In a header file:
+/// enum Color { BROWN, WHITE };
+///
+/// // In an implementation file:
+/// IMPLEMENT_ENUM(Color)
+/// REGISTER_ENUM_VALUE(Color, BROWN)
+/// REGISTER_ENUM_VALUE(Color, WHITE)
+/// \endcode
+/// after which a member of type <tt>Color</tt> may be registered with
+/// \link infact::Initializers::Add Initializers::Add \endlink and
+/// specified as, say, <tt>color(WHITE)</tt>.
+///
+/// \tparam E the enumerated type
+template <typename E>
+class Enum : public EnumBase {
+ public:
+  /// Constructs a new instance.
+  Enum() { }
+
+  /// \copydoc EnumBase::BaseName
+  virtual const string BaseName() const { return base_name_; }
+
+  /// \copydoc EnumBase::CollectNames
+  virtual void CollectNames(unordered_set<string> &names) const {
+    if (values_ != nullptr) {
+      for (typename unordered_map<string, E>::const_iterator it =
+               values_->begin();
+           it != values_->end(); ++it) {
+        names.insert(it->first);
+      }
+    }
+  }
+
+  virtual VarMapBase *CreateVarMap(Environment *env) const {
+    return new VarMap<E>(BaseName(), env);
+  }
+
+  virtual VarMapBase *CreateVectorVarMap(Environment *env) const {
+    return new VarMap<vector<E> >(BaseName() + "[]", BaseName(), env);
+  }
+
+  /// Retrieves the value with the specified name.
+  ///
+  /// \return whether there is a value with the specified name
+  static bool Lookup(const string &name, E *value) {
+    if (values_ == nullptr) {
+      return false;
+    }
+    typename unordered_map<string, E>::const_iterator it =
+        values_->find(name);
+    if (it == values_->end()) {
+      return false;
+    }
+    *value = it->second;
+    return true;
+  }
+
+  /// Retrieves the name of the specified value.
+  ///
+  /// \return whether the specified value has a registered name
+  static bool Name(E value, string *name) {
+    if (values_ != nullptr) {
+      for (typename unordered_map<string, E>::const_iterator it =
+               values_->begin();
+           it != values_->end(); ++it) {
+        if (it->second == value) {
+          *name = it->first;
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  /// Returns a comma-separated list of the names of all registered
+  /// values, for use in error messages.
+  static string Names() {
+    unordered_set<string> names;
+    Enum<E>().CollectNames(names);
+    ostringstream oss;
+    for (unordered_set<string>::const_iterator it = names.begin();
+         it != names.end(); ++it) {
+      oss << (it == names.begin() ? "" : ", ") << *it;
+    }
+    return oss.str();
+  }
+
+  /// The method used by the \link REGISTER_ENUM_VALUE \endlink macro to
+  /// register a named value of this enumerated type.
+  ///
+  /// \param name  the name of the value, as it should appear in
+  ///              specification strings
+  /// \param value the value
+  /// \return the registered value
+  static E Register(const string &name, E value) {
+    if (values_ == nullptr) {
+      values_ = new unordered_map<string, E>();
+      EnumContainer::Add(new Enum<E>());
+    }
+    if (!values_->insert(std::make_pair(name, value)).second) {
+      ostringstream err_ss;
+      err_ss << "Enum<" << base_name_ << ">::Register: error: value "
+             << name << " registered twice";
+      Error(err_ss.str());
+    }
+    return value;
+  }
+
+ private:
+  /// The map from names to values of this enumerated type.
+  static unordered_map<string, E> *values_;
+  static const char *base_name_;
+};
+
+template <typename E>
+unordered_map<string, E> *Enum<E>::values_ = nullptr;
+
+/// A partial specialization so that any enumerated type registered via
+/// \link IMPLEMENT_ENUM \endlink converts to its registered name.
+template <typename E>
+class TypeName<E, typename std::enable_if<std::is_enum<E>::value>::type> {
+ public:
+  string ToString() {
+    return Enum<E>().BaseName();
+  }
+};
+
+/// A partial specialization to initialize data members of enumerated
+/// types from the names of their values.
+template <typename E>
+class Initializer<E, typename std::enable_if<std::is_enum<E>::value>::type> :
+      public StreamInitializer {
+ public:
+  Initializer(E *member) : member_(member) { }
+  virtual ~Initializer() { }
+  virtual void Init(StreamTokenizer &st, Environment *env = nullptr) {
+    StreamTokenizer::TokenType token_type = st.PeekTokenType();
+    if (token_type != StreamTokenizer::IDENTIFIER) {
+      ostringstream err_ss;
+      err_ss << "EnumInitializer: expected IDENTIFIER token at stream "
+             << "position " << st.PeekTokenStart() << " but found "
+             << StreamTokenizer::TypeName(token_type) << " token: \""
+             << st.Peek() << "\"";
+      Error(err_ss.str());
+    }
+    size_t next_tok_start = st.PeekTokenStart();
+    string next_tok = st.Next();
+    if (!Enum<E>::Lookup(next_tok, member_)) {
+      ostringstream err_ss;
+      err_ss << "Initializer<" << Enum<E>().BaseName() << ">: unknown value "
+             << "\"" << next_tok << "\" at stream position " << next_tok_start
+             << "; expected one of: " << Enum<E>::Names();
+      Error(err_ss.str());
+    }
+  }
+ private:
+  E *member_;
+};
+
+/// A partial specialization of the ValueString class to print values
+/// of enumerated types by name.
+template <typename E>
+class ValueString<E, typename std::enable_if<std::is_enum<E>::value>::type> {
+ public:
+  string ToString(const E &value) const {
+    string name;
+    if (Enum<E>::Name(value, &name)) {
+      return name;
+    }
+    ostringstream oss;
+    oss << static_cast<long long>(value);
+    return oss.str();
+  }
+};
+
+/// Provides the necessary implementation for the enumerated type
+/// <tt>TYPE</tt>, whose name in specification strings is <tt>TYPE</tt>.
+#define IMPLEMENT_ENUM(TYPE) \
+  template<> const char *infact::Enum<TYPE>::base_name_ = #TYPE;
+
+/// Registers the value <tt>VALUE</tt> of the enumerated type
+/// <tt>TYPE</tt> under the name <tt>NAME</tt>.  The two differ when
+/// <tt>VALUE</tt> is qualified, as for scoped enumerations, e.g.,
+/// <tt>REGISTER_ENUM_VALUE_NAMED(Mode, Mode::kFast, kFast)</tt>.
+#define REGISTER_ENUM_VALUE_NAMED(TYPE,VALUE,NAME) \
+  static const TYPE TYPE ## _ ## NAME ## _registered = \
+      infact::Enum<TYPE>::Register(string(#NAME), VALUE);
+
+/// Registers the unscoped value <tt>VALUE</tt> of the enumerated type
+/// <tt>TYPE</tt> under its own name.
+#define REGISTER_ENUM_VALUE(TYPE,VALUE) \
+  REGISTER_ENUM_VALUE_NAMED(TYPE,VALUE,VALUE)
+
+}  // namespace infact
+
+#endif
@@ -33,25 +33,73 @@
 /// Implementation of the Environment class.
 /// \author dbikel@google.com (Dan Bikel)
 
+#include <cerrno>
+#include <cstdlib>
+#include <limits>
+
 #include "environment-impl.h"
+#include "enum.h"
 #include "factory.h"
+#include "string-array.h"
+#include "tensor.h"
+#include "value-type.h"
 
 namespace infact {
 
-EnvironmentImpl::EnvironmentImpl(int debug) {
+EnvironmentImpl::EnvironmentImpl(int debug) :
+    parent_(nullptr), layout_version_(0) {
   debug_ = debug;
+  unordered_map<string, string> concrete_to_factory_type;
+  unordered_map<string, string> enum_value_to_type;
+  unordered_map<string, const ValueTypeBase *> value_types;
 
   // Set up VarMap instances for each of the primitive types and their vectors.
   var_map_["bool"] = new VarMap<bool>("bool", this);
   var_map_["int"] = new VarMap<int>("int", this);
+  var_map_["int64"] = new VarMap<int64_t>("int64", this);
+  var_map_["uint64"] = new VarMap<uint64_t>("uint64", this);
+  var_map_["float"] = new VarMap<float>("float", this);
   var_map_["double"] = new VarMap<double>("double", this);
   var_map_["string"] = new VarMap<string>("string", this);
+  var_map_["bytes"] = new VarMap<Bytes>("bytes", this);
   var_map_["bool[]"] = new VarMap<vector<bool> >("bool[]", "bool", this);
   var_map_["int[]"] = new VarMap<vector<int> >("int[]", "int", this);
+  var_map_["int64[]"] =
+      new VarMap<vector<int64_t> >("int64[]", "int64", this);
+  var_map_["uint64[]"] =
+      new VarMap<vector<uint64_t> >("uint64[]", "uint64", this);
+  var_map_["float[]"] = new VarMap<vector<float> >("float[]", "float", this);
   var_map_["double[]"] =
       new VarMap<vector<double> >("double[]", "double", this);
   var_map_["string[]"] =
       new VarMap<vector<string> >("string[]", "string", this);
+  var_map_["bytes[]"] = new VarMap<vector<Bytes> >("bytes[]", "bytes", this);
+  var_map_["map<bool>"] =
+      new VarMap<unordered_map<string, bool> >("map<bool>", "bool", this);
+  var_map_["map<int>"] =
+      new VarMap<unordered_map<string, int> >("map<int>", "int", this);
+  var_map_["map<int64>"] =
+      new VarMap<unordered_map<string, int64_t> >("map<int64>", "int64", this);
+  var_map_["map<uint64>"] =
+      new VarMap<unordered_map<string, uint64_t> >("map<uint64>", "uint64",
+                                                   this);
+  var_map_["map<float>"] =
+      new VarMap<unordered_map<string, float> >("map<float>", "float", this);
+  var_map_["map<double>"] =
+      new VarMap<unordered_map<string, double> >("map<double>", "double", this);
+  var_map_["map<string>"] =
+      new VarMap<unordered_map<string, string> >("map<string>", "string", this);
+  var_map_["tensor<int>"] = new VarMap<Tensor<int> >("tensor<int>", this);
+  var_map_["tensor<int64>"] =
+      new VarMap<Tensor<int64_t> >("tensor<int64>", this);
+  var_map_["tensor<uint64>"] =
+      new VarMap<Tensor<uint64_t> >("tensor<uint64>", this);
+  var_map_["tensor<float>"] =
+      new VarMap<Tensor<float> >("tensor<float>", this);
+  var_map_["tensor<double>"] =
+      new VarMap<Tensor<double> >("tensor<double>", this);
+  var_map_["array<string>"] =
+      new VarMap<StringArray>("array<string>", this);
 
   // Set up VarMap instances for each of the Factory-constructible types
   // and their vectors.
@@ -79,13 +127,23 @@ EnvironmentImpl::EnvironmentImpl(int debug) {
            << endl;
     }
 
+    // Create VarMap for maps from strings to shared_object of T and add
+    // to var_map_.
+    VarMapBase *obj_map_var_map = (*factory_it)->CreateMapVarMap(this);
+    var_map_[obj_map_var_map->Name()] = obj_map_var_map;
+
+    if (debug_ >= 2) {
+      cerr << "Environment: created VarMap for " << obj_map_var_map->Name()
+           << endl;
+    }
+
     for (unordered_set<string>::const_iterator it = registered.begin();
          it != registered.end(); ++it) {
       const string &concrete_type_name = *it;
 
       unordered_map<string, string>::const_iterator concrete_to_factory_it =
-          concrete_to_factory_type_.find(concrete_type_name);
-      if (concrete_to_factory_it != concrete_to_factory_type_.end()) {
+          concrete_to_factory_type.find(concrete_type_name);
+      if (concrete_to_factory_it != concrete_to_factory_type.end()) {
         // Warn user that there are two entries for the same concrete type
         // (presumably due to different abstract factory types).
         cerr << "Environment: WARNING: trying to override existing "
@@ -94,7 +152,7 @@ EnvironmentImpl::EnvironmentImpl(int debug) {
              << "] with [" << concrete_type_name << " --> " << base_name
              << endl;
       }
-      concrete_to_factory_type_[concrete_type_name] = base_name;
+      concrete_to_factory_type[concrete_type_name] = base_name;
 
       if (debug_ >= 2) {
         cerr << "Environment: associating concrete typename "
@@ -103,11 +161,194 @@ EnvironmentImpl::EnvironmentImpl(int debug) {
       }
     }
   }
+
+  // Set up VarMap instances for each of the registered enumerated types
+  // and their vectors.
+  for (EnumContainer::iterator enum_it = EnumContainer::begin();
+       enum_it != EnumContainer::end(); ++enum_it) {
+    string base_name = (*enum_it)->BaseName();
+    var_map_[base_name] = (*enum_it)->CreateVarMap(this);
+    var_map_[base_name + "[]"] = (*enum_it)->CreateVectorVarMap(this);
+
+    if (debug_ >= 2) {
+      cerr << "Environment: created VarMaps for enum " << base_name << endl;
+    }
+
+    unordered_set<string> names;
+    (*enum_it)->CollectNames(names);
+    for (unordered_set<string>::const_iterator it = names.begin();
+         it != names.end(); ++it) {
+      // A value name shared by two enumerated types is ambiguous, and so
+      // its type may not be inferred.
+      unordered_map<string, string>::iterator value_it =
+          enum_value_to_type.find(*it);
+      if (value_it == enum_value_to_type.end()) {
+        enum_value_to_type[*it] = base_name;
+      } else {
+        value_it->second = "";
+      }
+    }
+  }
+
+  // Set up VarMap instances for each of the registered value types and
+  // their vectors.
+  for (ValueTypeContainer::iterator value_type_it =
+           ValueTypeContainer::begin();
+       value_type_it != ValueTypeContainer::end(); ++value_type_it) {
+    string base_name = (*value_type_it)->BaseName();
+    var_map_[base_name] = (*value_type_it)->CreateVarMap(this);
+    var_map_[base_name + "[]"] = (*value_type_it)->CreateVectorVarMap(this);
+    value_types[base_name] = *value_type_it;
+
+    if (debug_ >= 2) {
+      cerr << "Environment: created VarMaps for value type " << base_name
+           << endl;
+    }
+  }
+
+  concrete_to_factory_type_ =
+      std::make_shared<const unordered_map<string, string> >(
+          std::move(concrete_to_factory_type));
+  enum_value_to_type_ =
+      std::make_shared<const unordered_map<string, string> >(
+          std::move(enum_value_to_type));
+  value_types_ =
+      std::make_shared<const unordered_map<string, const ValueTypeBase *> >(
+          std::move(value_types));
+}
+
+EnvironmentImpl::EnvironmentImpl(EnvironmentImpl *parent) :
+    parent_(parent),
+    concrete_to_factory_type_(parent->concrete_to_factory_type_),
+    enum_value_to_type_(parent->enum_value_to_type_),
+    value_types_(parent->value_types_),
+    layout_version_(0),
+    debug_(parent->debug_) { }
+
+Environment *
+EnvironmentImpl::Copy() const {
+  INFACT_STATS_INC(environment_copies);
+  INFACT_STATS_ADD(variables_copied, types_.size());
+  if (parent_ != nullptr) {
+    // Flatten the chain of ancestors into a copy of the parent, and then
+    // overwrite it with the variables of this child.
+    EnvironmentImpl *new_env = static_cast<EnvironmentImpl *>(parent_->Copy());
+    for (unordered_map<string, VarMapBase *>::const_iterator it =
+             var_map_.begin();
+         it != var_map_.end(); ++it) {
+      it->second->CopyVariablesTo(new_env->FindVarMap(it->first));
+    }
+    for (unordered_map<string, string>::const_iterator it = types_.begin();
+         it != types_.end(); ++it) {
+      new_env->types_[it->first] = it->second;
+    }
+    return new_env;
+  }
+  EnvironmentImpl *new_env = new EnvironmentImpl(*this);
+  // Now go through and create copies of each VarMap.
+  for (unordered_map<string, VarMapBase *>::iterator new_env_var_map_it =
+           new_env->var_map_.begin();
+       new_env_var_map_it != new_env->var_map_.end(); ++new_env_var_map_it) {
+    new_env_var_map_it->second = new_env_var_map_it->second->Copy(new_env);
+  }
+  return new_env;
+}
+
+bool
+EnvironmentImpl::HashValue(const string &varname, size_t *hash) const {
+  for (const EnvironmentImpl *env = this; env != nullptr; env = env->parent_) {
+    unordered_map<string, string>::const_iterator type_it =
+        env->types_.find(varname);
+    if (type_it == env->types_.end()) {
+      continue;
+    }
+    unordered_map<string, VarMapBase *>::const_iterator var_map_it =
+        env->var_map_.find(type_it->second);
+    size_t value_hash;
+    if (var_map_it == env->var_map_.end() ||
+        !var_map_it->second->HashValue(varname, &value_hash)) {
+      return false;
+    }
+    *hash = HashCombine(ValueHash<string>().Hash(type_it->second), value_hash);
+    return true;
+  }
+  return false;
+}
+
+size_t
+EnvironmentImpl::ValueBytes(const string &varname) const {
+  VarMapBase *var_map = VarMapOf(varname);
+  return var_map == nullptr ? 0 : var_map->ValueBytes(varname);
+}
+
+bool
+EnvironmentImpl::Shared(const string &varname) const {
+  VarMapBase *var_map = VarMapOf(varname);
+  return var_map != nullptr && var_map->Shared(varname);
+}
+
+bool
+EnvironmentImpl::Erase(const string &varname) {
+  VarMapBase *var_map = VarMapOf(varname);
+  if (var_map == nullptr) {
+    return false;
+  }
+  var_map->Erase(varname);
+  types_.erase(varname);
+  ++layout_version_;
+  return true;
+}
+
+VarMapBase *
+EnvironmentImpl::VarMapOf(const string &varname) const {
+  unordered_map<string, string>::const_iterator type_it =
+      types_.find(varname);
+  if (type_it == types_.end()) {
+    return nullptr;
+  }
+  unordered_map<string, VarMapBase *>::const_iterator var_map_it =
+      var_map_.find(type_it->second);
+  return var_map_it == var_map_.end() ? nullptr : var_map_it->second;
+}
+
+const string *
+EnvironmentImpl::FindType(const string &varname) const {
+  for (const EnvironmentImpl *env = this; env != nullptr; env = env->parent_) {
+    unordered_map<string, string>::const_iterator it =
+        env->types_.find(varname);
+    if (it != env->types_.end()) {
+      return &(it->second);
+    }
+  }
+  return nullptr;
+}
+
+VarMapBase *
+EnvironmentImpl::FindVarMap(const string &type) {
+  unordered_map<string, VarMapBase *>::const_iterator var_map_it =
+      var_map_.find(type);
+  if (var_map_it != var_map_.end()) {
+    return var_map_it->second;
+  }
+  // Every type has a VarMap in the root environment, so a child creates
+  // an empty one of its own modeled on that of its nearest ancestor
+  // having one.
+  for (const EnvironmentImpl *env = parent_; env != nullptr;
+       env = env->parent_) {
+    var_map_it = env->var_map_.find(type);
+    if (var_map_it != env->var_map_.end()) {
+      VarMapBase *var_map = var_map_it->second->CreateEmpty(this);
+      var_map_[type] = var_map;
+      return var_map;
+    }
+  }
+  return nullptr;
 }
 
 void
 EnvironmentImpl::ReadAndSet(const string &varname, StreamTokenizer &st,
-                            const string type) {
+                            const string type_specifier) {
+  const string type = CanonicalType(type_specifier);
   bool is_vector =
       st.PeekTokenType() == StreamTokenizer::RESERVED_CHAR &&
       st.Peek() == "{";
@@ -126,10 +367,63 @@ EnvironmentImpl::ReadAndSet(const string &varname, StreamTokenizer &st,
     Error(err_ss.str());
   }
 
+  // A brace-enclosed value whose first element is itself a
+  // brace-enclosed list is a tensor literal; its type is inferred from
+  // its first innermost element.
+  size_t tensor_depth = 0;
+  if (is_vector) {
+    while (st.Peek() == "{") {
+      st.Next();
+      ++tensor_depth;
+    }
+  }
+
+  // A brace-enclosed value whose first token is a string literal
+  // followed by a colon is a map literal rather than a vector literal.
+  bool is_map = false;
+  if (is_vector && st.PeekTokenType() == StreamTokenizer::STRING) {
+    st.Next();
+    is_map = st.Peek() == ":";
+    if (is_map) {
+      // Consume colon, so that the type is inferred from the first value.
+      st.Next();
+    } else {
+      st.Putback();
+    }
+  }
+
   string next_tok = st.Peek();
   bool is_object_type = false;
 
-  string inferred_type = InferType(varname, st, is_vector, &is_object_type);
+  // A generator expression, such as range(0, 10), is a vector value
+  // whose type is inferred from its arguments.
+  string generator;
+  string inferred_type;
+  if (!is_vector && concrete_to_factory_type_->count(next_tok) == 0 &&
+      PeekGenerator(st, &generator)) {
+    inferred_type = InferGeneratorType(varname, generator, st);
+  } else {
+    inferred_type = InferType(varname, st, is_vector, &is_object_type);
+  }
+
+  if (is_map) {
+    // Convert the inferred vector type into the corresponding map type.
+    if (inferred_type != "") {
+      inferred_type = "map<" +
+          inferred_type.substr(0, inferred_type.length() - 2) + ">";
+    }
+    // Put back the first key and its colon.
+    st.Rewind(2);
+  }
+
+  if (tensor_depth > 0) {
+    // Convert the inferred vector type into the corresponding tensor type.
+    if (inferred_type != "") {
+      inferred_type = "tensor<" +
+          inferred_type.substr(0, inferred_type.length() - 2) + ">";
+    }
+    st.Rewind(tensor_depth);
+  }
 
   if (is_vector) {
     st.Putback();
@@ -148,7 +442,9 @@ EnvironmentImpl::ReadAndSet(const string &varname, StreamTokenizer &st,
            << "infer type for variable " << varname;
     Error(err_ss.str());
   }
-  if (type != "" && inferred_type != "" && type != inferred_type) {
+  if (type != "" && inferred_type != "" && type != inferred_type &&
+      !NumericLiteralConvertible(inferred_type, type) &&
+      !ValueLiteralConvertible(inferred_type, type)) {
     ostringstream err_ss;
     err_ss << "Environment: error: explicit type " << type
            << " and inferred type " << inferred_type
@@ -159,9 +455,54 @@ EnvironmentImpl::ReadAndSet(const string &varname, StreamTokenizer &st,
   // If no explicit type specifier, then the inferred_type is the type.
   string varmap_type = type == "" ? inferred_type : type;
 
-  // Check that varmap_type is a key in var_map_.
-  var_map_[varmap_type]->ReadAndSet(varname, st);
-  types_[varname] = varmap_type;
+  // Check that varmap_type is a known type.
+  VarMapBase *var_map = FindVarMap(varmap_type);
+  if (var_map == nullptr) {
+    ostringstream err_ss;
+    err_ss << "Environment: error: unknown type " << varmap_type
+           << " for variable " << varname;
+    Error(err_ss.str());
+  }
+  var_map->ReadAndSet(varname, st);
+  SetType(varname, varmap_type);
+}
+
+void
+EnvironmentImpl::ReadAndAppend(const string &varname, StreamTokenizer &st) {
+  const string *type = FindType(varname);
+  if (type == nullptr) {
+    ostringstream err_ss;
+    err_ss << "Environment: error: cannot append to undefined variable "
+           << varname;
+    Error(err_ss.str());
+  }
+  if (types_.find(varname) == types_.end()) {
+    CopyVariableFrom(parent_, varname);
+  }
+  FindVarMap(*type)->ReadAndAppend(varname, st);
+}
+
+void
+EnvironmentImpl::CopyVariableFrom(EnvironmentImpl *env, const string &varname) {
+  const string *type = env->FindType(varname);
+  if (type == nullptr) {
+    ostringstream err_ss;
+    err_ss << "Environment: error: cannot copy undefined variable "
+           << varname;
+    Error(err_ss.str());
+  }
+  string varmap_type = *type;
+  env->GetVarMap(varname)->CopyVariableTo(varname, FindVarMap(varmap_type));
+  SetType(varname, varmap_type);
+}
+
+void
+EnvironmentImpl::SetType(const string &varname, const string &type) {
+  string &current_type = types_[varname];
+  if (current_type != type) {
+    current_type = type;
+    ++layout_version_;
+  }
 }
 
 string
@@ -170,6 +511,32 @@ EnvironmentImpl::InferType(const string &varname,
                            bool *is_object_type) {
   *is_object_type = false;
   string next_tok = st.Peek();
+
+  // A literal of a registered value type takes precedence over the
+  // primitive type of its token, unless it names a variable.  A literal
+  // recognized by several value types is ambiguous, and so its type
+  // must be specified explicitly.
+  if (!value_types_->empty() && FindType(next_tok) == nullptr) {
+    const ValueTypeBase *recognized = nullptr;
+    size_t num_recognized = 0;
+    for (unordered_map<string, const ValueTypeBase *>::const_iterator it =
+             value_types_->begin();
+         it != value_types_->end(); ++it) {
+      if (it->second->Recognizes(st.PeekTokenType(), next_tok)) {
+        recognized = it->second;
+        ++num_recognized;
+      }
+    }
+    if (num_recognized > 0) {
+      string type = num_recognized == 1 ? recognized->BaseName() : "";
+      if (debug_ >= 1) {
+        cerr << "Environment::InferType: found value type literal "
+             << next_tok << "; type is \"" << type << "\"" << endl;
+      }
+      return type == "" || !is_vector ? type : type + "[]";
+    }
+  }
+
   switch (st.PeekTokenType()) {
     case StreamTokenizer::RESERVED_WORD:
       if (next_tok == "true" || next_tok == "false") {
@@ -181,16 +548,38 @@ EnvironmentImpl::InferType(const string &varname,
     case StreamTokenizer::STRING:
       return is_vector ? "string[]" : "string";
       break;
+    case StreamTokenizer::BYTES:
+      return is_vector ? "bytes[]" : "bytes";
+      break;
     case StreamTokenizer::NUMBER:
       {
-        // If a token is a NUMBER, it is a double iff it contains a
-        // decimal point.
+        // A NUMBER token with a C++-style suffix is a float ("f"),
+        // an unsigned 64-bit integer ("u", "ul" or "ull") or a signed
+        // 64-bit integer ("l" or "ll").
+        size_t suffix_pos = next_tok.find_last_not_of("fFuUlL");
+        string suffix = suffix_pos == string::npos ?
+            "" : next_tok.substr(suffix_pos + 1);
+        if (suffix == "f" || suffix == "F") {
+          return is_vector ? "float[]" : "float";
+        } else if (suffix.find_first_of("uU") != string::npos) {
+          return is_vector ? "uint64[]" : "uint64";
+        } else if (suffix.find_first_of("lL") != string::npos) {
+          return is_vector ? "int64[]" : "int64";
+        }
+
+        // Otherwise, a NUMBER token is a double iff it contains a
+        // decimal point, and an integer too large for an int is an int64.
         size_t dot_pos = next_tok.find('.');
         if (dot_pos != string::npos) {
           return is_vector ? "double[]" : "double";
-        } else {
-          return is_vector ? "int[]" : "int";
         }
+        errno = 0;
+        long long value = strtoll(next_tok.c_str(), nullptr, 10);
+        if (errno == ERANGE || value < std::numeric_limits<int>::min() ||
+            value > std::numeric_limits<int>::max()) {
+          return is_vector ? "int64[]" : "int64";
+        }
+        return is_vector ? "int[]" : "int";
       }
       break;
     case StreamTokenizer::IDENTIFIER:
@@ -199,10 +588,11 @@ EnvironmentImpl::InferType(const string &varname,
 
         // Find out if next_tok is a concrete typename or a variable.
         unordered_map<string, string>::const_iterator factory_type_it =
-            concrete_to_factory_type_.find(next_tok);
-        unordered_map<string, string>::const_iterator var_type_it =
-            types_.find(next_tok);
-        if (factory_type_it != concrete_to_factory_type_.end()) {
+            concrete_to_factory_type_->find(next_tok);
+        const string *var_type = FindType(next_tok);
+        unordered_map<string, string>::const_iterator enum_type_it =
+            enum_value_to_type_->find(next_tok);
+        if (factory_type_it != concrete_to_factory_type_->end()) {
           // Set type to be abstract factory type.
           if (debug_ >= 1) {
             cerr << "Environment::InferType: concrete type is " << next_tok
@@ -218,21 +608,34 @@ EnvironmentImpl::InferType(const string &varname,
                  << (is_vector ? "is" : "isn't")
                  << " a vector, so final inferred type is " << type << endl;
           }
-        } else if (var_type_it != types_.end()) {
+        } else if (var_type != nullptr) {
           // Could be a variable, in which case we need not only to return
           // the variable's type, but also set is_object_type and is_vector
           // based on the variable's type string.
           string append = is_vector ? "[]" : "";
-          type = var_type_it->second + append;
+          type = *var_type + append;
           if (debug_ >= 1) {
             cerr << "Environment::InferType: found variable "
-                 << var_type_it->first << " of type " << var_type_it->second
+                 << next_tok << " of type " << *var_type
                  << "; type is " << type << endl;
           }
+        } else if (enum_type_it != enum_value_to_type_->end()) {
+          // A value of an enumerated type.  If the value name is
+          // ambiguous, the type must be specified explicitly.
+          if (enum_type_it->second != "") {
+            string append = is_vector ? "[]" : "";
+            type = enum_type_it->second + append;
+          }
+          if (debug_ >= 1) {
+            cerr << "Environment::InferType: found enum value "
+                 << enum_type_it->first << "; type is \"" << type << "\""
+                 << endl;
+          }
         } else {
           ostringstream err_ss;
           err_ss << "Environment: error: token " << next_tok
-                 << " is neither a variable nor a concrete object typename";
+                 << " is neither a variable, a concrete object typename "
+                 << "nor an enum value";
           Error(err_ss.str());
         }
         return type;
@@ -244,6 +647,219 @@ EnvironmentImpl::InferType(const string &varname,
   return "";
 }
 
+string
+EnvironmentImpl::InferGeneratorType(const string &varname,
+                                    const string &generator,
+                                    StreamTokenizer &st) {
+  // Consume generator name and open parenthesis.
+  st.Next();
+  st.Next();
+  size_t num_tokens_read = 2;
+  bool is_object_type = false;
+  string type;
+  if (generator == "repeat") {
+    // The type is that of a vector of the repeated value.
+    type = InferType(varname, st, true, &is_object_type);
+  } else if (generator == "file") {
+    // The type of an external array is known only for a .npy file,
+    // from its header; a raw file requires an explicit type.
+    type = InferNpyType(st.PeekTokenType() == StreamTokenizer::STRING ?
+                        st.Peek() : "");
+    // Part of an array, selected by an offset or count, is a vector.
+    if (st.HasNext()) {
+      st.Next();
+      ++num_tokens_read;
+      if (st.Peek() == "," && type.compare(0, 7, "tensor<") == 0) {
+        type = type.substr(7, type.length() - 8) + "[]";
+      }
+    }
+  } else {
+    // The type is that of a vector of the widest of the numeric
+    // arguments, so that, e.g., range(0, 1, 0.25) is a double[].
+    static const char *widening_order[] = {
+      "int[]", "int64[]", "uint64[]", "float[]", "double[]"
+    };
+    const size_t num_types = sizeof(widening_order) / sizeof(const char *);
+    size_t widest = 0;
+    while (st.HasNext() && st.Peek() != ")") {
+      if (st.PeekTokenType() == StreamTokenizer::NUMBER) {
+        string arg_type = InferType(varname, st, true, &is_object_type);
+        for (size_t i = widest; i < num_types; ++i) {
+          if (arg_type == widening_order[i]) {
+            widest = i;
+          }
+        }
+      }
+      st.Next();
+      ++num_tokens_read;
+    }
+    type = widening_order[widest];
+    // The values of linspace are always floating-point.
+    if (generator == "linspace" && type != "float[]") {
+      type = "double[]";
+    }
+  }
+  st.Rewind(num_tokens_read);
+
+  if (debug_ >= 1) {
+    cerr << "Environment::InferGeneratorType: generator " << generator
+         << " has type " << type << endl;
+  }
+  return type;
+}
+
+string
+EnvironmentImpl::InferNpyType(const string &path) {
+  static const char *descrs[] = { "i4", "i8", "u8", "f4", "f8" };
+  static const char *types[] = { "int", "int64", "uint64", "float", "double" };
+  string descr;
+  size_t rank = 0;
+  if (path.length() < 4 || path.substr(path.length() - 4) != ".npy" ||
+      !ExternalArray::PeekNpyType(path, &descr, &rank)) {
+    return "";
+  }
+  for (size_t i = 0; i < sizeof(descrs) / sizeof(const char *); ++i) {
+    if (descr == descrs[i]) {
+      return rank > 1 ?
+          string("tensor<") + types[i] + ">" : string(types[i]) + "[]";
+    }
+  }
+  return "";
+}
+
+bool
+EnvironmentImpl::ElementType(const string &type, string *container,
+                             string *element_type) {
+  size_t length = type.length();
+  if (length > 2 && type.compare(length - 2, 2, "[]") == 0) {
+    *container = "[]";
+    *element_type = type.substr(0, length - 2);
+    return true;
+  }
+  size_t open_pos = type.find('<');
+  if (open_pos != string::npos && type[length - 1] == '>') {
+    *container = type.substr(0, open_pos);
+    *element_type = type.substr(open_pos + 1, length - open_pos - 2);
+    return true;
+  }
+  return false;
+}
+
+string
+EnvironmentImpl::CanonicalType(const string &type) {
+  // Each alias and the name of the type for which it stands.
+  static const char *aliases[][2] = {
+    {"long", "int64"},
+  };
+  int num_aliases = sizeof(aliases)/sizeof(aliases[0]);
+  string container, element_type;
+  bool is_container = ElementType(type, &container, &element_type);
+  const string &base_type = is_container ? element_type : type;
+  for (int i = 0; i < num_aliases; ++i) {
+    if (base_type == aliases[i][0]) {
+      if (!is_container) {
+        return aliases[i][1];
+      }
+      return container == "[]" ?
+          string(aliases[i][1]) + "[]" :
+          container + "<" + aliases[i][1] + ">";
+    }
+  }
+  return type;
+}
+
+bool
+EnvironmentImpl::NumericLiteralConvertible(const string &inferred_type,
+                                           const string &type) {
+  // Containers are convertible when their element types are the same
+  // or convertible.  Additionally, a one-dimensional vector literal may
+  // initialize a tensor or a compact array.
+  string inferred_container, inferred_element_type;
+  string container, element_type;
+  if (ElementType(inferred_type, &inferred_container,
+                  &inferred_element_type) &&
+      ElementType(type, &container, &element_type) &&
+      (inferred_container == container ||
+       (inferred_container == "[]" &&
+        (container == "tensor" || container == "array")))) {
+    return inferred_element_type == element_type ||
+        NumericLiteralConvertible(inferred_element_type, element_type);
+  }
+
+  // An unadorned int literal may initialize any of the wider or
+  // floating-point types, and a double literal may initialize a float.  The
+  // Initializer for the explicit type does the actual parsing, so, for
+  // example, an int literal too large for an int64 is still caught there.
+  static const char *conversions[][2] = {
+    {"int", "int64"},
+    {"int", "uint64"},
+    {"int", "float"},
+    {"int", "double"},
+    {"double", "float"},
+    {"float", "double"},
+  };
+  int num_conversions = sizeof(conversions)/sizeof(conversions[0]);
+  for (int i = 0; i < num_conversions; ++i) {
+    if (inferred_type == conversions[i][0] && type == conversions[i][1]) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool
+EnvironmentImpl::ValueLiteralConvertible(const string &inferred_type,
+                                         const string &type) const {
+  static const char *primitive_types[] = {
+    "bool", "int", "int64", "uint64", "float", "double", "string"
+  };
+  string inferred_element_type = inferred_type;
+  string element_type = type;
+  if (type.length() > 2 && type.compare(type.length() - 2, 2, "[]") == 0) {
+    if (inferred_type.length() <= 2 ||
+        inferred_type.compare(inferred_type.length() - 2, 2, "[]") != 0) {
+      return false;
+    }
+    inferred_element_type =
+        inferred_type.substr(0, inferred_type.length() - 2);
+    element_type = type.substr(0, type.length() - 2);
+  }
+  if (value_types_->count(element_type) == 0) {
+    return false;
+  }
+  int num_primitive_types =
+      sizeof(primitive_types) / sizeof(primitive_types[0]);
+  for (int i = 0; i < num_primitive_types; ++i) {
+    if (inferred_element_type == primitive_types[i]) {
+      return true;
+    }
+  }
+  return false;
+}
+
+MemoryUsageReport
+EnvironmentImpl::MemoryUsage(size_t num_largest) const {
+  MemoryUsageReport report(num_largest);
+  MemoryVisitor visitor;
+  // The environment's own bookkeeping, chiefly the type of every
+  // variable, is reported under a name that cannot be a type name.
+  MemorySize<unordered_map<string, string> > map_size;
+  report.AddTypeOverhead("<environment>", sizeof(*this) +
+                         map_size.HeapBytes(types_, &visitor) +
+                         map_size.HeapBytes(*concrete_to_factory_type_,
+                                            &visitor) +
+                         map_size.HeapBytes(*enum_value_to_type_, &visitor) +
+                         MemorySize<unordered_map<string,
+                                                  const ValueTypeBase *> >()
+                             .HeapBytes(*value_types_, &visitor));
+  for (unordered_map<string, VarMapBase *>::const_iterator it =
+           var_map_.begin();
+       it != var_map_.end(); ++it) {
+    it->second->AddMemoryUsage(&report, &visitor);
+  }
+  return report;
+}
+
 void
 EnvironmentImpl::PrintFactories(ostream &os) const {
   FactoryContainer::Print(os);
@@ -37,6 +37,7 @@
 #ifndef INFACT_ENVIRONMENT_IMPL_H_
 #define INFACT_ENVIRONMENT_IMPL_H_
 
+#include <memory>
 #include <sstream>
 #include <string>
 #include <unordered_map>
@@ -49,10 +50,13 @@
 namespace infact {
 
 using std::ostringstream;
+using std::shared_ptr;
 using std::string;
 using std::unordered_map;
 using std::unordered_set;
 
+class ValueTypeBase;
+
 /// Provides a set of named variables and their types, as well as the values
 /// for those variables.
 ///
@@ -74,10 +78,9 @@ class EnvironmentImpl : public Environment {
   }
 
   /// Returns whether the specified variable has been defined in this
-  /// environment.
+  /// environment or in one of its ancestors.
   virtual bool Defined(const string &varname) const {
-    unordered_map<string, string>::const_iterator it = types_.find(varname);
-    return it != types_.end();
+    return FindType(varname) != nullptr;
   }
 
   /// Sets the specified variable to the value obtained from the following
@@ -85,40 +88,61 @@ class EnvironmentImpl : public Environment {
   virtual void ReadAndSet(const string &varname, StreamTokenizer &st,
                           const string type);
 
+  /// \copydoc infact::Environment::ReadAndAppend
+  ///
+  /// A variable defined only in an ancestor is first copied into this
+  /// environment, so that appending to it never modifies the ancestor.
+  virtual void ReadAndAppend(const string &varname, StreamTokenizer &st);
+
+  /// Sets the specified variable to its value in the specified
+  /// environment, with the same type.  Objects are shared rather than
+  /// constructed again, as are the buffers of values that share them on
+  /// copy, such as <tt>bytes</tt>.
+  ///
+  /// \param env     the environment, which may be an ancestor of this
+  ///                one, in which the variable is defined
+  /// \param varname the name of the variable to copy
+  void CopyVariableFrom(EnvironmentImpl *env, const string &varname);
+
   virtual const string &GetType(const string &varname) const {
-    unordered_map<string, string>::const_iterator type_it =
-        types_.find(varname);
-    if (type_it == types_.end()) {
+    const string *type = FindType(varname);
+    if (type == nullptr) {
       // Error or warning.
     }
-    return type_it->second;
+    return *type;
   }
 
   virtual VarMapBase *GetVarMap(const string &varname) {
+    // A variable not defined here lives in the VarMap of the nearest
+    // ancestor that defines it.
+    if (parent_ != nullptr && types_.find(varname) == types_.end()) {
+      return parent_->GetVarMap(varname);
+    }
     return GetVarMapForType(GetType(varname));
   }
 
   /// Retrieves the VarMap instance for the specified type.
   virtual VarMapBase *GetVarMapForType(const string &type) {
-    string lookup_type = type;
+    string lookup_type = CanonicalType(type);
     // First, check if this is a concrete Factory-constructible type.
     // If so, map to its abstract type name.
     unordered_map<string, string>::const_iterator factory_type_it =
-        concrete_to_factory_type_.find(type);
-    if (factory_type_it != concrete_to_factory_type_.end()) {
+        concrete_to_factory_type_->find(lookup_type);
+    if (factory_type_it != concrete_to_factory_type_->end()) {
       lookup_type = factory_type_it->second;
     }
-
-    unordered_map<string, VarMapBase *>::const_iterator var_map_it =
-        var_map_.find(lookup_type);
-    if (var_map_it == var_map_.end()) {
-      return nullptr;
-    }
-    return var_map_it->second;
+    return FindVarMap(lookup_type);
   }
 
   /// \copydoc infact::Environment::Print
+  ///
+  /// The variables of a child environment are printed after those of
+  /// its ancestors, so that a variable it shadows is printed twice,
+  /// with its final value last.
   virtual void Print(ostream &os) const {
+    if (parent_ != nullptr) {
+      parent_->Print(os);
+    }
     for (unordered_map<string, VarMapBase *>::const_iterator var_map_it =
              var_map_.begin();
          var_map_it != var_map_.end(); ++var_map_it) {
@@ -129,16 +153,18 @@ class EnvironmentImpl : public Environment {
   /// \copydoc infact::Environment::PrintFactories
   virtual void PrintFactories(ostream &os) const;
 
+  /// \copydoc infact::Environment::MemoryUsage
+  virtual MemoryUsageReport MemoryUsage(size_t num_largest = 10) const;
+
   /// \copydoc infact::Environment::Copy
-  virtual Environment *Copy() const {
-    EnvironmentImpl *new_env = new EnvironmentImpl(*this);
-    // Now go through and create copies of each VarMap.
-    for (unordered_map<string, VarMapBase *>::iterator new_env_var_map_it =
-             new_env->var_map_.begin();
-         new_env_var_map_it != new_env->var_map_.end(); ++new_env_var_map_it) {
-      new_env_var_map_it->second = new_env_var_map_it->second->Copy(new_env);
-    }
-    return new_env;
+  ///
+  /// The copy of a child environment holds the variables of all its
+  /// ancestors and has no parent.
+  virtual Environment *Copy() const;
+
+  /// \copydoc infact::Environment::CreateChild
+  virtual Environment *CreateChild() {
+    return new EnvironmentImpl(this);
   }
 
   /// Retrieves the value of the variable with the specified name and puts
@@ -152,22 +178,153 @@ class EnvironmentImpl : public Environment {
   template<typename T>
   bool Get(const string &varname, T *value) const;
 
+  /// Returns a pointer to the value of the variable with the specified
+  /// name, or <tt>nullptr</tt> if there is no such variable or it is
+  /// not of type <tt>T</tt>.  The pointer remains valid, and reflects
+  /// later assignments of values of the same type to the variable, for
+  /// the lifetime of this environment.
+  ///
+  /// \param varname the name of the variable whose value is to be found
+  template<typename T>
+  const T *Find(const string &varname) const;
+
+  /// Returns a count of the changes to the variables of this environment
+  /// and its ancestors and to their types.  It increases whenever a
+  /// variable is first defined, is assigned a value of a different type
+  /// or is erased, so that while it is unchanged, every pointer returned
+  /// by \link Find \endlink remains valid and of the right type.
+  size_t layout_version() const {
+    return layout_version_ +
+        (parent_ == nullptr ? 0 : parent_->layout_version());
+  }
+
+  /// Sets <tt>hash</tt> to a hash of the type and the content of the
+  /// value of the specified variable, such that a new value assigned to
+  /// the variable almost certainly changes the hash.  Objects are hashed
+  /// by identity.
+  ///
+  /// \return whether the specified variable is defined
+  bool HashValue(const string &varname, size_t *hash) const;
+
+  /// Returns the approximate number of bytes held by the value of the
+  /// specified variable of this environment, or zero if there is no
+  /// such variable.
+  size_t ValueBytes(const string &varname) const;
+
+  /// Returns whether the value of the specified variable of this
+  /// environment shares ownership of an object with code outside this
+  /// environment, such as a caller still holding a <tt>shared_ptr</tt>
+  /// retrieved with \link Get\endlink.
+  bool Shared(const string &varname) const;
+
+  /// Removes the specified variable from this environment.  Pointers
+  /// to its value returned by \link Find \endlink become invalid.
+  ///
+  /// \return whether this environment defined the variable
+  bool Erase(const string &varname);
+
  private:
+  /// Constructs a new, empty child of the specified environment.
+  explicit EnvironmentImpl(EnvironmentImpl *parent);
+
+  /// Returns the VarMap holding the specified variable of this
+  /// environment, not including its ancestors, or <tt>nullptr</tt> if
+  /// there is no such variable.
+  VarMapBase *VarMapOf(const string &varname) const;
+
+  /// Returns a pointer to the type of the specified variable, as
+  /// defined in this environment or its nearest ancestor defining it,
+  /// or <tt>nullptr</tt> if there is no such variable.
+  const string *FindType(const string &varname) const;
+
+  /// Returns the VarMap of this environment for the specified type, or
+  /// <tt>nullptr</tt> if there is no such type.  A child environment
+  /// creates its VarMap for a type the first time it is needed.
+  VarMapBase *FindVarMap(const string &type);
+
+  /// Records the type of the specified variable of this environment,
+  /// advancing the \link layout_version \endlink if it is new or changed.
+  void SetType(const string &varname, const string &type);
+
   /// Infer the type based on the next token and its token type.
   string InferType(const string &varname,
                    const StreamTokenizer &st, bool is_vector,
                    bool *is_object_type);
 
+  /// Infers the type of the generator expression with the specified
+  /// name, such as <tt>range(0, 10)</tt>, that begins at the next
+  /// token.  The stream is left unchanged.
+  string InferGeneratorType(const string &varname, const string &generator,
+                            StreamTokenizer &st);
+
+  /// Returns the type of the array held in the specified <tt>.npy</tt>
+  /// file, such as <tt>"double[]"</tt> or <tt>"tensor<float>"</tt>, or
+  /// the empty string if the file is not a readable <tt>.npy</tt> file
+  /// of a supported element type.
+  static string InferNpyType(const string &path);
+
+  /// Returns whether a literal whose inferred type is
+  /// <tt>inferred_type</tt> may be used to initialize a variable whose
+  /// explicit type is <tt>type</tt>, such as an <tt>int</tt> literal
+  /// for an <tt>int64</tt> or <tt>double</tt> variable, a
+  /// <tt>double</tt> literal for a <tt>float</tt> variable or a
+  /// <tt>double[]</tt> literal for a <tt>tensor<double></tt> variable.
+  static bool NumericLiteralConvertible(const string &inferred_type,
+                                        const string &type);
+
+  /// Returns whether a literal whose inferred type is
+  /// <tt>inferred_type</tt> may be used to initialize a variable whose
+  /// explicit type is <tt>type</tt> because <tt>type</tt>, or its
+  /// element type, is a registered value type, whose \link Initializer
+  /// \endlink decodes literals of any primitive type.
+  bool ValueLiteralConvertible(const string &inferred_type,
+                               const string &type) const;
+
+  /// If the specified type is a vector type (such as <tt>"int[]"</tt>)
+  /// or another container type (such as <tt>"map<int>"</tt>), sets
+  /// <tt>container</tt> to <tt>"[]"</tt> or the name of the container
+  /// (such as <tt>"map"</tt>) and <tt>element_type</tt> to the type of
+  /// its elements and returns <tt>true</tt>; otherwise, returns
+  /// <tt>false</tt>.
+  static bool ElementType(const string &type, string *container,
+                          string *element_type);
+
+  /// Returns the name under which variables of the specified type are
+  /// held, which differs from the specified name only for an alias or a
+  /// container of one, such as <tt>"long[]"</tt> for <tt>"int64[]"</tt>.
+  static string CanonicalType(const string &type);
+
   /// A map from all variable names to their types.
   unordered_map<string, string> types_;
 
   /// A map from type name strings (as returned by the \link TypeName \endlink
-  /// method) to VarMap instances for those types.
+  /// method) to VarMap instances for those types.  A child environment
+  /// holds only the VarMaps for the types of its own variables.
   unordered_map<string, VarMapBase *> var_map_;
 
+  /// The environment whose variables are visible in this one, or
+  /// <tt>nullptr</tt> if this is not a child environment.
+  EnvironmentImpl *parent_;
+
   /// A map from concrete Factory-constructible type names to their abstract
-  /// Factory type names.
-  unordered_map<string, string> concrete_to_factory_type_;
+  /// Factory type names, shared by all copies and children of an
+  /// environment.
+  shared_ptr<const unordered_map<string, string> > concrete_to_factory_type_;
+
+  /// A map from the names of values of registered enumerated types to
+  /// the names of their types, or to the empty string if a name is
+  /// shared by several enumerated types.  This map is shared by all
+  /// copies and children of an environment.
+  shared_ptr<const unordered_map<string, string> > enum_value_to_type_;
+
+  /// A map from the names of registered value types to their
+  /// descriptions, shared by all copies and children of an environment.
+  shared_ptr<const unordered_map<string, const ValueTypeBase *> >
+      value_types_;
+
+  /// The count of changes to the variables of this environment and their
+  /// types; see \link layout_version\endlink.
+  size_t layout_version_;
 
   int debug_;
 };
@@ -177,6 +334,9 @@ bool
 EnvironmentImpl::Get(const string &varname, T *value) const {
   unordered_map<string, string>::const_iterator type_it =
       types_.find(varname);
+  if (type_it == types_.end() && parent_ != nullptr) {
+    return parent_->Get(varname, value);
+  }
   if (type_it == types_.end()) {
     if (debug_ >= 1) {
       ostringstream err_ss;
@@ -201,6 +361,7 @@ EnvironmentImpl::Get(const string &varname, T *value) const {
 
   // Do a dynamic_cast down to the type-specific VarMap.
   VarMapBase *var_map = var_map_it->second;
+  INFACT_STATS_INC(dynamic_casts);
   VarMap<T> *typed_var_map = dynamic_cast<VarMap<T> *>(var_map);
 
   if (typed_var_map == nullptr) {
@@ -222,6 +383,25 @@ EnvironmentImpl::Get(const string &varname, T *value) const {
   return success;
   }
 
+template<typename T>
+const T *
+EnvironmentImpl::Find(const string &varname) const {
+  unordered_map<string, string>::const_iterator type_it =
+      types_.find(varname);
+  if (type_it == types_.end()) {
+    return parent_ == nullptr ? nullptr : parent_->Find<T>(varname);
+  }
+  unordered_map<string, VarMapBase*>::const_iterator var_map_it =
+      var_map_.find(type_it->second);
+  if (var_map_it == var_map_.end()) {
+    return nullptr;
+  }
+  INFACT_STATS_INC(dynamic_casts);
+  const VarMap<T> *typed_var_map =
+      dynamic_cast<const VarMap<T> *>(var_map_it->second);
+  return typed_var_map == nullptr ? nullptr : typed_var_map->Find(varname);
+}
+
 }  // namespace infact
 
 #endif
@@ -32,17 +32,1293 @@
 /// Test driver for the Environment class.
 /// \author dbikel@google.com (Dan Bikel)
 
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <limits>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <unistd.h>
 
+#include "access-profile.h"
+#include "alloc-counter.h"
+#include "binding.h"
+#include "bytes.h"
+#include "concurrent-environment.h"
+#include "config-holder.h"
 #include "environment-impl.h"
+#include "example.h"
+#include "external-array.h"
+#include "factory.h"
+#include "file-loader.h"
+#include "interpreter.h"
+#include "stream-tokenizer.h"
+#include "string-array.h"
+#include "tensor.h"
 
 using namespace std;
 using namespace infact;
 
+/// Checks the allocations made within the specified scope against the
+/// specified budget, reporting the outcome to <tt>cerr</tt>.
+///
+/// \param name            the name of the scenario being measured
+/// \param scope           the scope whose allocations are to be checked
+/// \param max_allocations the maximum number of allocations permitted
+/// \param max_bytes       the maximum number of bytes permitted
+/// \return whether the allocations were within budget
+bool
+CheckBudget(const string &name, const AllocationScope &scope,
+            size_t max_allocations, size_t max_bytes) {
+  size_t allocations = scope.allocations();
+  size_t bytes = scope.bytes();
+  bool ok = allocations <= max_allocations && bytes <= max_bytes;
+  cerr << (ok ? "PASS" : "FAIL") << " " << name << ": "
+       << allocations << " allocations (budget " << max_allocations << "), "
+       << bytes << " bytes (budget " << max_bytes << ")" << endl;
+  return ok;
+}
+
+/// Asserts allocation budgets for the most common parsing and
+/// construction paths, so that regressions are caught as they happen.
+/// Budgets leave roughly 50% headroom over the measured counts; when a
+/// change legitimately improves a count, tighten its budget.
+///
+/// \return whether all scenarios were within budget
+bool
+TestAllocationBudgets() {
+  bool ok = true;
+
+  // A tokenizer pass over N bytes.
+  const size_t kNumTokenizerTerms = 1000;
+  ostringstream oss;
+  for (size_t i = 0; i < kNumTokenizerTerms; ++i) {
+    oss << "foo(bar(" << i << "), \"baz\"), ";
+  }
+  string input = oss.str();
+  {
+    AllocationScope scope;
+    StreamTokenizer st(input);
+    while (st.HasNext()) {
+      st.Next();
+    }
+    ok &= CheckBudget("tokenizer/" + to_string(input.size()) + "-bytes",
+                      scope, 100, 5000000);
+  }
+
+  // Construction of an EnvironmentImpl.
+  {
+    AllocationScope scope;
+    Environment *env = new EnvironmentImpl();
+    delete env;
+    ok &= CheckBudget("environment/construct", scope, 170, 16000);
+  }
+
+  // CreateOrDie of a PersonImpl with a nested DateImpl.
+  {
+    Factory<Person> factory;
+    string spec = "PersonImpl(name(\"Fred\"), cm_height(180), "
+        "birthday(DateImpl(year(1970), month(11), day(5))))";
+    AllocationScope scope;
+    shared_ptr<Person> person = factory.CreateOrDie(spec, "person");
+    ok &= CheckBudget("factory/person", scope, 300, 43000);
+  }
+
+  // A K-element int[] literal.
+  const size_t kNumElements = 1000;
+  ostringstream literal;
+  literal << "int[] v = {";
+  for (size_t i = 0; i < kNumElements; ++i) {
+    literal << (i > 0 ? ", " : "") << i;
+  }
+  literal << "};";
+  {
+    Interpreter interpreter;
+    AllocationScope scope;
+    interpreter.EvalString(literal.str());
+    ok &= CheckBudget("interpreter/int-vector-" + to_string(kNumElements),
+                      scope, 14000, 1900000);
+  }
+  return ok;
+}
+
+/// Returns whether reading the specified value for a variable of the
+/// specified type throws an exception.
+///
+/// \param env   the environment in which to read the value
+/// \param type  the explicit type of the variable, or the empty string
+///              to infer it
+/// \param value the text of the value
+bool
+ReadThrows(EnvironmentImpl *env, const string &type, const string &value) {
+  try {
+    StreamTokenizer st(value);
+    env->ReadAndSet("____read_throws____", st, type);
+  } catch (const std::runtime_error &e) {
+    return true;
+  }
+  return false;
+}
+
+/// A configuration struct for testing \link infact::Binding Binding\endlink.
+struct TestConfig {
+  int timeout;
+  string backend;
+  vector<double> weights;
+  shared_ptr<Animal> animal;
+};
+
+/// Checks that a \link infact::Binding Binding \endlink fills in
+/// fields, picks up reassigned and newly defined values on refresh and
+/// rejects variables of the wrong type, including retyped ones.
+///
+/// \return whether all checks passed
+bool
+TestBinding() {
+  Interpreter interpreter;
+  interpreter.EvalString("timeout = 30; backend = \"db\"; "
+                         "a = Cow(name(\"Bessie\"));");
+  Binding<TestConfig> binding;
+  binding.Add("timeout", &TestConfig::timeout)
+         .Add("backend", &TestConfig::backend)
+         .Add("weights", &TestConfig::weights, false)
+         .Add("a", &TestConfig::animal);
+  TestConfig config;
+  config.weights.push_back(1.0);
+  binding.Bind(interpreter.env(), &config);
+  bool ok = config.timeout == 30 && config.backend == "db" &&
+      config.weights.size() == 1 && config.animal->name() == "Bessie";
+
+  interpreter.EvalString("timeout = 45;");
+  binding.Refresh(&config);
+  ok &= config.timeout == 45;
+
+  // An optional variable defined after binding is picked up.
+  interpreter.EvalString("weights = {0.5, 0.25};");
+  binding.Refresh(&config);
+  ok &= config.weights.size() == 2 && config.weights[1] == 0.25;
+
+  // A variable retyped after binding is an error, not a stale value.
+  interpreter.EvalString("backend = 5;");
+  bool refresh_threw = false;
+  try {
+    binding.Refresh(&config);
+  } catch (const std::runtime_error &e) {
+    refresh_threw = true;
+  }
+  ok &= refresh_threw && config.backend == "db";
+
+  Binding<TestConfig> mistyped;
+  mistyped.Add("timeout", &TestConfig::backend);
+  bool threw = false;
+  try {
+    mistyped.Bind(interpreter.env(), &config);
+  } catch (const std::runtime_error &e) {
+    threw = true;
+  }
+  ok &= threw;
+  cerr << (ok ? "PASS" : "FAIL") << " binding" << endl;
+  return ok;
+}
+
+/// Checks that subscription callbacks run once per evaluation for each
+/// changed variable, and not at all for unchanged ones.
+///
+/// \return whether all checks passed
+bool
+TestSubscriptions() {
+  Interpreter interpreter;
+  interpreter.EvalString("x = 1; v = {1, 2}; a = Cow(name(\"Bessie\"));");
+  map<string, int> calls;
+  Interpreter::Callback count = [&calls](const string &varname) {
+    ++calls[varname];
+  };
+  interpreter.Subscribe("x", count);
+  interpreter.Subscribe("v", count);
+  interpreter.Subscribe("a", count);
+  size_t id = interpreter.Subscribe("y", count);
+
+  // Assigning the same values is not a change, except for objects.
+  interpreter.EvalString("x = 1; v = {1, 2}; a = Cow(name(\"Bessie\"));");
+  bool ok = calls.size() == 1 && calls["a"] == 1;
+
+  // Several assignments in one evaluation are coalesced.
+  calls.clear();
+  interpreter.EvalString("x = 2; x = 3; v = {1, 3}; y = 1;");
+  ok &= calls.size() == 3 && calls["x"] == 1 && calls["v"] == 1 &&
+      calls["y"] == 1;
+
+  calls.clear();
+  interpreter.Unsubscribe(id);
+  interpreter.EvalString("y = 2;");
+  ok &= calls.empty();
+
+  // Reassigning an object twice is a change, even when the last object
+  // is allocated where the one seen by the subscription was.
+  interpreter.EvalString("a = Cow(name(\"one\"));");
+  calls.clear();
+  interpreter.EvalString("a = Cow(name(\"two\")); a = Cow(name(\"three\"));");
+  ok &= calls.size() == 1 && calls["a"] == 1;
+  cerr << (ok ? "PASS" : "FAIL") << " subscriptions" << endl;
+  return ok;
+}
+
+/// Checks that a lazy interpreter builds only the variables retrieved
+/// and their dependencies, and that an access profile recorded by one
+/// interpreter warms up another.
+///
+/// \return whether all checks passed
+bool
+TestLazyEvaluation() {
+  string spec = "x = 1; a = Cow(name(\"Bessie\")); "
+      "o = HumanPetOwner(pets({a})); s = \"unused\";";
+  AccessProfile profile;
+  Interpreter interpreter;
+  interpreter.set_lazy(true);
+  interpreter.RecordAccesses(&profile);
+  interpreter.EvalString(spec);
+  EnvironmentImpl *env = interpreter.env();
+  bool ok = !env->Defined("x") && !env->Defined("o");
+  shared_ptr<PetOwner> owner;
+  ok &= interpreter.Get("o", &owner) && owner->GetNumberOfPets() == 1;
+  ok &= env->Defined("a") && !env->Defined("x") && !env->Defined("s");
+
+  // A reassigned variable makes evaluation eager.
+  interpreter.EvalString("y = 1; y = 2;");
+  ok &= env->Defined("y") && env->Defined("x") && env->Defined("s");
+
+  ostringstream profile_oss;
+  profile.Write(profile_oss);
+  AccessProfile read_profile;
+  istringstream profile_iss(profile_oss.str());
+  ok &= read_profile.Read(profile_iss) && read_profile.size() == 1;
+
+  Interpreter warm_interpreter;
+  warm_interpreter.set_lazy(true);
+  warm_interpreter.EvalString(spec);
+  warm_interpreter.WarmUp(read_profile);
+  ok &= warm_interpreter.env()->Defined("o") &&
+      !warm_interpreter.env()->Defined("x");
+  cerr << (ok ? "PASS" : "FAIL") << " lazy evaluation" << endl;
+  return ok;
+}
+
+/// Checks that a memory budget evicts lazily built variables in
+/// least-recently-used order, spares pinned objects and rebuilds
+/// evicted variables on demand.
+///
+/// \return whether all checks passed
+bool
+TestMemoryBudget() {
+  Interpreter interpreter;
+  interpreter.set_lazy(true);
+  // Each vector holds about 4KB, so that only two fit in the budget.
+  interpreter.set_memory_budget(10000);
+  interpreter.EvalString("v0 = range(0, 1000); v1 = range(0, 1000); "
+                         "v2 = range(0, 1000); c = Cow(name(\"Bessie\"));");
+  EnvironmentImpl *env = interpreter.env();
+  vector<int> v;
+  bool ok = interpreter.Get("v0", &v) && interpreter.Get("v1", &v) &&
+      interpreter.Get("v2", &v);
+  ok &= !env->Defined("v0") && env->Defined("v1") && env->Defined("v2");
+
+  // Retrieving v0 again rebuilds it, evicting v1; retrieving it once
+  // more is a hit.
+  ok &= interpreter.Get("v0", &v) && v.size() == 1000;
+  ok &= interpreter.Get("v0", &v);
+  ok &= env->Defined("v0") && !env->Defined("v1");
+
+  // A pinned object survives even a budget it exceeds on its own.
+  interpreter.set_memory_budget(1);
+  shared_ptr<Animal> cow;
+  ok &= interpreter.Get("c", &cow);
+  ok &= interpreter.Get("v2", &v);
+  ok &= env->Defined("c") && env->Defined("v2") && !env->Defined("v0");
+  cow.reset();
+  ok &= interpreter.Get("v1", &v);
+  ok &= !env->Defined("c");
+
+  const MemoryBudget::Counters &counters =
+      interpreter.memory_budget()->counters();
+  ok &= counters.hits == 1 && counters.misses == 7 &&
+      counters.rebuilds == 3 && counters.evictions == 6;
+  cerr << (ok ? "PASS" : "FAIL") << " memory budget" << endl;
+  if (!ok) {
+    counters.Print(cerr);
+  }
+  return ok;
+}
+
+/// Checks that a string array can be read from a specification, is
+/// smaller than the equivalent vector of strings, and gives the same
+/// elements and lookups once front-coded.
+///
+/// \return whether all checks passed
+bool
+TestStringArray() {
+  Interpreter interpreter;
+  interpreter.EvalString("array<string> vocab = {\"the\", \"of\", \"and\"};"
+                         "array<string> copy = vocab;");
+  StringArray vocab;
+  bool ok = interpreter.Get("copy", &vocab) && vocab.size() == 3 &&
+      vocab[1] == StringRef("of") && vocab.Find(StringRef("and")) == 2 &&
+      vocab.Find(StringRef("a")) == StringArray::npos && !vocab.sorted();
+  ok &= ValueString<StringArray>().ToString(vocab) ==
+      "{\"the\", \"of\", \"and\"}";
+
+  vector<string> words;
+  StringArray array;
+  for (int i = 0; i < 10000; ++i) {
+    ostringstream oss;
+    oss << "word" << (100000 + i);
+    words.push_back(oss.str());
+    array.Append(StringRef(oss.str()));
+  }
+  array.ShrinkToFit();
+  MemoryVisitor visitor;
+  size_t vector_bytes = MemorySize<vector<string> >().HeapBytes(words,
+                                                                &visitor);
+  size_t array_bytes = MemorySize<StringArray>().HeapBytes(array, &visitor);
+  ok &= array.sorted() && 2 * array_bytes < vector_bytes;
+
+  size_t hash = ValueHash<StringArray>().Hash(array);
+  ok &= array.FrontCode() && array.front_coded();
+  size_t coded_bytes = array.capacity_bytes();
+  ok &= coded_bytes < array_bytes &&
+      ValueHash<StringArray>().Hash(array) == hash;
+  size_t i = 0;
+  for (StringArray::const_iterator it = array.begin(); it != array.end();
+       ++it, ++i) {
+    ok &= *it == StringRef(words[i]);
+  }
+  ok &= i == words.size() && array.Get(4321) == words[4321] &&
+      array.Find(StringRef(words[0])) == 0 &&
+      array.Find(StringRef(words[9999])) == 9999 &&
+      array.Find(StringRef(words[1234])) == 1234 &&
+      array.Find(StringRef("word")) == StringArray::npos &&
+      array.Find(StringRef("zebra")) == StringArray::npos;
+  cerr << (ok ? "PASS" : "FAIL") << " string array: " << vector_bytes
+       << " bytes as vector, " << array_bytes << " bytes as array, "
+       << coded_bytes << " bytes front-coded" << endl;
+  return ok;
+}
+
+/// Checks that a file loader delivers requested files to callbacks
+/// and to later claims, and that an interpreter reads the files of
+/// <tt>file(...)</tt> expressions through its loader.
+///
+/// \return whether all checks passed
+bool
+TestFileLoader() {
+  const size_t num_files = 20;
+  vector<string> paths;
+  for (size_t i = 0; i < num_files; ++i) {
+    ostringstream path_ss;
+    path_ss << "/tmp/infact-file-loader-test-" << i << ".bin";
+    paths.push_back(path_ss.str());
+    vector<double> values(i + 1, static_cast<double>(i));
+    ofstream file(paths[i].c_str(), std::ios::binary);
+    file.write(reinterpret_cast<const char *>(values.data()),
+               values.size() * sizeof(double));
+  }
+
+  bool ok = true;
+  // Reads the files both through io_uring, where it is available, and
+  // on a thread pool.
+  for (int use_io_uring = 0; use_io_uring < 2; ++use_io_uring) {
+    std::mutex mutex;
+    map<string, size_t> delivered;
+    {
+      FileLoader loader(4, use_io_uring != 0);
+      FileLoader::Callback callback =
+          [&mutex, &delivered](const string &path,
+                               const FileContents &contents) {
+        std::lock_guard<std::mutex> lock(mutex);
+        delivered[path] = contents.size;
+      };
+      for (size_t i = 0; i < num_files; ++i) {
+        loader.Request(paths[i]);
+      }
+      loader.Request("/nonexistent/infact-file");
+      loader.Request(paths[0], callback);
+      loader.Request(paths[1], callback);
+      ok &= loader.uses_io_uring() ==
+          (use_io_uring != 0 && FileLoader::IoUringSupported());
+      for (size_t i = 0; i < num_files; ++i) {
+        FileContents contents = loader.Get(paths[i]);
+        const double *values =
+            reinterpret_cast<const double *>(contents.data.get());
+        ok &= contents.ok() && contents.size == (i + 1) * sizeof(double) &&
+            values[i] == static_cast<double>(i) &&
+            reinterpret_cast<uintptr_t>(values) % 64 == 0;
+      }
+      ok &= !loader.Get("/nonexistent/infact-file").ok();
+    }
+    // Destroying the loader waits for callbacks already running.
+    ok &= delivered.size() == 2 && delivered[paths[0]] == sizeof(double) &&
+        delivered[paths[1]] == 2 * sizeof(double);
+  }
+  FileLoader loader;
+  ok &= !loader.Get("/nonexistent/infact-file").ok();
+
+  // A specification file that cannot be read is an error, rather than
+  // an empty specification.
+  bool threw = false;
+  try {
+    Interpreter missing_interpreter;
+    missing_interpreter.Eval("/nonexistent/infact-spec.infact");
+  } catch (std::runtime_error &e) {
+    threw = true;
+  }
+  ok &= threw;
+  const string spec_path = "/tmp/infact-file-loader-test.infact";
+  {
+    ofstream spec(spec_path.c_str());
+    spec << "double[] c = file(\"" << paths[2] << "\"); d = 7;";
+  }
+  Interpreter file_interpreter;
+  file_interpreter.Eval(spec_path);
+  vector<double> c;
+  int d = 0;
+  ok &= file_interpreter.Get("c", &c) && c.size() == 3 && c[2] == 2.0 &&
+      file_interpreter.Get("d", &d) && d == 7;
+  remove(spec_path.c_str());
+
+  Interpreter interpreter;
+  interpreter.EvalString("double[] a = file(\"" + paths[3] + "\");"
+                         "double[] b = file(\"" + paths[5] + "\", 8);");
+  vector<double> a, b;
+  ok &= interpreter.Get("a", &a) && a.size() == 4 && a[3] == 3.0 &&
+      interpreter.Get("b", &b) && b.size() == 5 && b[0] == 5.0;
+
+  // Only generators count, not members that happen to be named file.
+  vector<string> references;
+  ok &= FindFileReferences("x = Cow(file(\"a\")); y = {file(\"b\"), "
+                           "range(0, 2)}; z = Cow(w(file(p)));",
+                           &references) == 2 &&
+      references.size() == 1 && references[0] == "b";
+
+  // A malformed token stops evaluation only where it occurs.
+  Interpreter partial_interpreter;
+  partial_interpreter.EvalString("a = 1; b = 2; c = b64\"@@@@\";");
+  ok &= partial_interpreter.env()->Defined("a") &&
+      partial_interpreter.env()->Defined("b");
+
+  for (size_t i = 0; i < num_files; ++i) {
+    remove(paths[i].c_str());
+  }
+  cerr << (ok ? "PASS" : "FAIL") << " file loader" << endl;
+  return ok;
+}
+
+/// Writes a <tt>.npy</tt> file whose header is padded, as NumPy pads it,
+/// so that the array data begins at a multiple of 64 bytes.
+///
+/// \param path          the path of the file to write
+/// \param major_version the format version, whose header length field
+///                      has two bytes if it is 1 and four otherwise
+/// \param header        the header dictionary, without padding
+/// \param data          the array data
+/// \param size          the number of bytes of array data
+void
+WriteNpy(const string &path, int major_version, const string &header,
+         const void *data, size_t size) {
+  size_t preamble_length = major_version == 1 ? 10 : 12;
+  size_t data_start = (preamble_length + header.size() + 64) / 64 * 64;
+  string padded = header;
+  padded.resize(data_start - preamble_length - 1, ' ');
+  padded += '\n';
+  string preamble("\x93NUMPY", 6);
+  preamble += static_cast<char>(major_version);
+  preamble += '\0';
+  preamble += static_cast<char>(padded.size());
+  preamble.append(preamble_length - 9, '\0');
+  ofstream file(path.c_str(), std::ios::binary);
+  file << preamble << padded;
+  file.write(static_cast<const char *>(data), size);
+}
+
+/// Checks that <tt>file(...)</tt> expressions parse <tt>.npy</tt>
+/// headers of both format versions, byte-swap non-native elements,
+/// infer a tensor type for arrays of rank two or more and a vector
+/// type otherwise, map aligned native data in place and reject bad
+/// offsets and counts, mismatched or malformed headers and shapes whose
+/// size overflows.
+///
+/// \return whether all checks passed
+bool
+TestExternalArrays() {
+  char dir_template[] = "/tmp/infact-external-array-test-XXXXXX";
+  if (mkdtemp(dir_template) == nullptr) {
+    cerr << "FAIL external arrays: could not create directory" << endl;
+    return false;
+  }
+  const string dir = dir_template;
+  vector<string> paths;
+  const double matrix[] = { 1.0, 2.0, 3.0, 4.0, 5.0, 6.0 };
+  paths.push_back(dir + "/matrix.npy");
+  WriteNpy(paths.back(), 1,
+           "{'descr': '<f8', 'fortran_order': False, 'shape': (2, 3), }",
+           matrix, sizeof(matrix));
+  // The big-endian encoding of the doubles 1.5 and -2.0.
+  const uint8_t big_endian[] = {
+    0x3f, 0xf8, 0, 0, 0, 0, 0, 0, 0xc0, 0x00, 0, 0, 0, 0, 0, 0,
+  };
+  paths.push_back(dir + "/big-endian.npy");
+  WriteNpy(paths.back(), 2,
+           "{'descr': '>f8', 'fortran_order': False, 'shape': (2,), }",
+           big_endian, sizeof(big_endian));
+  const int32_t ints[] = { 7, -8, 9, 10 };
+  paths.push_back(dir + "/ints.npy");
+  WriteNpy(paths.back(), 1,
+           "{'descr': '<i4', 'fortran_order': False, 'shape': (4,), }",
+           ints, sizeof(ints));
+  paths.push_back(dir + "/overflow.npy");
+  WriteNpy(paths.back(), 1, "{'descr': '<f8', 'fortran_order': False, "
+           "'shape': (4611686018427387904, 4), }", matrix, sizeof(matrix));
+  paths.push_back(dir + "/truncated.npy");
+  WriteNpy(paths.back(), 1,
+           "{'descr': '<f8', 'fortran_order': False, 'shape': (7,), }",
+           matrix, sizeof(matrix));
+  paths.push_back(dir + "/fortran.npy");
+  WriteNpy(paths.back(), 1,
+           "{'descr': '<f8', 'fortran_order': True, 'shape': (2, 3), }",
+           matrix, sizeof(matrix));
+  paths.push_back(dir + "/raw.f64");
+  {
+    ofstream raw(paths.back().c_str(), std::ios::binary);
+    raw.write(reinterpret_cast<const char *>(matrix), sizeof(matrix));
+  }
+  paths.push_back(dir + "/bad-magic.npy");
+  {
+    ofstream bad(paths.back().c_str(), std::ios::binary);
+    bad << "NUMPY, but not really";
+  }
+
+  Interpreter interpreter;
+  interpreter.EvalString(
+      "m = file(\"" + dir + "/matrix.npy\"); "
+      "b = file(\"" + dir + "/big-endian.npy\"); "
+      "i = file(\"" + dir + "/ints.npy\"); "
+      "tensor<double> bt = file(\"" + dir + "/big-endian.npy\"); "
+      "double[] r = file(\"" + dir + "/raw.f64\", 16, 3); "
+      "tensor<double> rt = file(\"" + dir + "/raw.f64\", 8);");
+  EnvironmentImpl *env = interpreter.env();
+  Tensor<double> m, bt, rt;
+  vector<double> b, r;
+  vector<int> i;
+  bool ok = env->GetType("m") == "tensor<double>" &&
+      interpreter.Get("m", &m) && m.shape() == vector<size_t>({2, 3}) &&
+      m.data()[5] == 6.0 && reinterpret_cast<uintptr_t>(m.data()) %
+      Tensor<double>::kAlignment == 0;
+  ok &= env->GetType("b") == "double[]" && interpreter.Get("b", &b) &&
+      b == vector<double>({1.5, -2.0}) &&
+      interpreter.Get("bt", &bt) && bt.size() == 2 && bt.data()[1] == -2.0;
+  ok &= env->GetType("i") == "int[]" && interpreter.Get("i", &i) &&
+      i == vector<int>({7, -8, 9, 10});
+  // Data that is not aligned is copied, so the tensor is aligned anyway.
+  ok &= interpreter.Get("r", &r) && r == vector<double>({3.0, 4.0, 5.0}) &&
+      interpreter.Get("rt", &rt) && rt.shape() == vector<size_t>(1, 5) &&
+      rt.data()[0] == 2.0 && reinterpret_cast<uintptr_t>(rt.data()) %
+      Tensor<double>::kAlignment == 0;
+
+  // Aligned native data is used where it is mapped; byte-swapped data
+  // and data at a misaligned offset are not.
+  ExternalArray array;
+  StreamTokenizer matrix_st("\"" + dir + "/matrix.npy\")");
+  array.Read(matrix_st, sizeof(double), "f8");
+  ok &= array.InPlace(Tensor<double>::kAlignment) &&
+      array.data() == array.mapping().get() + 128 && array.size() == 6;
+  StreamTokenizer offset_st("\"" + dir + "/matrix.npy\", 8)");
+  array.Read(offset_st, sizeof(double), "f8");
+  ok &= !array.InPlace(Tensor<double>::kAlignment) && array.size() == 5 &&
+      array.shape() == vector<size_t>(1, 5);
+  StreamTokenizer swapped_st("\"" + dir + "/big-endian.npy\")");
+  array.Read(swapped_st, sizeof(double), "f8");
+  ok &= !array.InPlace(1);
+
+  const char *malformed[][2] = {
+    // Offsets and counts beyond the data, or not in whole elements.
+    { "double[]", "raw.f64\", 56)" }, { "double[]", "raw.f64\", 8, 6)" },
+    { "double[]", "raw.f64\", -8)" }, { "double[]", "raw.f64\", 0, -2)" },
+    { "double[]", "raw.f64\", 4)" }, { "double[]", "raw.f64\", 0, 1, 2)" },
+    { "double[]", "matrix.npy\", 56)" },
+    // Headers that are malformed or disagree with the data.
+    { "tensor<double>", "overflow.npy\")" },
+    { "tensor<double>", "fortran.npy\")" },
+    { "tensor<float>", "matrix.npy\")" }, { "int64[]", "ints.npy\")" },
+    { "double[]", "truncated.npy\")" }, { "double[]", "bad-magic.npy\")" },
+    { "double[]", "missing.npy\")" },
+  };
+  for (size_t j = 0; j < sizeof(malformed) / sizeof(malformed[0]); ++j) {
+    ok &= ReadThrows(env, malformed[j][0],
+                     "file(\"" + dir + "/" + malformed[j][1]);
+  }
+  // An offset at the very end yields no elements.
+  ok &= !ReadThrows(env, "double[]", "file(\"" + dir + "/raw.f64\", 48)");
+
+  for (size_t j = 0; j < paths.size(); ++j) {
+    remove(paths[j].c_str());
+  }
+  rmdir(dir.c_str());
+  cerr << (ok ? "PASS" : "FAIL") << " external arrays" << endl;
+  return ok;
+}
+
+/// Checks that a concurrent environment stores typed values, and that
+/// readers on several threads always see complete values while
+/// another thread keeps reassigning them.
+///
+/// \return whether all checks passed
+bool
+TestConcurrentEnvironment() {
+  Interpreter interpreter;
+  interpreter.EvalString("a = Cow(name(\"Bessie\")); w = {1.5, 2.5};");
+  ConcurrentEnvironment env;
+  env.Set("timeout", 30);
+  env.Set("backend", string("db"));
+  int timeout = 0;
+  string backend;
+  double wrong_type = 0.0;
+  bool ok = env.Get("timeout", &timeout) && timeout == 30 &&
+      env.Get("backend", &backend) && backend == "db" &&
+      !env.Get("timeout", &wrong_type) && !env.Get("missing", &timeout) &&
+      env.GetType("backend") == "string";
+
+  shared_ptr<const string> shared = env.GetShared<string>("backend");
+  env.Set("backend", string("file"));
+  ok &= *shared == "db" && *env.GetShared<string>("backend") == "file";
+  ok &= env.Erase("backend") && !env.Defined("backend") &&
+      !env.Erase("backend");
+
+  shared_ptr<Animal> animal;
+  ok &= env.Import<shared_ptr<Animal> >(*interpreter.env(), "a") &&
+      env.Import<vector<double> >(*interpreter.env(), "w") &&
+      env.GetType("a") == "Animal" && env.GetType("w") == "double[]" &&
+      env.Get("a", &animal) && animal->name() == "Bessie" &&
+      !env.Import<int>(*interpreter.env(), "w");
+
+  // Each value written is a vector whose elements all equal its
+  // sequence number, which readers check never decreases.
+  const int num_writes = 2000;
+  std::atomic<bool> consistent(true);
+  env.Set("v", vector<int>(16, 0));
+  vector<std::thread> readers;
+  for (int i = 0; i < 4; ++i) {
+    readers.push_back(std::thread([&env, &consistent]() {
+          int last = 0;
+          while (last < num_writes) {
+            shared_ptr<const vector<int> > v =
+                env.GetShared<vector<int> >("v");
+            for (size_t j = 0; j < v->size(); ++j) {
+              if ((*v)[j] != (*v)[0] || (*v)[0] < last) {
+                consistent = false;
+              }
+            }
+            last = (*v)[0];
+          }
+        }));
+  }
+  for (int i = 1; i <= num_writes; ++i) {
+    ostringstream varname_ss;
+    varname_ss << "x" << (i % 100);
+    env.Set(varname_ss.str(), i);
+    env.Set("v", vector<int>(16, i));
+  }
+  for (size_t i = 0; i < readers.size(); ++i) {
+    readers[i].join();
+  }
+  ok &= consistent;
+  cerr << (ok ? "PASS" : "FAIL") << " concurrent environment" << endl;
+  return ok;
+}
+
+/// Checks that append statements extend primitive and object vectors
+/// in place without affecting variables assigned from them, nor the
+/// variables of a parent environment.
+///
+/// \return whether all checks passed
+bool
+TestAppend() {
+  Interpreter interpreter;
+  interpreter.EvalString("v = {1, 2}; w = v; v += {3, 4}; v+={5}; "
+                         "v += w; v += range(6, 8); "
+                         "animals = {Cow(name(\"Bessie\"))}; "
+                         "animals += {Sheep(name(\"Dolly\"))};");
+  vector<int> v;
+  vector<int> w;
+  vector<shared_ptr<Animal> > animals;
+  bool ok = interpreter.Get("v", &v) && interpreter.Get("w", &w) &&
+      interpreter.Get("animals", &animals);
+  int expected_v[] = {1, 2, 3, 4, 5, 1, 2, 6, 7};
+  ok &= v == vector<int>(expected_v, expected_v + 9) && w.size() == 2;
+  ok &= animals.size() == 2 && animals[1]->name() == "Dolly";
+
+  // Appending in a child environment copies the variable into it first.
+  EnvironmentImpl *env = interpreter.env();
+  unique_ptr<EnvironmentImpl> child(
+      dynamic_cast<EnvironmentImpl *>(env->CreateChild()));
+  StreamTokenizer st("{10}");
+  child->ReadAndAppend("w", st);
+  ok &= child->Get("w", &w) && w.size() == 3 && w[2] == 10;
+  ok &= env->Get("w", &w) && w.size() == 2;
+
+  // Appends are evaluated eagerly even by a lazy interpreter.
+  Interpreter lazy_interpreter;
+  lazy_interpreter.set_lazy(true);
+  lazy_interpreter.EvalString("x = {1}; x += {2};");
+  ok &= lazy_interpreter.Get("x", &v) && v.size() == 2;
+  cerr << (ok ? "PASS" : "FAIL") << " append" << endl;
+  return ok;
+}
+
+/// Returns a blob holding the characters of the specified string.
+Bytes
+ToBytes(const string &s) {
+  Bytes bytes;
+  if (!s.empty()) {
+    memcpy(bytes.Grow(s.size()), s.data(), s.size());
+  }
+  return bytes;
+}
+
+/// Decodes the specified base64 literal text with a \link
+/// infact::StreamTokenizer StreamTokenizer\endlink.
+///
+/// \param      text  the text between the quotes of a <tt>b64"..."</tt>
+///                   literal
+/// \param[out] bytes the decoded blob
+/// \return whether the literal was valid
+bool
+DecodeLiteral(const string &text, Bytes *bytes) {
+  try {
+    StreamTokenizer st("b64\"" + text + "\"");
+    *bytes = st.PeekBytes();
+    return st.PeekTokenType() == StreamTokenizer::BYTES;
+  } catch (std::runtime_error &e) {
+    return false;
+  }
+}
+
+/// Checks base64 literals against the test vectors of RFC 4648, in
+/// one piece and split at every position, along with unpadded text,
+/// embedded whitespace, bad padding, nonzero unused bits and
+/// unterminated literals, and that encoding and decoding round trip.
+///
+/// \return whether all checks passed
+bool
+TestBase64() {
+  const char *vectors[][2] = {
+    { "", "" }, { "f", "Zg==" }, { "fo", "Zm8=" }, { "foo", "Zm9v" },
+    { "foob", "Zm9vYg==" }, { "fooba", "Zm9vYmE=" },
+    { "foobar", "Zm9vYmFy" },
+  };
+  bool ok = true;
+  for (size_t i = 0; i < sizeof(vectors) / sizeof(vectors[0]); ++i) {
+    const string plain = vectors[i][0];
+    const string encoded = vectors[i][1];
+    Bytes expected = ToBytes(plain);
+    Bytes bytes;
+    ok &= Base64Encode(expected) == encoded &&
+        DecodeLiteral(encoded, &bytes) && bytes == expected;
+    for (size_t split = 0; split <= encoded.size(); ++split) {
+      Base64Decoder decoder;
+      ok &= decoder.Decode(encoded.data(), split) == split &&
+          decoder.Decode(encoded.data() + split, encoded.size() - split) ==
+          encoded.size() - split &&
+          decoder.Finish(&bytes) && bytes == expected;
+    }
+  }
+
+  // Padding is optional, and whitespace is ignored.
+  Bytes bytes;
+  ok &= DecodeLiteral("Zm9vYg", &bytes) && bytes == ToBytes("foob") &&
+      DecodeLiteral("Zm9vYmE", &bytes) && bytes == ToBytes("fooba") &&
+      DecodeLiteral(" Zm9v\n\tYm\r\nFy ", &bytes) &&
+      bytes == ToBytes("foobar") &&
+      DecodeLiteral("Zm8 =", &bytes) && bytes == ToBytes("fo");
+
+  const char *malformed[] = {
+    "Z", "Zm9vY", "Z===", "Zg=", "Zm9v=", "Zg==Zg==", "Zg=g", "Zm9v@",
+    // Bits left over after the final byte must be zero.
+    "aGVsbG9=", "Zh==", "Zh", "Zm9=",
+  };
+  for (size_t i = 0; i < sizeof(malformed) / sizeof(malformed[0]); ++i) {
+    ok &= !DecodeLiteral(malformed[i], &bytes);
+  }
+  ok &= DecodeLiteral("aGVsbG8=", &bytes) && bytes == ToBytes("hello");
+
+  bool threw = false;
+  try {
+    StreamTokenizer st("b64\"Zm9v");
+  } catch (std::runtime_error &e) {
+    threw = true;
+  }
+  ok &= threw;
+
+  // Every byte value, at each length modulo three.
+  for (size_t length = 253; length <= 256; ++length) {
+    Bytes blob;
+    uint8_t *data = blob.Grow(length);
+    for (size_t i = 0; i < length; ++i) {
+      data[i] = static_cast<uint8_t>(255 - i);
+    }
+    ok &= DecodeLiteral(Base64Encode(blob), &bytes) && bytes == blob;
+  }
+  cerr << (ok ? "PASS" : "FAIL") << " base64" << endl;
+  return ok;
+}
+
+/// Checks that an int literal may initialize any wider numeric type,
+/// that an integer too large for an int is inferred as an int64 and is
+/// never truncated, that <tt>long</tt> is an alias for <tt>int64</tt>
+/// and that a float literal with trailing characters is rejected.
+///
+/// \return whether all checks passed
+bool
+TestNumericLiterals() {
+  Interpreter interpreter;
+  interpreter.EvalString("double d = 3; double[] dv = {1, 2}; "
+                         "float f = 2.5f; int64 big = 9000000000; "
+                         "inferred = 12345678901; small = -2147483648; "
+                         "long l = 7; long[] lv = {1, 9000000000};");
+  EnvironmentImpl *env = interpreter.env();
+  double d = 0.0;
+  vector<double> dv;
+  float f = 0.0f;
+  int64_t inferred = 0;
+  int small = 0;
+  int64_t l = 0;
+  vector<int64_t> lv;
+  bool ok = interpreter.Get("d", &d) && d == 3.0 &&
+      interpreter.Get("dv", &dv) && dv.size() == 2 && dv[1] == 2.0 &&
+      interpreter.Get("f", &f) && f == 2.5f;
+  ok &= env->GetType("inferred") == "int64" &&
+      interpreter.Get("inferred", &inferred) && inferred == 12345678901LL &&
+      env->GetType("small") == "int" && interpreter.Get("small", &small) &&
+      small == std::numeric_limits<int>::min();
+  ok &= env->GetType("l") == "int64" && interpreter.Get("l", &l) && l == 7 &&
+      env->GetType("lv") == "int64[]" && interpreter.Get("lv", &lv) &&
+      lv.size() == 2 && lv[1] == 9000000000LL;
+
+  const char *malformed[][2] = {
+    { "float", "2.5x" }, { "float", "3ff" }, { "float", "1.5.2" },
+    { "int", "99999999999" }, { "int", "2147483648" }, { "int", "12x" },
+    { "int[]", "{1, 99999999999}" },
+    { "int64", "99999999999999999999" },
+    { "", "Cow(name(\"Bessie\"), age(99999999999))" },
+  };
+  for (size_t i = 0; i < sizeof(malformed) / sizeof(malformed[0]); ++i) {
+    bool threw = false;
+    try {
+      StreamTokenizer st(malformed[i][1]);
+      env->ReadAndSet("g", st, malformed[i][0]);
+    } catch (const std::runtime_error &e) {
+      threw = true;
+    }
+    ok &= threw;
+  }
+  cerr << (ok ? "PASS" : "FAIL") << " numeric literals" << endl;
+  return ok;
+}
+
+namespace infact {
+
+/// A cow with a map-typed member, for checking that maps initialize
+/// members of Factory-constructible objects.
+class TaggedCow : public Animal {
+ public:
+  virtual void RegisterInitializers(Initializers &initializers) {
+    INFACT_ADD_REQUIRED_PARAM_(name);
+    INFACT_ADD_PARAM_(tags);
+  }
+
+  virtual const string &name() const { return name_; }
+  virtual int age() const { return 0; }
+  /// Returns the tags of this cow.
+  const unordered_map<string, double> &tags() const { return tags_; }
+ private:
+  string name_;
+  unordered_map<string, double> tags_;
+};
+
+REGISTER_ANIMAL(TaggedCow)
+
+}  // namespace infact
+
+/// Checks that map literals are read into <tt>unordered_map</tt>
+/// values, including empty maps, maps of objects and map-typed
+/// members, that malformed literals and duplicate keys are rejected
+/// and that printed maps read back as the same values.
+///
+/// \return whether all checks passed
+bool
+TestMaps() {
+  Interpreter interpreter;
+  interpreter.EvalString(
+      "w = {\"a\": 1.5, \"b\": -2.0}; map<int> empty = {}; "
+      "map<Animal> zoo = {\"cow\": Cow(name(\"Bessie\")), "
+      "                   \"sheep\": Sheep(name(\"Dolly\"))}; "
+      "t = TaggedCow(name(\"Elsie\"), tags({\"milk\": 30, \"age\": 4.5}));");
+  EnvironmentImpl *env = interpreter.env();
+  unordered_map<string, double> w;
+  unordered_map<string, int> empty;
+  unordered_map<string, shared_ptr<Animal> > zoo;
+  shared_ptr<Animal> t;
+  bool ok = env->GetType("w") == "map<double>" &&
+      interpreter.Get("w", &w) && w.size() == 2 && w["a"] == 1.5 &&
+      w["b"] == -2.0;
+  ok &= interpreter.Get("empty", &empty) && empty.empty();
+  ok &= interpreter.Get("zoo", &zoo) && zoo.size() == 2 &&
+      zoo["cow"]->name() == "Bessie" && zoo["sheep"]->name() == "Dolly";
+  TaggedCow *tagged = nullptr;
+  ok &= interpreter.Get("t", &t) &&
+      (tagged = dynamic_cast<TaggedCow *>(t.get())) != nullptr &&
+      tagged->tags().size() == 2 && tagged->tags().at("milk") == 30.0;
+
+  // Printing a map yields a literal that reads back as the same map,
+  // given its type, as the environment prints it.
+  ValueString<unordered_map<string, double> > value_string;
+  interpreter.EvalString("map<double> w2 = " + value_string.ToString(w) +
+                         ";");
+  unordered_map<string, double> w2;
+  ok &= interpreter.Get("w2", &w2) && w2 == w;
+
+  ok &= ReadThrows(env, "map<int>", "{\"a\": 1, \"a\": 2}");
+  ok &= ReadThrows(env, "map<int>", "{\"a\": 1, \"b\" 2}");
+  ok &= ReadThrows(env, "map<int>", "{\"a\": 1 \"b\": 2}");
+  ok &= ReadThrows(env, "map<int>", "{1: 2}");
+  cerr << (ok ? "PASS" : "FAIL") << " maps" << endl;
+  return ok;
+}
+
+namespace infact {
+
+/// A cow with a tensor-typed member, for checking that tensors
+/// initialize members of Factory-constructible objects.
+class EmbeddedCow : public Animal {
+ public:
+  virtual void RegisterInitializers(Initializers &initializers) {
+    INFACT_ADD_REQUIRED_PARAM_(name);
+    INFACT_ADD_PARAM_(embedding);
+  }
+
+  virtual const string &name() const { return name_; }
+  virtual int age() const { return 0; }
+  /// Returns the embedding of this cow.
+  const Tensor<float> &embedding() const { return embedding_; }
+ private:
+  string name_;
+  Tensor<float> embedding_;
+};
+
+REGISTER_ANIMAL(EmbeddedCow)
+
+}  // namespace infact
+
+/// Checks that tensor literals infer their shape from nested braces,
+/// that ragged literals are rejected, that the elements are aligned and
+/// shared by copies, that printed tensors read back as the same values
+/// and that tensors initialize members.
+///
+/// \return whether all checks passed
+bool
+TestTensors() {
+  Interpreter interpreter;
+  interpreter.EvalString(
+      "m = {{1.5, 2, 3}, {4, 5, 6}}; "
+      "tensor<int> cube = {{{1, 2}, {3, 4}}, {{5, 6}, {7, 8}}}; "
+      "tensor<float> v = {1, 2, 3}; tensor<double> none = {{}, {}}; "
+      "e = EmbeddedCow(name(\"Elsie\"), embedding({{0.5, 1}, {2, 4}}));");
+  EnvironmentImpl *env = interpreter.env();
+  Tensor<double> m;
+  Tensor<int> cube;
+  Tensor<float> v;
+  Tensor<double> none;
+  bool ok = env->GetType("m") == "tensor<double>" &&
+      interpreter.Get("m", &m) && m.rank() == 2 && m.shape()[0] == 2 &&
+      m.shape()[1] == 3 && m.size() == 6 && m[0] == 1.5 && m[5] == 6.0;
+  ok &= interpreter.Get("cube", &cube) && cube.rank() == 3 &&
+      cube.shape()[2] == 2 && cube[7] == 8;
+  ok &= interpreter.Get("v", &v) && v.rank() == 1 && v.size() == 3;
+  ok &= interpreter.Get("none", &none) && none.size() == 0 &&
+      none.shape()[0] == 2 && none.shape()[1] == 0;
+
+  // The elements are aligned, and copies share them.
+  ok &= reinterpret_cast<uintptr_t>(m.data()) % Tensor<double>::kAlignment ==
+      0 && reinterpret_cast<uintptr_t>(v.data()) % Tensor<float>::kAlignment ==
+      0;
+  Tensor<double> m_copy;
+  interpreter.EvalString("m_copy = m;");
+  ok &= interpreter.Get("m_copy", &m_copy) && m_copy.data() == m.data();
+
+  // Printing a tensor yields a literal that reads back as the same one.
+  ValueString<Tensor<double> > value_string;
+  interpreter.EvalString("tensor<double> m2 = " + value_string.ToString(m) +
+                         ";");
+  Tensor<double> m2;
+  ok &= interpreter.Get("m2", &m2) && m2.shape() == m.shape() &&
+      std::equal(m.begin(), m.end(), m2.begin());
+  ostringstream printed;
+  env->Print(printed);
+  ok &= printed.str().find("tensor<int> cube = {{{1, 2}, {3, 4}}, "
+                           "{{5, 6}, {7, 8}}};") != string::npos;
+
+  shared_ptr<Animal> e;
+  EmbeddedCow *embedded = nullptr;
+  ok &= interpreter.Get("e", &e) &&
+      (embedded = dynamic_cast<EmbeddedCow *>(e.get())) != nullptr &&
+      embedded->embedding().rank() == 2 && embedded->embedding()[3] == 4.0f;
+
+  ok &= ReadThrows(env, "", "{{1, 2}, {3}}");
+  ok &= ReadThrows(env, "", "{{1, 2}, 3}");
+  ok &= ReadThrows(env, "", "{{{1}}, {2}}");
+  ok &= ReadThrows(env, "tensor<int>", "{{1, x}}");
+  cerr << (ok ? "PASS" : "FAIL") << " tensors" << endl;
+  return ok;
+}
+
+/// A scoped enumerated type, whose values are registered under names
+/// other than their qualified C++ names.  One of them shares its name
+/// with a value of \link infact::Color Color\endlink, so that neither
+/// may be used without an explicit type.
+enum class Paint { kWhite, kRed };
+
+IMPLEMENT_ENUM(Paint)
+REGISTER_ENUM_VALUE_NAMED(Paint, Paint::kWhite, WHITE)
+REGISTER_ENUM_VALUE_NAMED(Paint, Paint::kRed, RED)
+
+/// Checks that values of enumerated types initialize variables, vectors
+/// and members by name, that misspelled and ambiguous names are
+/// rejected and that variables shadow value names.
+///
+/// \return whether all checks passed
+bool
+TestEnums() {
+  Interpreter interpreter;
+  interpreter.EvalString(
+      "c = BROWN; Color[] coats = {BLACK_AND_WHITE, BROWN}; "
+      "Color white = WHITE; Paint primer = WHITE; p = RED; "
+      "a = Cow(name(\"Bessie\"), color(BLACK_AND_WHITE)); "
+      "BROWN = 7; shadowed = BROWN;");
+  EnvironmentImpl *env = interpreter.env();
+  Color c = WHITE;
+  vector<Color> coats;
+  Color white = BROWN;
+  Paint primer = Paint::kRed;
+  Paint p = Paint::kWhite;
+  shared_ptr<Animal> a;
+  bool ok = env->GetType("c") == "Color" && interpreter.Get("c", &c) &&
+      c == BROWN && static_cast<int>(c) == 0;
+  ok &= env->GetType("coats") == "Color[]" &&
+      interpreter.Get("coats", &coats) && coats.size() == 2 &&
+      coats[0] == BLACK_AND_WHITE && coats[1] == BROWN;
+  ok &= interpreter.Get("white", &white) && white == WHITE &&
+      interpreter.Get("primer", &primer) && primer == Paint::kWhite &&
+      env->GetType("p") == "Paint" && interpreter.Get("p", &p) &&
+      p == Paint::kRed;
+  ok &= interpreter.Get("a", &a) &&
+      dynamic_cast<Cow *>(a.get())->color() == BLACK_AND_WHITE &&
+      static_cast<int>(dynamic_cast<Cow *>(a.get())->color()) == 2;
+  ok &= env->GetType("shadowed") == "int";
+
+  ValueString<Paint> value_string;
+  ok &= value_string.ToString(Paint::kRed) == "RED";
+
+  // A misspelled value is caught when the specification is read, as is
+  // a value name shared by two types without an explicit type.
+  ok &= ReadThrows(env, "", "Cow(name(\"Elsie\"), color(BRWON))");
+  ok &= ReadThrows(env, "Color", "BRWON");
+  ok &= ReadThrows(env, "Color", "RED");
+  ok &= ReadThrows(env, "", "WHITE");
+  cerr << (ok ? "PASS" : "FAIL") << " enums" << endl;
+  return ok;
+}
+
+/// Checks that a <tt>range</tt> of int literals fills a vector or
+/// tensor of any numeric type.
+///
+/// \return whether all checks passed
+bool
+TestRangeTypes() {
+  Interpreter interpreter;
+  interpreter.EvalString("double[] x = range(0, 10); float[] f = range(3); "
+                         "uint64[] u = range(2, 5); "
+                         "tensor<double> t = range(0, 1, 0.25); "
+                         "tensor<float> l = linspace(0, 1, 3);");
+  vector<double> x;
+  vector<float> f;
+  vector<uint64_t> u;
+  Tensor<double> t;
+  Tensor<float> l;
+  bool ok = interpreter.Get("x", &x) && x.size() == 10 && x[9] == 9.0 &&
+      interpreter.Get("f", &f) && f.size() == 3 && f[2] == 2.0f &&
+      interpreter.Get("u", &u) && u.size() == 3 && u[0] == 2;
+  ok &= interpreter.Get("t", &t) && t.rank() == 1 && t.size() == 4 &&
+      t[3] == 0.75 && interpreter.Get("l", &l) && l.size() == 3 &&
+      l[1] == 0.5f;
+  cerr << (ok ? "PASS" : "FAIL") << " range types" << endl;
+  return ok;
+}
+
+/// Checks that literals of a registered value type are recognized,
+/// decoded into native values once, printed back and validated when a
+/// specification is read.
+///
+/// \return whether all checks passed
+bool
+TestValueTypes() {
+  Interpreter interpreter;
+  interpreter.EvalString("timeout = 30s; duration retry = 1.5m; "
+                         "backoffs = {250ms, 2s}; "
+                         "c = Cow(name(\"Bessie\"), milking_interval(6h));");
+  EnvironmentImpl *env = interpreter.env();
+  Duration timeout;
+  Duration retry;
+  vector<Duration> backoffs;
+  shared_ptr<Animal> animal;
+  bool ok = env->GetType("timeout") == "duration" &&
+      env->GetType("backoffs") == "duration[]";
+  ok &= interpreter.Get("timeout", &timeout) &&
+      timeout.nanos == 30000000000LL &&
+      interpreter.Get("retry", &retry) && retry.nanos == 90000000000LL &&
+      interpreter.Get("backoffs", &backoffs) && backoffs.size() == 2 &&
+      backoffs[0].nanos == 250000000LL;
+  ok &= interpreter.Get("c", &animal) &&
+      dynamic_cast<Cow *>(animal.get())->milking_interval().nanos ==
+      6 * 3600 * 1000000000LL;
+  ValueString<Duration> value_string;
+  ok &= value_string.ToString(retry) == "90s" &&
+      value_string.ToString(backoffs[0]) == "250ms";
+
+  // A malformed literal is caught when the specification is read.
+  bool threw = false;
+  try {
+    StreamTokenizer st("30");
+    env->ReadAndSet("d", st, "duration");
+  } catch (const std::runtime_error &e) {
+    threw = true;
+  }
+  ok &= threw && !env->Defined("d");
+  cerr << (ok ? "PASS" : "FAIL") << " value types" << endl;
+  return ok;
+}
+
+/// The holder on which constructing a \link infact::RollbackCow
+/// RollbackCow \endlink rolls back, and the generation to which it rolls
+/// back.
+ConfigHolder *rollback_holder = nullptr;
+size_t rollback_id = 0;
+
+namespace infact {
+
+/// A cow whose construction rolls back the holder, standing in for a
+/// rollback made by another thread while a generation is evaluated.
+class RollbackCow : public Animal {
+ public:
+  virtual void RegisterInitializers(Initializers &initializers) {
+    INFACT_ADD_REQUIRED_PARAM_(name);
+  }
+
+  virtual void PostInit(const Environment *env, const string &init_str) {
+    rollback_holder->Rollback(rollback_id);
+  }
+
+  virtual const string &name() const { return name_; }
+  virtual int age() const { return 0; }
+ private:
+  string name_;
+};
+
+REGISTER_ANIMAL(RollbackCow)
+
+}  // namespace infact
+
+/// Checks that a config holder shares unchanged variables between
+/// generations, re-evaluates those whose dependencies changed, rolls
+/// back to any retained generation and lets a rollback made during a
+/// load stand.
+///
+/// \return whether all checks passed
+bool
+TestConfigHolder() {
+  ConfigHolder holder(2);
+  size_t first = holder.LoadString("a = Cow(name(\"Bessie\")); n = 1; "
+                                   "m = n; w = {1.5};");
+  shared_ptr<const ConfigHolder::Generation> first_generation =
+      holder.current();
+  size_t second = holder.LoadString("a = Cow(name(\"Bessie\")); n = 2; "
+                                    "m = n; w = {1.5};");
+  shared_ptr<const ConfigHolder::Generation> second_generation =
+      holder.current();
+  shared_ptr<Animal> first_cow;
+  shared_ptr<Animal> second_cow;
+  int m = 0;
+  bool ok = second_generation->id() == second &&
+      second_generation->num_shared() == 2;
+  ok &= first_generation->Get("a", &first_cow) &&
+      second_generation->Get("a", &second_cow) &&
+      first_cow.get() == second_cow.get();
+  ok &= second_generation->Get("m", &m) && m == 2;
+
+  ok &= holder.Rollback(first) && holder.current()->id() == first &&
+      holder.current()->Get("m", &m) && m == 1;
+
+  // Loading while rolled back compares against the current generation,
+  // and discards the oldest one.
+  size_t third = holder.LoadString("a = Cow(name(\"Elsie\")); n = 1; "
+                                   "m = n; w = {1.5};");
+  ok &= holder.current()->num_shared() == 3 && !holder.Rollback(first);
+  vector<size_t> ids = holder.RetainedIds();
+  ok &= ids.size() == 2 && ids[0] == second && ids[1] == third;
+  ok &= first_generation->Get("n", &m) && m == 1;
+
+  // Publishing the generation being loaded does not undo a rollback
+  // made meanwhile; the new generation is retained for a later one.
+  rollback_holder = &holder;
+  rollback_id = second;
+  size_t fourth = holder.LoadString("a = RollbackCow(name(\"Bessie\"));");
+  rollback_holder = nullptr;
+  ok &= holder.current()->id() == second && holder.Rollback(fourth) &&
+      holder.current()->id() == fourth;
+  cerr << (ok ? "PASS" : "FAIL") << " config holder" << endl;
+  return ok;
+}
+
 int
 main(int argc, char **argv) {
   int debug = 1;
   Environment *env = new EnvironmentImpl(debug);
   delete env;
+
+  bool ok = TestAllocationBudgets();
+  ok &= TestBinding();
+  ok &= TestSubscriptions();
+  ok &= TestLazyEvaluation();
+  ok &= TestMemoryBudget();
+  ok &= TestStringArray();
+  ok &= TestFileLoader();
+  ok &= TestExternalArrays();
+  ok &= TestConcurrentEnvironment();
+  ok &= TestAppend();
+  ok &= TestBase64();
+  ok &= TestNumericLiterals();
+  ok &= TestMaps();
+  ok &= TestTensors();
+  ok &= TestEnums();
+  ok &= TestRangeTypes();
+  ok &= TestValueTypes();
+  ok &= TestConfigHolder();
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
 }
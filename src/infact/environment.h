@@ -41,12 +41,19 @@
 
 #define VAR_MAP_DEBUG 0
 
+#include <iterator>
 #include <sstream>
+#include <unordered_map>
 #include <vector>
 
 #include "error.h"
+#include "generators.h"
+#include "memory-usage.h"
+#include "stats.h"
 #include "stream-init.h"
 #include "stream-tokenizer.h"
+#include "trace.h"
+#include "value-hash.h"
 
 namespace infact {
 
@@ -95,14 +102,69 @@ class VarMapBase {
   /// that value.
   virtual void ReadAndSet(const string &varname, StreamTokenizer &st) = 0;
 
+  /// Reads the next value from the specified stream tokenizer, in any
+  /// form that may initialize a variable of this type, and appends its
+  /// elements to the value of the specified variable in place.  Only
+  /// vector types support appending; for all others, this method is an
+  /// error.
+  virtual void ReadAndAppend(const string &varname, StreamTokenizer &st) {
+    ostringstream err_ss;
+    err_ss << "VarMap<" << name_ << ">: error: cannot append to variable "
+           << varname << ", since only vectors may be appended to";
+    Error(err_ss.str());
+  }
+
   /// Prints out a human-readable string to the specified output
   /// stream containing the variables, their type and, if primitive,
   /// their values.
   virtual void Print(ostream &os) const = 0;
 
+  /// Sets <tt>hash</tt> to a hash of the content of the value of the
+  /// specified variable, as computed by \link infact::ValueHash
+  /// ValueHash\endlink.
+  ///
+  /// \return whether the specified variable has a value in this VarMap
+  virtual bool HashValue(const string &varname, size_t *hash) const = 0;
+
+  /// Returns the approximate number of bytes held by the value of the
+  /// specified variable, or zero if there is no such variable.
+  virtual size_t ValueBytes(const string &varname) const = 0;
+
+  /// Returns whether the value of the specified variable shares
+  /// ownership of an object with code outside this VarMap, as
+  /// determined by \link infact::ValueSharing ValueSharing\endlink.
+  virtual bool Shared(const string &varname) const = 0;
+
+  /// Removes the specified variable from this VarMap.
+  ///
+  /// \return whether there was such a variable
+  virtual bool Erase(const string &varname) = 0;
+
   /// Returns a newly constructed copy of this VarMap.
   virtual VarMapBase *Copy(Environment *env) const = 0;
 
+  /// Returns a newly constructed, empty VarMap for variables of the
+  /// same type as this one, held by the specified environment.
+  virtual VarMapBase *CreateEmpty(Environment *env) const = 0;
+
+  /// Sets each variable of this VarMap to the same value in the
+  /// specified VarMap, which must be for variables of the same type.
+  virtual void CopyVariablesTo(VarMapBase *var_map) const = 0;
+
+  /// Sets the specified variable of the specified VarMap, which must be
+  /// for variables of the same type, to its value in this VarMap.
+  virtual void CopyVariableTo(const string &varname,
+                              VarMapBase *var_map) const = 0;
+
+  /// Accounts for the memory held by this VarMap and each of its
+  /// variables in the specified report.
+  ///
+  /// \param report  the report to which to add this VarMap&rsquo;s usage
+  /// \param visitor the record of objects and buffers already accounted
+  ///                for
+  virtual void AddMemoryUsage(MemoryUsageReport *report,
+                              MemoryVisitor *visitor) const = 0;
+
  protected:
   /// To allow proper implementation of Copy in VarMapBase implementation,
   /// since we don't get copying of base class' members for free.
@@ -136,6 +198,11 @@ class Environment {
   virtual void ReadAndSet(const string &varname, StreamTokenizer &st,
                           const string type = "") = 0;
 
+  /// Appends the elements of the value obtained from the following
+  /// tokens available from the specified token stream to the value of
+  /// the specified vector variable, which must already be defined.
+  virtual void ReadAndAppend(const string &varname, StreamTokenizer &st) = 0;
+
   /// Retrieves the type name of the specified variable.
   virtual const string &GetType(const string &varname) const = 0;
 
@@ -169,6 +236,22 @@ class Environment {
   /// Returns a copy of this environment.
   virtual Environment *Copy() const = 0;
 
+  /// Returns a new, empty environment whose lookups of variables it
+  /// does not itself define fall through to this environment.
+  /// Variables set in the returned child environment are not visible
+  /// in this one.  Unlike \link Copy\endlink, this takes time
+  /// independent of the number of variables in this environment.
+  ///
+  /// This environment must outlive the returned child and must not be
+  /// modified while the child exists.
+  virtual Environment *CreateChild() = 0;
+
+  /// Returns an estimate of the memory held by this environment, per
+  /// type and for the specified number of largest variables.  Values
+  /// are followed into vector elements and into the registered members
+  /// of \link infact::Factory Factory\endlink-constructible objects.
+  virtual MemoryUsageReport MemoryUsage(size_t num_largest = 10) const = 0;
+
   /// Prints out a human-readable string with the names of all abstract base
   /// types and their concrete implementations that may be constructed.
   /// \see infact::FactoryContainer::Print
@@ -181,8 +264,11 @@ class Environment {
 /// A template class that helps print out values with ostream& operator
 /// support and vectors of those values.
 ///
-/// \tparam T the type to print to an ostream
-template <typename T>
+/// \tparam T      the type to print to an ostream
+/// \tparam Enable a parameter allowing whole families of types, such as
+///                all enumerated types, to be handled by a single partial
+///                specialization
+template <typename T, typename Enable = void>
 class ValueString {
  public:
   string ToString(const T &value) const {
@@ -202,6 +288,16 @@ class ValueString<string> {
   }
 };
 
+/// A specialization of the ValueString class to support printing of
+/// binary blobs as base64 literals.
+template<>
+class ValueString<Bytes> {
+ public:
+  string ToString(const Bytes &value) const {
+    return "b64\"" + Base64Encode(value) + "\"";
+  }
+};
+
 /// A specialization of the ValueString class to support printing of
 /// boolean values.
 template<>
@@ -249,6 +345,32 @@ class ValueString<vector<T> > {
   }
 };
 
+/// A partial specialization of the ValueString class to support
+/// printing of maps from strings to values, using the same syntax as
+/// map literals.
+///
+/// \tparam T the value type for a map to be printed out to an ostream
+template <typename T>
+class ValueString<unordered_map<string, T> > {
+ public:
+  string ToString(const unordered_map<string, T> &value) const {
+    ostringstream oss;
+    oss << "{";
+    ValueString<string> key_string;
+    ValueString<T> value_string;
+    for (typename unordered_map<string, T>::const_iterator it = value.begin();
+         it != value.end(); ++it) {
+      if (it != value.begin()) {
+        oss << ", ";
+      }
+      oss << key_string.ToString(it->first) << ": "
+          << value_string.ToString(it->second);
+    }
+    oss << "}";
+    return oss.str();
+  }
+};
+
 /// A partial implementation of the VarMapBase interface that is common
 /// to both VarMap<T> and the VarMap<vector<T> > partial specialization.
 ///
@@ -287,14 +409,72 @@ class VarMapImpl : public VarMapBase {
     }
   }
 
+  /// Returns a pointer to the value of the specified variable, or
+  /// <tt>nullptr</tt> if there is no such variable.  The pointer
+  /// remains valid, and reflects later assignments to the variable,
+  /// for the lifetime of this VarMap.
+  const T *Find(const string &varname) const {
+    typename unordered_map<string, T>::const_iterator it = vars_.find(varname);
+    return it == vars_.end() ? nullptr : &(it->second);
+  }
+
   /// \copydoc VarMapBase::Defined
   virtual bool Defined(const string &varname) const {
     return vars_.find(varname) != vars_.end();
   }
 
+  /// \copydoc VarMapBase::ValueBytes
+  virtual size_t ValueBytes(const string &varname) const {
+    typename unordered_map<string, T>::const_iterator it = vars_.find(varname);
+    if (it == vars_.end()) {
+      return 0;
+    }
+    MemoryVisitor visitor;
+    return kHashNodeOverhead + sizeof(*it) +
+        MemorySize<string>().HeapBytes(it->first, &visitor) +
+        MemorySize<T>().HeapBytes(it->second, &visitor);
+  }
+
+  /// \copydoc VarMapBase::Shared
+  virtual bool Shared(const string &varname) const {
+    typename unordered_map<string, T>::const_iterator it = vars_.find(varname);
+    return it != vars_.end() && ValueSharing<T>().Shared(it->second);
+  }
+
+  /// \copydoc VarMapBase::Erase
+  virtual bool Erase(const string &varname) {
+    return vars_.erase(varname) > 0;
+  }
+
+  /// \copydoc VarMapBase::HashValue
+  virtual bool HashValue(const string &varname, size_t *hash) const {
+    typename unordered_map<string, T>::const_iterator it = vars_.find(varname);
+    if (it == vars_.end()) {
+      return false;
+    }
+    *hash = ValueHash<T>().Hash(it->second);
+    return true;
+  }
+
   /// Sets the specified variable to the specified value.
   void Set(const string &varname, T value) {
-    vars_[varname] = value;
+    vars_[varname] = std::move(value);
+  }
+
+  /// \copydoc VarMapBase::AddMemoryUsage
+  virtual void AddMemoryUsage(MemoryUsageReport *report,
+                              MemoryVisitor *visitor) const {
+    report->AddTypeOverhead(Name(), sizeof(Derived) +
+                            vars_.bucket_count() * sizeof(void *));
+    MemorySize<string> name_size;
+    MemorySize<T> value_size;
+    for (typename unordered_map<string, T>::const_iterator it = vars_.begin();
+         it != vars_.end(); ++it) {
+      size_t bytes = kHashNodeOverhead + sizeof(*it) +
+          name_size.HeapBytes(it->first, visitor) +
+          value_size.HeapBytes(it->second, visitor);
+      report->AddVariable(it->first, Name(), bytes);
+    }
   }
 
   /// \copydoc VarMapBase::Print
@@ -323,13 +503,50 @@ class VarMapImpl : public VarMapBase {
     var_map_copy->SetMembers(name_, env, is_primitive_);
     return var_map_copy;
   }
+
+  /// \copydoc VarMapBase::CreateEmpty
+  virtual VarMapBase *CreateEmpty(Environment *env) const {
+    // Invoke Derived class' constructor for an empty instance like this one.
+    const Derived *derived = dynamic_cast<const Derived *>(this);
+    if (derived == nullptr) {
+      Error("bad dynamic cast");
+    }
+    return new Derived(*derived, env);
+  }
+
+  /// \copydoc VarMapBase::CopyVariablesTo
+  virtual void CopyVariablesTo(VarMapBase *var_map) const {
+    INFACT_STATS_INC(dynamic_casts);
+    Derived *typed_var_map = dynamic_cast<Derived *>(var_map);
+    if (typed_var_map == nullptr) {
+      Error("bad dynamic cast");
+    }
+    for (typename unordered_map<string, T>::const_iterator it = vars_.begin();
+         it != vars_.end(); ++it) {
+      typed_var_map->Set(it->first, it->second);
+    }
+  }
+
+  /// \copydoc VarMapBase::CopyVariableTo
+  virtual void CopyVariableTo(const string &varname,
+                              VarMapBase *var_map) const {
+    INFACT_STATS_INC(dynamic_casts);
+    Derived *typed_var_map = dynamic_cast<Derived *>(var_map);
+    typename unordered_map<string, T>::const_iterator it = vars_.find(varname);
+    if (typed_var_map == nullptr || it == vars_.end()) {
+      Error("bad dynamic cast or undefined variable");
+    }
+    typed_var_map->Set(it->first, it->second);
+  }
  protected:
   /// Checks if the next token is an identifier and is a variable in
   /// the environment, and, if so, sets varname to the variable&rsquo;s value.
   bool ReadAndSetFromExistingVariable(const string &varname,
                                       StreamTokenizer &st) {
-    if (env()->Defined(st.Peek())) {
+    if (st.PeekTokenType() == StreamTokenizer::IDENTIFIER &&
+        env()->Defined(st.Peek())) {
       VarMapBase *var_map = env()->GetVarMap(st.Peek());
+      INFACT_STATS_INC(dynamic_casts);
       Derived *typed_var_map = dynamic_cast<Derived *>(var_map);
       if (typed_var_map != nullptr) {
         // Finally consume variable.
@@ -372,6 +589,14 @@ class VarMapImpl : public VarMapBase {
   /// VarMapBase instance, for the two concrete VarMap implementations, below.
   Environment *env() { return VarMapBase::env_; }
 
+  /// Returns a pointer through which the value of the specified
+  /// variable may be modified in place, or <tt>nullptr</tt> if there is
+  /// no such variable.
+  T *MutableValue(const string &varname) {
+    typename unordered_map<string, T>::iterator it = vars_.find(varname);
+    return it == vars_.end() ? nullptr : &(it->second);
+  }
+
  private:
   unordered_map<string, T> vars_;
 };
@@ -395,6 +620,15 @@ class VarMap : public VarMapImpl<T, VarMap<T> > {
   VarMap(const string &name, Environment *env, bool is_primitive = true) :
       Base(name, env, is_primitive) { }
 
+  /// Constructs an empty mapping for variables of the same type as the
+  /// specified instance.
+  ///
+  /// \param other the instance whose type name and primitiveness to copy
+  /// \param env   the \link infact::Environment Environment \endlink
+  ///              that contains this VarMap instance
+  VarMap(const VarMap &other, Environment *env) :
+      Base(other.Name(), env, other.IsPrimitive()) { }
+
   virtual ~VarMap() { }
 
   /// \copydoc VarMapBase::ReadAndSet
@@ -454,9 +688,32 @@ class VarMap<vector<T> > : public VarMapImpl<vector<T>, VarMap<vector<T> > > {
 	 bool is_primitive = true)
       : Base(name, env, is_primitive), element_typename_(element_typename) { }
 
+  /// Constructs an empty mapping for variables of the same type as the
+  /// specified instance.
+  ///
+  /// \param other the instance whose type names and primitiveness to copy
+  /// \param env   the \link infact::Environment Environment \endlink
+  ///              that contains this VarMap instance
+  VarMap(const VarMap &other, Environment *env)
+      : Base(other.Name(), env, other.IsPrimitive()),
+        element_typename_(other.element_typename_) { }
+
   virtual ~VarMap() { }
 
   virtual void ReadAndSet(const string &varname, StreamTokenizer &st) {
+    TraceSpan span("vector", varname);
+
+    // A generator expression, such as range(0, 10), fills the vector
+    // directly rather than reading each of its elements.
+    string generator;
+    if (PeekGenerator(st, &generator)) {
+      vector<T> value;
+      ReadGenerator(varname, generator, st, &value);
+      TraceVectorRead(value.size(), &span);
+      this->Set(varname, std::move(value));
+      return;
+    }
+
     // First check if next token is an identifier and is a variable in
     // the environment, set varname to its value.
     if (!Base::ReadAndSetFromExistingVariable(varname, st)) {
@@ -480,28 +737,9 @@ class VarMap<vector<T> > : public VarMapImpl<vector<T>, VarMap<vector<T> > > {
       vector<T> value;
       int element_idx = 0;
       while (st.Peek() != "}") {
-        // Copy the environment, since we create fake names for each element.
-        shared_ptr<Environment> env_ptr(Base::env()->Copy());
-        ostringstream element_name_oss;
-        element_name_oss << "____" << varname << "_" << (element_idx++)
-                         << "____";
-        string element_name = element_name_oss.str();
-
-        env_ptr->ReadAndSet(element_name, st, element_typename_);
-        VarMapBase *element_var_map =
-            env_ptr->GetVarMapForType(element_typename_);
-        VarMap<T> *typed_element_var_map =
-            dynamic_cast<VarMap<T> *>(element_var_map);
         T element;
-        if (typed_element_var_map->Get(element_name, &element)) {
-          value.push_back(element);
-        } else {
-          ostringstream err_ss;
-          err_ss << "VarMap<" << Base::Name() << ">::ReadAndSet: trouble "
-                 << "initializing element " << (element_idx - 1)
-                 << " of variable " << varname;
-          Error(err_ss.str());
-        }
+        ReadElement(varname, element_idx++, st, &element);
+        value.push_back(element);
         // Each vector element initializer must be followed by a comma
         // or the final closing parenthesis.
         if (st.Peek() != ","  && st.Peek() != "}") {
@@ -518,16 +756,259 @@ class VarMap<vector<T> > : public VarMapImpl<vector<T>, VarMap<vector<T> > > {
       }
       // Consume close brace.
       st.Next();
-
+      TraceVectorRead(value.size(), &span);
 
       // Finally, set the newly-constructed value.
       this->Set(varname, value);
+    } else {
+      span.Discard();
+    }
+  }
+
+  /// \copydoc VarMapBase::ReadAndAppend
+  ///
+  /// The elements are read into a temporary variable and then moved to
+  /// the end of the stored vector, whose capacity grows geometrically,
+  /// so that appending takes amortized constant time per element
+  /// however long the vector already is.  Other variables never share
+  /// the stored vector, since assigning one variable to another copies
+  /// its value, so none of them is affected; the elements themselves
+  /// are not copied deeply, so a vector of objects shares them with
+  /// the value appended.
+  virtual void ReadAndAppend(const string &varname, StreamTokenizer &st) {
+    if (Base::MutableValue(varname) == nullptr) {
+      ostringstream err_ss;
+      err_ss << "VarMap<" << Base::Name() << ">: error: cannot append to "
+             << "undefined variable " << varname;
+      Error(err_ss.str());
+    }
+    string appended_name = "____" + varname + "_appended____";
+    ReadAndSet(appended_name, st);
+    vector<T> *appended = Base::MutableValue(appended_name);
+    if (appended != nullptr) {
+      vector<T> *value = Base::MutableValue(varname);
+      value->insert(value->end(), std::make_move_iterator(appended->begin()),
+                    std::make_move_iterator(appended->end()));
+      Base::Erase(appended_name);
     }
   }
  private:
+  /// The minimum number of elements for the reading of a vector to be
+  /// recorded as a trace span, so that small vectors do not flood the
+  /// timeline.
+  static const size_t kMinTracedSize = 1000;
+
+  /// Records the reading of a vector with the specified number of
+  /// elements in the specified span if the vector is large enough,
+  /// and discards the span otherwise.
+  void TraceVectorRead(size_t size, TraceSpan *span) {
+    if (span->active() && size >= kMinTracedSize) {
+      span->SetArg("elements", std::to_string(size));
+    } else {
+      span->Discard();
+    }
+  }
+
+  /// Reads the element of the specified vector variable at the
+  /// specified index, which may be a literal, a spec string or the name
+  /// of a variable.
+  void ReadElement(const string &varname, int element_idx,
+                   StreamTokenizer &st, T *element) {
+    // Use a child environment, since we create fake names for each element.
+    shared_ptr<Environment> env_ptr(Base::env()->CreateChild());
+    ostringstream element_name_oss;
+    element_name_oss << "____" << varname << "_" << element_idx << "____";
+    string element_name = element_name_oss.str();
+
+    env_ptr->ReadAndSet(element_name, st, element_typename_);
+    VarMapBase *element_var_map =
+        env_ptr->GetVarMapForType(element_typename_);
+    INFACT_STATS_INC(dynamic_casts);
+    VarMap<T> *typed_element_var_map =
+        dynamic_cast<VarMap<T> *>(element_var_map);
+    if (!typed_element_var_map->Get(element_name, element)) {
+      ostringstream err_ss;
+      err_ss << "VarMap<" << Base::Name() << ">::ReadAndSet: trouble "
+             << "initializing element " << element_idx
+             << " of variable " << varname;
+      Error(err_ss.str());
+    }
+  }
+
+  /// Reads the generator expression with the specified name, such as
+  /// <tt>range(0, 10)</tt>, and fills the specified vector with the
+  /// values it generates.
+  void ReadGenerator(const string &varname, const string &generator,
+                     StreamTokenizer &st, vector<T> *value) {
+    size_t generator_start = st.PeekTokenStart();
+    // Consume generator name and open parenthesis.
+    st.Next();
+    st.Next();
+    if (generator == "repeat") {
+      // The repeated value may be anything that may appear as an element
+      // of a brace-enclosed list, so it is read the same way.
+      T element;
+      ReadElement(varname, 0, st, &element);
+      if (st.Peek() != ",") {
+        ostringstream err_ss;
+        err_ss << "Generator repeat: error: expected ',' at stream position "
+               << st.PeekTokenStart() << " but found \"" << st.Peek() << "\"";
+        Error(err_ss.str());
+      }
+      st.Next();
+      value->assign(ReadGeneratorCount(generator, st), element);
+    } else if (!SequenceGenerator<T>::kNumeric) {
+      ostringstream err_ss;
+      err_ss << "VarMap<" << Base::Name() << ">::ReadAndSet: error: "
+             << "generator " << generator << " at stream position "
+             << generator_start << " requires numeric elements, but "
+             << "elements of " << varname << " are of type "
+             << element_typename_;
+      Error(err_ss.str());
+    } else if (generator == "range") {
+      SequenceGenerator<T>::Range(st, value);
+    } else if (generator == "linspace") {
+      SequenceGenerator<T>::Linspace(st, value);
+    } else {
+      SequenceGenerator<T>::File(st, value);
+    }
+  }
+
   string element_typename_;
 };
 
+/// A partial specialization to allow initialization of a map from
+/// string keys to values, where the values can either be literals (if
+/// T is a primitive type), spec strings for constructing
+/// \link Factory\endlink-constructible objects, or variable names (where
+/// each variable must be of type T).  Entries are read directly into
+/// the hash table held by this variable map, so consumers need not
+/// rebuild a lookup table from parallel vectors of keys and values.
+///
+/// \tparam T the value type for maps stored in this variable map
+template <typename T>
+class VarMap<unordered_map<string, T> > :
+      public VarMapImpl<unordered_map<string, T>,
+                        VarMap<unordered_map<string, T> > > {
+ public:
+  typedef VarMapImpl<unordered_map<string, T>,
+                     VarMap<unordered_map<string, T> > > Base;
+
+  /// Constructs a mapping from variables of a particular type to their values.
+  ///
+  /// \param name           the type name of the variables in this instance
+  /// \param value_typename the type name of the values of the maps
+  ///                       held by this instance
+  /// \param env            the \link infact::Environment Environment \endlink
+  ///                       that contains this VarMap instance
+  /// \param is_primitive   whether the values of the maps held in this
+  ///                       variable map are primitives
+  VarMap(const string &name, const string &value_typename, Environment *env,
+         bool is_primitive = true)
+      : Base(name, env, is_primitive), value_typename_(value_typename) { }
+
+  /// Constructs an empty mapping for variables of the same type as the
+  /// specified instance.
+  ///
+  /// \param other the instance whose type names and primitiveness to copy
+  /// \param env   the \link infact::Environment Environment \endlink
+  ///              that contains this VarMap instance
+  VarMap(const VarMap &other, Environment *env)
+      : Base(other.Name(), env, other.IsPrimitive()),
+        value_typename_(other.value_typename_) { }
+
+  virtual ~VarMap() { }
+
+  virtual void ReadAndSet(const string &varname, StreamTokenizer &st) {
+    // First check if next token is an identifier and is a variable in
+    // the environment, set varname to its value.
+    if (Base::ReadAndSetFromExistingVariable(varname, st)) {
+      return;
+    }
+
+    if (st.Peek() == "{") {
+      // Consume open brace.
+      st.Next();
+    } else {
+      ostringstream err_ss;
+      err_ss << "VarMap<map<T>>: "
+             << "error: expected '{' at stream position "
+             << st.PeekTokenStart() << " but found \""
+             << st.Peek() << "\"";
+      Error(err_ss.str());
+    }
+
+    // Unlike the elements of a vector, the values of a map all share a
+    // single child environment, since each value simply overwrites the
+    // previous one under the same fake name.
+    shared_ptr<Environment> env_ptr(Base::env()->CreateChild());
+    string value_name = "____" + varname + "_value____";
+
+    unordered_map<string, T> value;
+    while (st.Peek() != "}") {
+      if (st.PeekTokenType() != StreamTokenizer::STRING) {
+        ostringstream err_ss;
+        err_ss << "VarMap<" << Base::Name() << ">::ReadAndSet: error: "
+               << "expected string key at stream position "
+               << st.PeekTokenStart() << " but found \"" << st.Peek() << "\"";
+        Error(err_ss.str());
+      }
+      size_t key_start = st.PeekTokenStart();
+      string key = st.Next();
+      if (st.Peek() != ":") {
+        ostringstream err_ss;
+        err_ss << "VarMap<" << Base::Name() << ">::ReadAndSet: error: "
+               << "expected ':' at stream position "
+               << st.PeekTokenStart() << " but found \"" << st.Peek() << "\"";
+        Error(err_ss.str());
+      }
+      // Consume colon.
+      st.Next();
+
+      env_ptr->ReadAndSet(value_name, st, value_typename_);
+      VarMapBase *value_var_map = env_ptr->GetVarMapForType(value_typename_);
+      INFACT_STATS_INC(dynamic_casts);
+      VarMap<T> *typed_value_var_map = dynamic_cast<VarMap<T> *>(value_var_map);
+      T element = T();
+      if (typed_value_var_map == nullptr ||
+          !typed_value_var_map->Get(value_name, &element)) {
+        ostringstream err_ss;
+        err_ss << "VarMap<" << Base::Name() << ">::ReadAndSet: trouble "
+               << "initializing value for key \"" << key << "\" of variable "
+               << varname;
+        Error(err_ss.str());
+      }
+      if (!value.insert(std::make_pair(key, element)).second) {
+        ostringstream err_ss;
+        err_ss << "VarMap<" << Base::Name() << ">::ReadAndSet: error: "
+               << "duplicate key \"" << key << "\" at stream position "
+               << key_start << " for variable " << varname;
+        Error(err_ss.str());
+      }
+
+      // Each map entry must be followed by a comma or the final
+      // closing brace.
+      if (st.Peek() != ","  && st.Peek() != "}") {
+        ostringstream err_ss;
+        err_ss << "VarMap<" << Base::Name() << ">::ReadAndSet: "
+               << "error: expected ',' or '}' at stream position "
+               << st.PeekTokenStart() << " but found \"" << st.Peek() << "\"";
+        Error(err_ss.str());
+      }
+      // Read comma, if present.
+      if (st.Peek() == ",") {
+        st.Next();
+      }
+    }
+    // Consume close brace.
+    st.Next();
+
+    this->Set(varname, std::move(value));
+  }
+ private:
+  string value_typename_;
+};
+
 }  // namespace infact
 
 #endif
@@ -32,6 +32,9 @@
 /// \file
 /// Provides implementations of the various example classes.
 
+#include <cstdlib>
+#include <cstring>
+
 #include "example.h"
 #include "environment-impl.h"
 
@@ -43,6 +46,13 @@ namespace infact {
 // For compactness, we have this single .C file, so everything is
 // lumped together.
 
+IMPLEMENT_ENUM(Color)
+REGISTER_ENUM_VALUE(Color, BROWN)
+REGISTER_ENUM_VALUE(Color, WHITE)
+REGISTER_ENUM_VALUE(Color, BLACK_AND_WHITE)
+
+REGISTER_VALUE_TYPE_WITH_RECOGNIZER(Duration, IsDurationLiteral)
+
 IMPLEMENT_FACTORY(Date)
 REGISTER_DATE(DateImpl)
 
@@ -56,6 +66,75 @@ REGISTER_ANIMAL(Sheep)
 IMPLEMENT_FACTORY(PetOwner)
 REGISTER_PET_OWNER(HumanPetOwner)
 
+namespace {
+
+// The units of duration literals, from largest to smallest, and their
+// lengths in nanoseconds.
+const struct {
+  const char *name;
+  int64_t nanos;
+} kDurationUnits[] = {
+  {"h", 3600 * 1000000000LL},
+  {"m", 60 * 1000000000LL},
+  {"s", 1000000000LL},
+  {"ms", 1000000LL},
+  {"us", 1000LL},
+  {"ns", 1LL},
+};
+const size_t kNumDurationUnits =
+    sizeof(kDurationUnits) / sizeof(kDurationUnits[0]);
+
+// Splits a duration literal into its number and the length of its
+// unit, returning whether it is well formed.
+bool ParseDuration(const string &literal, double *number, int64_t *unit) {
+  const char *begin = literal.c_str();
+  char *end = nullptr;
+  *number = strtod(begin, &end);
+  if (end == begin) {
+    return false;
+  }
+  for (size_t i = 0; i < kNumDurationUnits; ++i) {
+    if (strcmp(end, kDurationUnits[i].name) == 0) {
+      *unit = kDurationUnits[i].nanos;
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+bool IsDurationLiteral(StreamTokenizer::TokenType token_type,
+                       const string &token) {
+  double number;
+  int64_t unit;
+  return token_type == StreamTokenizer::NUMBER &&
+      ParseDuration(token, &number, &unit);
+}
+
+bool
+Initializer<Duration>::Decode(const string &literal, Duration *value) const {
+  double number;
+  int64_t unit;
+  if (!ParseDuration(literal, &number, &unit)) {
+    return false;
+  }
+  value->nanos = static_cast<int64_t>(number * unit + (number < 0 ? -.5 : .5));
+  return true;
+}
+
+string
+ValueString<Duration>::ToString(const Duration &value) const {
+  size_t i = 0;
+  while (i + 1 < kNumDurationUnits &&
+         value.nanos % kDurationUnits[i].nanos != 0) {
+    ++i;
+  }
+  ostringstream oss;
+  oss << value.nanos / kDurationUnits[i].nanos << kDurationUnits[i].name;
+  return oss.str();
+}
+
 void Sheep::PostInit(const Environment *env, const string &init_str) {
   int env_age;
   // Note how we need to cast Environment down to EnvironmentImpl,
@@ -40,12 +40,83 @@
 #ifndef INFACT_EXAMPLE_H_
 #define INFACT_EXAMPLE_H_
 
+#include <cstdint>
 #include <string>
 
+#include "enum.h"
 #include "factory.h"
+#include "value-type.h"
 
 namespace infact {
 
+/// The coat colors of an animal, to show how values of an enumerated
+/// type may be specified by name.  Please see the \link IMPLEMENT_ENUM
+/// \endlink and \link REGISTER_ENUM_VALUE \endlink declarations in
+/// example.cc.
+enum Color { BROWN, WHITE, BLACK_AND_WHITE };
+
+/// A length of time, to show how a domain value type may be registered
+/// so that its literals, such as <tt>30s</tt> or <tt>250ms</tt>, are
+/// decoded once, when a specification is read.  Please see the \link
+/// REGISTER_VALUE_TYPE_WITH_RECOGNIZER \endlink declaration in
+/// example.cc.
+struct Duration {
+  /// Constructs a duration of the specified number of nanoseconds.
+  explicit Duration(int64_t n = 0) : nanos(n) { }
+
+  bool operator==(const Duration &other) const {
+    return nanos == other.nanos;
+  }
+
+  /// The length of this duration, in nanoseconds.
+  int64_t nanos;
+};
+
+/// Returns whether the specified token is a duration literal: a
+/// number followed by one of the units <tt>ns</tt>, <tt>us</tt>,
+/// <tt>ms</tt>, <tt>s</tt>, <tt>m</tt> or <tt>h</tt>.
+bool IsDurationLiteral(StreamTokenizer::TokenType token_type,
+                       const string &token);
+
+/// A specialization so that a <tt>Duration</tt> converts to
+/// <tt>"duration"</tt>.
+template <>
+class TypeName<Duration> {
+ public:
+  string ToString() {
+    return "duration";
+  }
+};
+
+/// A specialization to initialize <tt>Duration</tt> data members from
+/// duration literals.
+template <>
+class Initializer<Duration> : public LiteralInitializer<Duration> {
+ public:
+  Initializer(Duration *member) : LiteralInitializer<Duration>(member) { }
+  virtual ~Initializer() { }
+  /// \copydoc LiteralInitializer::Decode
+  virtual bool Decode(const string &literal, Duration *value) const;
+};
+
+/// A specialization of the ValueString class to print durations in
+/// the largest unit that represents them exactly.
+template <>
+class ValueString<Duration> {
+ public:
+  string ToString(const Duration &value) const;
+};
+
+/// A specialization of the ValueHash class for durations, required
+/// since <tt>std::hash</tt> does not support them.
+template <>
+class ValueHash<Duration> {
+ public:
+  size_t Hash(const Duration &value) const {
+    return std::hash<int64_t>()(value.nanos);
+  }
+};
+
 /// An interface to represent a date.
 class Date : public FactoryConstructible {
  public:
@@ -181,6 +252,8 @@ public:
   /// Constructs a cow.
   Cow() : Animal() {
     age_ = 2; // default age, since age is optional
+    color_ = BROWN; // default color, since color is optional
+    milking_interval_ = Duration(12 * 3600 * 1000000000LL);
   }
 
   // Destroys this instance.
@@ -189,14 +262,28 @@ public:
   virtual void RegisterInitializers(Initializers &initializers) {
     INFACT_ADD_REQUIRED_PARAM_(name);
     INFACT_ADD_PARAM_(age);
+    INFACT_ADD_PARAM_(color);
+    INFACT_ADD_PARAM_(calf);
+    INFACT_ADD_PARAM_(milking_interval);
   }
 
   /// Returns the name of this animal.
   virtual const string &name() const { return name_; }
   virtual int age() const { return age_; }
+  /// Returns the color of this cow.
+  Color color() const { return color_; }
+  /// Returns the calf of this cow, or <tt>nullptr</tt> if it has none.
+  /// Since a calf may have a calf of its own, specs for cows may be
+  /// nested arbitrarily deeply.
+  shared_ptr<Animal> calf() const { return calf_; }
+  /// Returns the time between milkings of this cow.
+  Duration milking_interval() const { return milking_interval_; }
 private:
   string name_;
   int age_;
+  Color color_;
+  shared_ptr<Animal> calf_;
+  Duration milking_interval_;
 };
 
 /// A sheep.  Unlike other animals, sheep are always twice the age you
@@ -0,0 +1,344 @@
+// Copyright 2014, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   * Redistributions of source code must retain the above copyright
+//     notice, this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above
+//     copyright notice, this list of conditions and the following disclaimer
+//     in the documentation and/or other materials provided with the
+//     distribution.
+//   * Neither the name of Google Inc. nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+//
+//
+/// \file
+/// Implementation of the \link infact::ExternalArray ExternalArray
+/// \endlink class.
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <sstream>
+
+#include "error.h"
+#include "external-array.h"
+#include "file-loader.h"
+#include "generators.h"
+
+namespace infact {
+
+using std::ifstream;
+using std::ostringstream;
+
+namespace {
+
+// The information held in the header of a .npy file.
+struct NpyHeader {
+  // The offset of the array data from the start of the file.
+  size_t data_start;
+  // The type descriptor, including its byte-order character, e.g., "<f8".
+  string descr;
+  bool fortran_order;
+  vector<size_t> shape;
+};
+
+bool LittleEndianHost() {
+  uint16_t one = 1;
+  return *reinterpret_cast<uint8_t *>(&one) == 1;
+}
+
+bool EndsWith(const string &s, const string &suffix) {
+  return s.length() >= suffix.length() &&
+      s.compare(s.length() - suffix.length(), suffix.length(), suffix) == 0;
+}
+
+// Returns the length of the preamble of a .npy file, i.e., of everything
+// before its header dictionary, and sets header_length to the length of
+// that dictionary, or returns 0 if the preamble is malformed.
+size_t ParseNpyPreamble(const uint8_t *bytes, size_t size,
+                        size_t *header_length) {
+  static const char kMagic[] = "\x93NUMPY";
+  if (size < 10 || memcmp(bytes, kMagic, 6) != 0) {
+    return 0;
+  }
+  uint8_t major_version = bytes[6];
+  if (major_version == 1) {
+    *header_length = bytes[8] | (bytes[9] << 8);
+    return 10;
+  }
+  if ((major_version == 2 || major_version == 3) && size >= 12) {
+    *header_length = bytes[8] | (bytes[9] << 8) | (bytes[10] << 16) |
+        (static_cast<size_t>(bytes[11]) << 24);
+    return 12;
+  }
+  return 0;
+}
+
+// Returns the text just after the colon that follows the specified key
+// of a .npy header dictionary, or npos if the key is absent.
+size_t FindNpyValue(const string &header, const string &key) {
+  size_t key_pos = header.find("'" + key + "'");
+  if (key_pos == string::npos) {
+    return string::npos;
+  }
+  size_t colon_pos = header.find(':', key_pos);
+  if (colon_pos == string::npos) {
+    return string::npos;
+  }
+  return header.find_first_not_of(" ", colon_pos + 1);
+}
+
+// Parses the preamble and header dictionary of a .npy file, such as
+// {'descr': '<f8', 'fortran_order': False, 'shape': (3, 4), }.
+bool ParseNpyHeader(const uint8_t *bytes, size_t size, NpyHeader *npy) {
+  size_t header_length = 0;
+  size_t header_start = ParseNpyPreamble(bytes, size, &header_length);
+  if (header_start == 0 || header_start + header_length > size) {
+    return false;
+  }
+  string header(reinterpret_cast<const char *>(bytes) + header_start,
+                header_length);
+  npy->data_start = header_start + header_length;
+
+  size_t descr_pos = FindNpyValue(header, "descr");
+  if (descr_pos == string::npos ||
+      (header[descr_pos] != '\'' && header[descr_pos] != '"')) {
+    return false;
+  }
+  size_t descr_end = header.find(header[descr_pos], descr_pos + 1);
+  if (descr_end == string::npos) {
+    return false;
+  }
+  npy->descr = header.substr(descr_pos + 1, descr_end - descr_pos - 1);
+
+  size_t fortran_pos = FindNpyValue(header, "fortran_order");
+  if (fortran_pos == string::npos) {
+    return false;
+  }
+  npy->fortran_order = header.compare(fortran_pos, 4, "True") == 0;
+
+  size_t shape_pos = FindNpyValue(header, "shape");
+  if (shape_pos == string::npos || header[shape_pos] != '(') {
+    return false;
+  }
+  size_t shape_end = header.find(')', shape_pos);
+  if (shape_end == string::npos) {
+    return false;
+  }
+  npy->shape.clear();
+  const char *dim = header.c_str() + shape_pos + 1;
+  const char *end = header.c_str() + shape_end;
+  while (dim < end) {
+    char *dim_end = nullptr;
+    unsigned long long dim_size = strtoull(dim, &dim_end, 10);
+    if (dim_end == dim) {
+      // No more digits, only whitespace or a trailing comma.
+      break;
+    }
+    npy->shape.push_back(static_cast<size_t>(dim_size));
+    dim = dim_end;
+    while (dim < end && (*dim == ',' || *dim == ' ')) {
+      ++dim;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+void
+ExternalArray::Read(StreamTokenizer &st, size_t element_size,
+                    const char *descr) {
+  size_t file_start = st.PeekPrevTokenStart();
+  string path;
+  int64_t offset = 0;
+  int64_t count = -1;
+  bool done = ReadGeneratorArgument("file", st, &path);
+  if (!done) {
+    done = ReadGeneratorArgument("file", st, &offset);
+  }
+  if (!done && !ReadGeneratorArgument("file", st, &count)) {
+    ostringstream err_ss;
+    err_ss << "ExternalArray: error: too many arguments for file expression "
+           << "at stream position " << file_start;
+    Error(err_ss.str());
+  }
+  if (offset < 0 || (count < 0 && count != -1)) {
+    ostringstream err_ss;
+    err_ss << "ExternalArray: error: negative offset or count for file "
+           << "expression at stream position " << file_start;
+    Error(err_ss.str());
+  }
+
+  // Use the copy of the file requested ahead of time, if any.
+  FileLoader *loader = FileLoader::current();
+  FileContents contents = loader != nullptr ?
+      loader->Get(path) : FileLoader::Load(path, false);
+  if (!contents.ok()) {
+    Error("ExternalArray: error: " + contents.error);
+  }
+  mapping_ = contents.data;
+  size_t file_size = contents.size;
+  const uint8_t *bytes = mapping_.get();
+
+  size_t data_start = 0;
+  size_t data_size = file_size;
+  bool is_npy = EndsWith(path, ".npy");
+  NpyHeader npy;
+  byte_swapped_ = false;
+  if (is_npy) {
+    if (!ParseNpyHeader(bytes, file_size, &npy)) {
+      ostringstream err_ss;
+      err_ss << "ExternalArray: error: malformed .npy file \"" << path << "\"";
+      Error(err_ss.str());
+    }
+    char byte_order = npy.descr.empty() ? '?' : npy.descr[0];
+    string type = npy.descr.substr(1);
+    if (type != descr || (byte_order != '<' && byte_order != '>' &&
+                          byte_order != '=' && byte_order != '|')) {
+      ostringstream err_ss;
+      err_ss << "ExternalArray: error: .npy file \"" << path << "\" holds "
+             << "elements of type '" << npy.descr << "' but expected '"
+             << descr << "'";
+      Error(err_ss.str());
+    }
+    if (npy.fortran_order && npy.shape.size() > 1) {
+      ostringstream err_ss;
+      err_ss << "ExternalArray: error: .npy file \"" << path << "\" is in "
+             << "Fortran order, which is not supported";
+      Error(err_ss.str());
+    }
+    byte_swapped_ = (byte_order == '<' && !LittleEndianHost()) ||
+        (byte_order == '>' && LittleEndianHost());
+    // Reject a shape whose size in bytes cannot be represented, rather
+    // than let it wrap around to a size that the file appears to hold.
+    size_t max_elements = std::numeric_limits<size_t>::max() / element_size;
+    size_t num_elements = 1;
+    bool overflows = false;
+    for (size_t i = 0; i < npy.shape.size(); ++i) {
+      if (npy.shape[i] == 0) {
+        num_elements = 0;
+        overflows = false;
+        break;
+      }
+      overflows = overflows || num_elements > max_elements / npy.shape[i];
+      num_elements *= npy.shape[i];
+    }
+    if (overflows) {
+      ostringstream err_ss;
+      err_ss << "ExternalArray: error: .npy file \"" << path << "\" has a "
+             << "shape with too many elements";
+      Error(err_ss.str());
+    }
+    data_start = npy.data_start;
+    data_size = num_elements * element_size;
+    if (data_size > file_size - data_start) {
+      ostringstream err_ss;
+      err_ss << "ExternalArray: error: .npy file \"" << path << "\" is "
+             << "truncated";
+      Error(err_ss.str());
+    }
+  }
+
+  size_t offset_bytes = static_cast<size_t>(offset);
+  if (offset_bytes > data_size) {
+    ostringstream err_ss;
+    err_ss << "ExternalArray: error: offset " << offset << " is past the end "
+           << "of the " << data_size << " bytes of array data in file \""
+           << path << "\"";
+    Error(err_ss.str());
+  }
+  size_t available = (data_size - offset_bytes) / element_size;
+  if (count == -1) {
+    if ((data_size - offset_bytes) % element_size != 0) {
+      ostringstream err_ss;
+      err_ss << "ExternalArray: error: the " << (data_size - offset_bytes)
+             << " bytes of array data in file \"" << path << "\" are not a "
+             << "whole number of " << element_size << "-byte elements";
+      Error(err_ss.str());
+    }
+    size_ = available;
+  } else if (static_cast<size_t>(count) > available) {
+    ostringstream err_ss;
+    err_ss << "ExternalArray: error: requested " << count << " elements but "
+           << "file \"" << path << "\" holds only " << available
+           << " at offset " << offset;
+    Error(err_ss.str());
+  } else {
+    size_ = static_cast<size_t>(count);
+  }
+  data_ = bytes == nullptr ? nullptr : bytes + data_start + offset_bytes;
+
+  // Only an entire .npy array retains its shape.
+  if (is_npy && offset == 0 && count == -1 && !npy.shape.empty()) {
+    shape_ = npy.shape;
+  } else {
+    shape_.assign(1, size_);
+  }
+}
+
+void
+ExternalArray::CopyTo(void *dest, size_t element_size) const {
+  if (size_ == 0) {
+    return;
+  }
+  memcpy(dest, data_, size_ * element_size);
+  if (byte_swapped_) {
+    uint8_t *element = static_cast<uint8_t *>(dest);
+    for (size_t i = 0; i < size_; ++i, element += element_size) {
+      std::reverse(element, element + element_size);
+    }
+  }
+}
+
+bool
+ExternalArray::PeekNpyType(const string &path, string *descr, size_t *rank) {
+  ifstream file(path.c_str(), std::ios::binary);
+  // Read the fixed-length preamble (of at most 12 bytes), and then the
+  // rest of the header, whose length the preamble specifies.
+  vector<uint8_t> bytes(12);
+  if (!file.read(reinterpret_cast<char *>(bytes.data()), bytes.size())) {
+    return false;
+  }
+  size_t header_length = 0;
+  size_t header_start = ParseNpyPreamble(bytes.data(), bytes.size(),
+                                         &header_length);
+  if (header_start == 0 || header_start + header_length < bytes.size()) {
+    return false;
+  }
+  bytes.resize(header_start + header_length);
+  if (!file.read(reinterpret_cast<char *>(bytes.data()) + 12,
+                 bytes.size() - 12)) {
+    return false;
+  }
+  NpyHeader npy;
+  if (!ParseNpyHeader(bytes.data(), bytes.size(), &npy) ||
+      npy.descr.empty()) {
+    return false;
+  }
+  *descr = npy.descr.substr(1);
+  *rank = npy.shape.size();
+  return true;
+}
+
+}  // namespace infact
@@ -0,0 +1,173 @@
+// Copyright 2014, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   * Redistributions of source code must retain the above copyright
+//     notice, this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above
+//     copyright notice, this list of conditions and the following disclaimer
+//     in the documentation and/or other materials provided with the
+//     distribution.
+//   * Neither the name of Google Inc. nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+//
+//
+/// \file
+/// Provides the \link infact::ExternalArray ExternalArray \endlink
+/// class, for numeric arrays whose elements live in a separate binary
+/// file rather than in the text of a specification.
+
+#ifndef INFACT_EXTERNAL_ARRAY_H_
+#define INFACT_EXTERNAL_ARRAY_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "stream-tokenizer.h"
+
+namespace infact {
+
+using std::shared_ptr;
+using std::string;
+using std::vector;
+
+/// Provides the NumPy type descriptor, without its byte-order
+/// character, of each numeric type that may be read from an external
+/// array, such as <tt>"f8"</tt> for <tt>double</tt>.  For all other
+/// types, \link Value \endlink returns <tt>nullptr</tt>.
+template <typename T>
+class NpyDescr {
+ public:
+  static const char *Value() { return nullptr; }
+};
+
+template <>
+class NpyDescr<int> {
+ public:
+  static const char *Value() { return "i4"; }
+};
+
+template <>
+class NpyDescr<int64_t> {
+ public:
+  static const char *Value() { return "i8"; }
+};
+
+template <>
+class NpyDescr<uint64_t> {
+ public:
+  static const char *Value() { return "u8"; }
+};
+
+template <>
+class NpyDescr<float> {
+ public:
+  static const char *Value() { return "f4"; }
+};
+
+template <>
+class NpyDescr<double> {
+ public:
+  static const char *Value() { return "f8"; }
+};
+
+/// A read-only view of a contiguous array of numbers held in a file,
+/// specified by the expression
+/// \code
+/// file("path" [, offset [, count]])
+/// \endcode
+/// where <tt>offset</tt> is the number of bytes to skip from the start
+/// of the array data and <tt>count</tt> the number of elements to read,
+/// defaulting to all remaining elements.  The file is either raw
+/// native-endian data, whose element type is that of the variable being
+/// initialized, or, if its name ends in <tt>.npy</tt>, a NumPy array
+/// file, whose element type must match.
+///
+/// The file is mapped into memory read-only, so that, when the data is
+/// suitably aligned and of native byte order, consumers such as \link
+/// infact::Tensor Tensor \endlink can use it in place; otherwise the
+/// elements are copied (and byte-swapped, if need be) with \link CopyTo
+/// \endlink.  If the file cannot be mapped, it is read into memory in
+/// a single bulk read instead.
+class ExternalArray {
+ public:
+  /// Constructs an empty array.
+  ExternalArray() : data_(nullptr), size_(0), byte_swapped_(false) { }
+
+  /// Reads the arguments of a <tt>file</tt> expression, just after its
+  /// open parenthesis, and maps the array they specify.
+  ///
+  /// \param st           the stream from which to read the arguments
+  /// \param element_size the size in bytes of each element
+  /// \param descr        the NumPy type descriptor of each element, as
+  ///                     provided by \link NpyDescr \endlink
+  void Read(StreamTokenizer &st, size_t element_size, const char *descr);
+
+  /// Returns the number of elements in this array.
+  size_t size() const { return size_; }
+
+  /// Returns the shape of this array, which has a single dimension
+  /// unless this array was read in its entirety from a
+  /// multi-dimensional <tt>.npy</tt> file.
+  const vector<size_t> &shape() const { return shape_; }
+
+  /// Returns a pointer to the first element of this array in the
+  /// mapped file, which remains valid as long as some copy of
+  /// \link mapping \endlink does.
+  const uint8_t *data() const { return data_; }
+
+  /// Returns a shared pointer that keeps the underlying file mapped.
+  const shared_ptr<const uint8_t> &mapping() const { return mapping_; }
+
+  /// Returns whether the elements of this array may be used in place,
+  /// i.e., whether they are of native byte order and aligned to the
+  /// specified number of bytes.
+  bool InPlace(size_t alignment) const {
+    return !byte_swapped_ &&
+        reinterpret_cast<uintptr_t>(data_) % alignment == 0;
+  }
+
+  /// Copies the elements of this array to the specified buffer,
+  /// byte-swapping each if need be.
+  void CopyTo(void *dest, size_t element_size) const;
+
+  /// Peeks at the header of the specified <tt>.npy</tt> file to determine
+  /// the type of its elements.
+  ///
+  /// \param      path  the path of the <tt>.npy</tt> file
+  /// \param[out] descr the NumPy type descriptor of its elements, without
+  ///                   the byte-order character
+  /// \param[out] rank  the number of dimensions of the array it holds
+  /// \return whether the file could be read and its header parsed
+  static bool PeekNpyType(const string &path, string *descr, size_t *rank);
+
+ private:
+  shared_ptr<const uint8_t> mapping_;
+  const uint8_t *data_;
+  size_t size_;
+  vector<size_t> shape_;
+  bool byte_swapped_;
+};
+
+}  // namespace infact
+
+#endif
@@ -36,6 +36,7 @@
 #ifndef INFACT_FACTORY_H_
 #define INFACT_FACTORY_H_
 
+#include <cstdint>
 #include <iostream>
 #include <sstream>
 #include <memory>
@@ -43,10 +44,14 @@
 #include <unordered_set>
 #include <vector>
 #include <stdexcept>
+#include <typeinfo>
 
 #include "environment.h"
 #include "error.h"
+#include "memory-usage.h"
+#include "stats.h"
 #include "stream-tokenizer.h"
+#include "trace.h"
 
 /// A macro to make it easy to register a parameter for initialization
 /// inside a <tt>RegisterInitializers</tt> implementation, in a very
@@ -150,7 +155,12 @@ using std::vector;
 /// Factory\endlink-constructible types, returning the result of the
 /// \link infact::Factory::BaseName Factory::BaseName \endlink
 /// method for an instance of <tt>Factory\<T\></tt>.
-template <typename T>
+///
+/// \tparam T      the C++ type whose type name string is desired
+/// \tparam Enable a parameter allowing whole families of types, such as
+///                all enumerated types, to be handled by a single partial
+///                specialization
+template <typename T, typename Enable = void>
 class TypeName {
  public:
   string ToString() {
@@ -178,6 +188,36 @@ class TypeName<int> {
   }
 };
 
+/// A specialization so that an object of type <tt>int64_t</tt>
+/// converts to <tt>"int64"</tt>.
+template <>
+class TypeName<int64_t> {
+ public:
+  string ToString() {
+    return "int64";
+  }
+};
+
+/// A specialization so that an object of type <tt>uint64_t</tt>
+/// converts to <tt>"uint64"</tt>.
+template <>
+class TypeName<uint64_t> {
+ public:
+  string ToString() {
+    return "uint64";
+  }
+};
+
+/// A specialization so that an object of type <tt>float</tt>
+/// converts to <tt>"float"</tt>.
+template <>
+class TypeName<float> {
+ public:
+  string ToString() {
+    return "float";
+  }
+};
+
 /// A specialization so that an object of type <tt>double</tt>
 /// converts to <tt>"double"</tt>.
 template <>
@@ -198,6 +238,16 @@ class TypeName<string> {
   }
 };
 
+/// A specialization so that an object of type <tt>Bytes</tt>
+/// converts to <tt>"bytes"</tt>.
+template <>
+class TypeName<Bytes> {
+ public:
+  string ToString() {
+    return "bytes";
+  }
+};
+
 /// A partial specialization so that an object of type
 /// <tt>shared_ptr\<T\></tt>, where <tt>T</tt> is some \link
 /// infact::Factory Factory\endlink-constructible type, converts to
@@ -225,6 +275,19 @@ class TypeName<vector<T> > {
   }
 };
 
+/// A partial specialization so that an object of type
+/// <tt>unordered_map\<string, T\></tt> gets converted to the string
+/// <tt>"map<"</tt> followed by the type name of <tt>T</tt> followed by
+/// <tt>">"</tt>; for example, <tt>unordered_map\<string, double\></tt>
+/// converts to <tt>"map<double>"</tt>.
+template <typename T>
+class TypeName<unordered_map<string, T> > {
+ public:
+  string ToString() {
+    return "map<" + TypeName<T>().ToString() + ">";
+  }
+};
+
 /// \class MemberInitializer
 ///
 /// An interface for data member initializers of members of a \link
@@ -268,6 +331,11 @@ class MemberInitializer {
   /// Whether this member is required to be initialized in a spec string.
   virtual bool Required() const { return required_; }
 
+  /// Returns an estimate of the number of bytes owned by the member
+  /// initialized by this instance beyond its own <tt>sizeof</tt>, or 0
+  /// if this instance initializes a temporary rather than a member.
+  virtual size_t HeapBytes(MemoryVisitor *visitor) const { return 0; }
+
  protected:
   /// The name of this member.
   string name_;
@@ -310,6 +378,7 @@ class TypedMemberInitializer : public MemberInitializer {
     env->ReadAndSet(Name(), st, TypeName<T>().ToString());
     if (member_ != nullptr) {
       VarMapBase *var_map = env->GetVarMap(Name());
+      INFACT_STATS_INC(dynamic_casts);
       VarMap<T> *typed_var_map = dynamic_cast<VarMap<T> *>(var_map);
       if (typed_var_map != nullptr) {
 	bool success = typed_var_map->Get(Name(), member_);
@@ -324,6 +393,12 @@ class TypedMemberInitializer : public MemberInitializer {
       ++initialized_;
     }
   }
+
+  /// \copydoc MemberInitializer::HeapBytes
+  virtual size_t HeapBytes(MemoryVisitor *visitor) const {
+    return member_ == nullptr ?
+        0 : MemorySize<T>().HeapBytes(*member_, visitor);
+  }
  protected:
   T *member_;
 };
@@ -447,6 +522,8 @@ class FactoryBase {
   virtual VarMapBase *CreateVarMap(Environment *env) const = 0;
 
   virtual VarMapBase *CreateVectorVarMap(Environment *env) const = 0;
+
+  virtual VarMapBase *CreateMapVarMap(Environment *env) const = 0;
 };
 
 /// A class to hold all \link Factory \endlink instances that have been created.
@@ -532,6 +609,13 @@ class Constructor {
  public:
   virtual ~Constructor() { }
   virtual T *NewInstance() const = 0;
+
+  /// Returns whether the specified object is an instance of the exact
+  /// type constructed by this instance.
+  virtual bool Constructs(const T *instance) const { return false; }
+
+  /// Returns the <tt>sizeof</tt> of the type constructed by this instance.
+  virtual size_t InstanceSize() const { return sizeof(T); }
 };
 
 /// An interface simply to make it easier to implement \link
@@ -613,7 +697,8 @@ class Factory : public FactoryBase {
   /// \endcode
   /// where the type of a member can be
   /// <ul><li>a primitive (a <tt>string</tt>, <tt>double</tt>,
-  ///         <tt>int</tt> or <tt>bool</tt>),
+  ///         <tt>float</tt>, <tt>int</tt>, <tt>int64</tt>,
+  ///         <tt>uint64</tt> or <tt>bool</tt>),
   ///     <li>a \link Factory\endlink-constructible type,
   ///     <li>a vector of primtives or
   ///     <li>a vector of types constructible by the same Factory.
@@ -675,7 +760,8 @@ class Factory : public FactoryBase {
   ///   <td><tt>\<member_init\></tt>
   ///   <td><tt>::=</tt></td>
   ///   <td><tt>\<primitive_init\> | \<factory_init\> |
-  ///           \<primitive_vector_init\> | \<factory_vector_init\> </tt></td>
+  ///           \<primitive_vector_init\> | \<factory_vector_init\> |
+  ///           \<map_init\></tt></td>
   /// </tr>
   /// <tr>
   ///   <td><tt>\<primitive_init\></tt></td>
@@ -692,7 +778,10 @@ class Factory : public FactoryBase {
   ///   <td><tt>\<literal\></tt></td>
   ///   <td><tt>::=</tt></td>
   ///   <td><tt>\<string_literal\> | \<double_literal\> |
-  ///           \<int_literal\> | \<bool_literal\></tt></td>
+  ///           \<float_literal\> | \<int_literal\> |
+  ///           \<int64_literal\> | \<uint64_literal\> |
+  ///           \<bool_literal\> | \<enum_literal\> |
+  ///           \<bytes_literal\></tt></td>
   /// </tr>
   /// <tr valign=top>
   ///   <td><tt>\<string_literal\></tt></td>
@@ -714,10 +803,41 @@ class Factory : public FactoryBase {
   ///   <td>a string that can be parsed by <tt>atoi</tt></td>
   /// </tr>
   /// <tr>
+  ///   <td><tt>\<float_literal\></tt></td>
+  ///   <td><tt>::=</tt></td>
+  ///   <td>a string that can be parsed by <tt>strtof</tt>, optionally
+  ///       followed by the suffix <tt>f</tt> or <tt>F</tt></td>
+  /// </tr>
+  /// <tr>
+  ///   <td><tt>\<int64_literal\></tt></td>
+  ///   <td><tt>::=</tt></td>
+  ///   <td>a string that can be parsed by <tt>strtoll</tt>, optionally
+  ///       followed by the suffix <tt>L</tt> or <tt>LL</tt></td>
+  /// </tr>
+  /// <tr>
+  ///   <td><tt>\<uint64_literal\></tt></td>
+  ///   <td><tt>::=</tt></td>
+  ///   <td>a string that can be parsed by <tt>strtoull</tt>, optionally
+  ///       followed by the suffix <tt>U</tt>, <tt>UL</tt> or <tt>ULL</tt></td>
+  /// </tr>
+  /// <tr>
   ///   <td><tt>\<bool_literal\></tt></td>
   ///   <td><tt>::=</tt></td>
   ///   <td><tt>true | false</tt></td>
   /// </tr>
+  /// <tr valign=top>
+  ///   <td><tt>\<bytes_literal\></tt></td>
+  ///   <td><tt>::=</tt></td>
+  ///   <td><tt>b64</tt> immediately followed by base64 text surrounded by
+  ///       double quotes, such as <tt>b64"aGVsbG8="</tt>; the text is
+  ///       decoded as it is read, and may contain whitespace</td>
+  /// </tr>
+  /// <tr>
+  ///   <td><tt>\<enum_literal\></tt></td>
+  ///   <td><tt>::=</tt></td>
+  ///   <td>the name of a value of an enumerated type registered via
+  ///       \link REGISTER_ENUM_VALUE \endlink</td>
+  /// </tr>
   /// <tr>
   ///   <td><tt>\<primitive_vector_init></tt></td>
   ///   <td><tt>::=</tt></td>
@@ -752,6 +872,20 @@ class Factory : public FactoryBase {
   ///       or is either <tt>'NULL'</tt> or <tt>'nullptr'</tt>
   ///   </td>
   /// </tr>
+  /// <tr>
+  ///   <td><tt>\<map_init\></tt></td>
+  ///   <td><tt>::=</tt></td>
+  ///   <td><tt>\<member_name\> '(' '{' \<map_entry_list\> '}' ')'</tt></td>
+  /// </tr>
+  /// <tr>
+  ///   <td valign=top><tt>\<map_entry_list\></tt></td>
+  ///   <td valign=top><tt>::=</tt></td>
+  ///   <td><tt>\<map_entry\> [ ',' \<map_entry\> ]* [',']</tt><br>
+  ///       where <tt>\<map_entry\> ::= \<string_literal\> ':' \<value\></tt>
+  ///       and every <tt>\<value\></tt> is a <tt>\<literal\></tt> or
+  ///       <tt>\<spec_or_null\></tt> of the same type; keys must be unique
+  ///   </td>
+  /// </tr>
   /// </table>
   ///
   /// \param st  the stream tokenizer providing tokens according to the
@@ -761,7 +895,8 @@ class Factory : public FactoryBase {
   ///            no calling environment
   shared_ptr<T> CreateOrDie(StreamTokenizer &st, Environment *env = nullptr) {
     shared_ptr<Environment> env_ptr(env == nullptr ?
-                                    Environment::CreateEmpty() : env->Copy());
+                                    Environment::CreateEmpty() :
+                                    env->CreateChild());
     size_t start = st.PeekTokenStart();
     StreamTokenizer::TokenType token_type = st.PeekTokenType();
     if (token_type == StreamTokenizer::RESERVED_WORD &&
@@ -780,6 +915,7 @@ class Factory : public FactoryBase {
 
     // Read the concrete type of object to be created.
     string type = st.Next();
+    TraceSpan span("create", type);
 
     // Read the open parenthesis token.
     if (st.Peek() != "(") {
@@ -843,7 +979,10 @@ class Factory : public FactoryBase {
       st.Next();
 
       // Initialize member based on following token(s).
-      member_initializer->Init(st, env_ptr.get());
+      {
+        TraceSpan member_span("member", member_name);
+        member_initializer->Init(st, env_ptr.get());
+      }
 
       // Read close parenthesis for current member initializer.
       if (st.Peek() != ")") {
@@ -902,10 +1041,10 @@ class Factory : public FactoryBase {
 
     size_t end = st.tellg();
     // Invoke new instance's Init method.
-    string stream_str = st.str();
-    //cerr << "Full stream string is: \"" << stream_str << "\"" << endl;
-    string init_str = stream_str.substr(start, end - start);
+    string init_str = st.substr(start, end - start);
     //cerr << "PostInit string is: \"" << init_str << "\"" << endl;
+    INFACT_STATS_TIME_POST_INIT(type);
+    TraceSpan post_init_span("post_init", type);
     instance->PostInit(env_ptr.get(), init_str);
 
     return instance;
@@ -944,6 +1083,23 @@ class Factory : public FactoryBase {
     }
   }
 
+  /// Returns the <tt>sizeof</tt> of the concrete type of the specified
+  /// object, or of the abstract type if its concrete type was not
+  /// registered with this factory.
+  static size_t InstanceSize(const T *instance) {
+    if (initialized_) {
+      for (typename unordered_map<string, const Constructor<T> *>::iterator it =
+               cons_table_->begin();
+           it != cons_table_->end();
+           ++it) {
+        if (it->second->Constructs(instance)) {
+          return it->second->InstanceSize();
+        }
+      }
+    }
+    return sizeof(T);
+  }
+
   virtual VarMapBase *CreateVarMap(Environment *env) const {
     bool is_primitive = false;
     return new VarMap<shared_ptr<T> >(BaseName(), env, is_primitive);
@@ -956,6 +1112,13 @@ class Factory : public FactoryBase {
 					       is_primitive);
   }
 
+  virtual VarMapBase *CreateMapVarMap(Environment *env) const {
+    string name = "map<" + BaseName() + ">";
+    bool is_primitive = false;
+    return new VarMap<unordered_map<string, shared_ptr<T> > >(name, BaseName(),
+                                                             env, is_primitive);
+  }
+
   /// The method used by the \link REGISTER_NAMED \endlink macro to ensure
   /// that subclasses add themselves to the factory.
   ///
@@ -1011,6 +1174,35 @@ template <typename T>
 unordered_map<string, const Constructor<T> *> *
 Factory<T>::cons_table_ = 0;
 
+/// A partial specialization of the MemorySize class for \link
+/// infact::Factory Factory\endlink-constructible objects, which
+/// estimates an object&rsquo;s memory as the <tt>sizeof</tt> its
+/// concrete type plus whatever is owned by its registered members.
+/// The members are found by invoking the object&rsquo;s
+/// <tt>RegisterInitializers</tt> method, which must therefore have no
+/// effect beyond adding member initializers.
+///
+/// \tparam T the abstract type of the object
+template <typename T>
+class MemorySize<shared_ptr<T> > {
+ public:
+  size_t HeapBytes(const shared_ptr<T> &value, MemoryVisitor *visitor) const {
+    if (value.get() == nullptr || !visitor->Visit(value.get())) {
+      return 0;
+    }
+    // A shared_ptr control block holds two reference counts, a vtable
+    // pointer and the deleter.
+    size_t bytes = 4 * sizeof(void *) + Factory<T>::InstanceSize(value.get());
+    Initializers initializers;
+    const_cast<T *>(value.get())->RegisterInitializers(initializers);
+    for (Initializers::const_iterator it = initializers.begin();
+         it != initializers.end(); ++it) {
+      bytes += it->second->HeapBytes(visitor);
+    }
+    return bytes;
+  }
+};
+
 /// A macro to define a subclass of \link infact::Constructor
 /// Constructor \endlink whose NewInstance method constructs an
 /// instance of \a TYPE, a concrete subclass of \a BASE.  The concrete
@@ -1019,7 +1211,11 @@ Factory<T>::cons_table_ = 0;
 /// This is a helper macro used only by the <tt>REGISTER</tt> macro.
 #define DEFINE_CONS_CLASS(TYPE,NAME,BASE) \
   class NAME ## Constructor : public infact::Constructor<BASE> { \
-   public: virtual BASE *NewInstance() const { return new TYPE(); } };
+   public: virtual BASE *NewInstance() const { return new TYPE(); } \
+    virtual bool Constructs(const BASE *instance) const { \
+      return typeid(*instance) == typeid(TYPE); \
+    } \
+    virtual size_t InstanceSize() const { return sizeof(TYPE); } };
 
 /// This macro registers the concrete subtype \a TYPE with the
 /// specified factory for instances of type \a BASE; the \a TYPE is
@@ -0,0 +1,689 @@
+// Copyright 2014, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   * Redistributions of source code must retain the above copyright
+//     notice, this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above
+//     copyright notice, this list of conditions and the following disclaimer
+//     in the documentation and/or other materials provided with the
+//     distribution.
+//   * Neither the name of Google Inc. nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+//
+//
+//
+//
+/// \file
+/// Implementation of the \link infact::FileLoader FileLoader \endlink
+/// class.
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define INFACT_HAVE_IO_URING 1
+#endif
+#endif
+#endif
+
+#include "error.h"
+#include "file-loader.h"
+#include "generators.h"
+#include "stream-tokenizer.h"
+
+namespace infact {
+
+using std::ostringstream;
+
+namespace {
+
+/// Opens the specified file for reading and sets the size of the
+/// specified contents to its size, or sets their error.
+///
+/// \return the descriptor of the open file, or -1 if it could not be
+///         opened
+int
+OpenFile(const string &path, FileContents *contents) {
+  int fd = open(path.c_str(), O_RDONLY);
+  struct stat file_stat;
+  if (fd < 0 || fstat(fd, &file_stat) != 0) {
+    ostringstream err_ss;
+    err_ss << "could not open file \"" << path << "\": " << strerror(errno);
+    contents->error = err_ss.str();
+    if (fd >= 0) {
+      close(fd);
+    }
+    return -1;
+  }
+  contents->size = static_cast<size_t>(file_stat.st_size);
+  return fd;
+}
+
+/// Makes the data of the specified contents a buffer of their size,
+/// aligned to 64 bytes.
+///
+/// \return the buffer, or <tt>nullptr</tt> if it could not be allocated,
+///         in which case the error of the contents is set
+uint8_t *
+AllocateBuffer(FileContents *contents) {
+  void *buffer = nullptr;
+  if (posix_memalign(&buffer, 64, contents->size) != 0) {
+    contents->error = "could not allocate buffer";
+    return nullptr;
+  }
+  contents->data.reset(static_cast<const uint8_t *>(buffer),
+                       [](const uint8_t *p) {
+                         free(const_cast<uint8_t *>(p));
+                       });
+  return static_cast<uint8_t *>(buffer);
+}
+
+/// Sets the error of the specified contents to say that the specified
+/// file could not be read, for the specified reason if it is nonzero.
+void
+SetReadError(const string &path, int errnum, FileContents *contents) {
+  ostringstream err_ss;
+  err_ss << "could not read file \"" << path << "\"";
+  if (errnum != 0) {
+    err_ss << ": " << strerror(errnum);
+  }
+  contents->error = err_ss.str();
+  contents->data.reset();
+}
+
+}  // namespace
+
+#ifdef INFACT_HAVE_IO_URING
+
+/// An io_uring instance whose submission and completion rings are
+/// mapped into this process.  It is used by a single thread at a time.
+class IoRing {
+ public:
+  /// Creates a ring with room for at least the specified number of
+  /// submissions.
+  ///
+  /// \return the ring, or <tt>nullptr</tt> if io_uring is unavailable
+  static IoRing *Create(unsigned entries) {
+    IoRing *ring = new IoRing();
+    if (!ring->Setup(entries)) {
+      delete ring;
+      return nullptr;
+    }
+    return ring;
+  }
+
+  ~IoRing() {
+    if (sqes_ != MAP_FAILED) {
+      munmap(sqes_, sqes_size_);
+    }
+    if (cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_) {
+      munmap(cq_ring_, cq_ring_size_);
+    }
+    if (sq_ring_ != MAP_FAILED) {
+      munmap(sq_ring_, sq_ring_size_);
+    }
+    if (fd_ >= 0) {
+      close(fd_);
+    }
+  }
+
+  /// Queues a read into the specified buffer, whose description must
+  /// outlive the read, to be submitted by the next call to \link
+  /// Submit\endlink.
+  ///
+  /// \return whether there was room for the read
+  bool PrepareRead(int fd, const struct iovec *buffer, uint64_t offset,
+                   uint64_t user_data) {
+    unsigned tail = *sq_tail_;
+    if (tail - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) >= sq_entries_) {
+      return false;
+    }
+    unsigned index = tail & *sq_mask_;
+    struct io_uring_sqe *sqe = &sqes_[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_READV;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(buffer);
+    sqe->len = 1;
+    sqe->off = offset;
+    sqe->user_data = user_data;
+    sq_array_[index] = index;
+    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+    ++num_unsubmitted_;
+    return true;
+  }
+
+  /// Submits the queued reads and waits for the specified number of
+  /// them to complete.
+  ///
+  /// \return 0 on success, or the error number of the failure
+  int Submit(unsigned min_complete) {
+    unsigned flags = min_complete > 0 ? IORING_ENTER_GETEVENTS : 0;
+    while (true) {
+      long num_submitted = syscall(__NR_io_uring_enter, fd_, num_unsubmitted_,
+                                   min_complete, flags, nullptr, 0);
+      if (num_submitted >= 0) {
+        num_unsubmitted_ -= static_cast<unsigned>(num_submitted);
+        return 0;
+      }
+      if (errno != EINTR) {
+        return errno;
+      }
+    }
+  }
+
+  /// Invokes the specified function with the user data and result of
+  /// each completed read, which is the number of bytes read or the
+  /// negated error number.
+  template <typename Function>
+  void Reap(Function function) {
+    unsigned head = *cq_head_;
+    unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head) {
+      const struct io_uring_cqe &cqe = cqes_[head & *cq_mask_];
+      uint64_t user_data = cqe.user_data;
+      int result = cqe.res;
+      __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+      function(user_data, result);
+    }
+  }
+
+ private:
+  IoRing() :
+      fd_(-1), sq_ring_(MAP_FAILED), cq_ring_(MAP_FAILED),
+      sqes_(static_cast<struct io_uring_sqe *>(MAP_FAILED)),
+      num_unsubmitted_(0) { }
+
+  bool Setup(unsigned entries) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+    if (fd_ < 0) {
+      return false;
+    }
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ = params.cq_off.cqes +
+        params.cq_entries * sizeof(struct io_uring_cqe);
+    bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap && cq_ring_size_ > sq_ring_size_) {
+      sq_ring_size_ = cq_ring_size_;
+    }
+    sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+    if (sq_ring_ == MAP_FAILED) {
+      return false;
+    }
+    cq_ring_ = single_mmap ? sq_ring_ :
+        mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+    if (cq_ring_ == MAP_FAILED) {
+      return false;
+    }
+    sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+    sqes_ = static_cast<struct io_uring_sqe *>(
+        mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES));
+    if (sqes_ == MAP_FAILED) {
+      return false;
+    }
+    uint8_t *sq = static_cast<uint8_t *>(sq_ring_);
+    sq_head_ = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+    sq_tail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    sq_mask_ = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+    sq_entries_ = params.sq_entries;
+    uint8_t *cq = static_cast<uint8_t *>(cq_ring_);
+    cq_head_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    cq_mask_ = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<struct io_uring_cqe *>(cq + params.cq_off.cqes);
+    return true;
+  }
+
+  int fd_;
+  void *sq_ring_;
+  size_t sq_ring_size_;
+  void *cq_ring_;
+  size_t cq_ring_size_;
+  struct io_uring_sqe *sqes_;
+  size_t sqes_size_;
+  unsigned *sq_head_;
+  unsigned *sq_tail_;
+  unsigned *sq_mask_;
+  unsigned *sq_array_;
+  unsigned sq_entries_;
+  unsigned *cq_head_;
+  unsigned *cq_tail_;
+  unsigned *cq_mask_;
+  struct io_uring_cqe *cqes_;
+  unsigned num_unsubmitted_;
+};
+
+#else
+
+/// A stand-in for an io_uring instance where io_uring is unavailable.
+class IoRing {
+ public:
+  static IoRing *Create(unsigned entries) { return nullptr; }
+  bool PrepareRead(int fd, const struct iovec *buffer, uint64_t offset,
+                   uint64_t user_data) {
+    return false;
+  }
+  int Submit(unsigned min_complete) { return ENOSYS; }
+  template <typename Function>
+  void Reap(Function function) { }
+};
+
+#endif
+
+const size_t FileLoader::kDefaultNumThreads;
+
+thread_local FileLoader *FileLoader::current_ = nullptr;
+
+FileLoader::FileLoader(size_t num_threads, bool use_io_uring) :
+    num_threads_(num_threads == 0 ? 1 : num_threads),
+    use_io_uring_(use_io_uring), stopping_(false) { }
+
+bool
+FileLoader::IoUringSupported() {
+  static const bool supported = std::unique_ptr<IoRing>(
+      IoRing::Create(1)).get() != nullptr;
+  return supported;
+}
+
+FileLoader::~FileLoader() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  queued_.notify_all();
+  for (size_t i = 0; i < threads_.size(); ++i) {
+    threads_[i].join();
+  }
+}
+
+void
+FileLoader::Request(const string &path) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++Enqueue(path).num_requests;
+}
+
+void
+FileLoader::Request(const string &path, const Callback &callback) {
+  FileContents contents;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Entry &entry = Enqueue(path);
+    if (!entry.loaded) {
+      entry.callbacks.push_back(callback);
+      return;
+    }
+    contents = entry.contents;
+  }
+  callback(path, contents);
+}
+
+FileContents
+FileLoader::Get(const string &path) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  unordered_map<string, Entry>::iterator it = entries_.find(path);
+  if (it == entries_.end()) {
+    lock.unlock();
+    return Load(path, false);
+  }
+  if (it->second.num_requests == 0) {
+    // The file is only awaited by callbacks; claim it, so that it is
+    // kept when it arrives.
+    it->second.num_requests = 1;
+  }
+  while (!it->second.loaded) {
+    loaded_.wait(lock);
+    it = entries_.find(path);
+  }
+  FileContents contents = it->second.contents;
+  if (it->second.num_requests > 0) {
+    --it->second.num_requests;
+  }
+  if (it->second.num_requests == 0) {
+    entries_.erase(it);
+  }
+  return contents;
+}
+
+void
+FileLoader::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (unordered_map<string, Entry>::iterator it = entries_.begin();
+       it != entries_.end(); ) {
+    if (it->second.callbacks.empty()) {
+      it = entries_.erase(it);
+    } else {
+      it->second.num_requests = 0;
+      ++it;
+    }
+  }
+  std::deque<string> queue;
+  for (size_t i = 0; i < queue_.size(); ++i) {
+    if (entries_.count(queue_[i]) != 0) {
+      queue.push_back(queue_[i]);
+    }
+  }
+  queue_.swap(queue);
+}
+
+FileLoader::Entry &
+FileLoader::Enqueue(const string &path) {
+  unordered_map<string, Entry>::iterator it = entries_.find(path);
+  if (it != entries_.end()) {
+    return it->second;
+  }
+  if (threads_.empty()) {
+    if (use_io_uring_) {
+      ring_.reset(IoRing::Create(static_cast<unsigned>(num_threads_)));
+    }
+    if (ring_.get() != nullptr) {
+      threads_.push_back(std::thread(&FileLoader::WorkOnRing, this));
+    } else {
+      for (size_t i = 0; i < num_threads_; ++i) {
+        threads_.push_back(std::thread(&FileLoader::Work, this));
+      }
+    }
+  }
+  queue_.push_back(path);
+  queued_.notify_one();
+  return entries_[path];
+}
+
+void
+FileLoader::Work() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    while (!stopping_ && queue_.empty()) {
+      queued_.wait(lock);
+    }
+    if (stopping_) {
+      return;
+    }
+    string path = queue_.front();
+    queue_.pop_front();
+    lock.unlock();
+    FileContents contents = Load(path, true);
+    lock.lock();
+    Deliver(path, contents, &lock);
+  }
+}
+
+void
+FileLoader::WorkOnRing() {
+  /// A read in flight.
+  struct Read {
+    string path;
+    int fd;
+    FileContents contents;
+    size_t num_read;
+    struct iovec buffer;
+  };
+  // The reads in flight, by their user data, whose buffer descriptions
+  // stay put while they are in flight.
+  unordered_map<uint64_t, Read> reads;
+  uint64_t next_id = 0;
+  vector<std::pair<string, FileContents> > arrived;
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    while (!stopping_ && queue_.empty() && reads.empty()) {
+      queued_.wait(lock);
+    }
+    if (stopping_ && reads.empty()) {
+      return;
+    }
+    vector<string> paths;
+    while (!stopping_ && !queue_.empty() &&
+           reads.size() + paths.size() < num_threads_) {
+      paths.push_back(queue_.front());
+      queue_.pop_front();
+    }
+    lock.unlock();
+
+    for (size_t i = 0; i < paths.size(); ++i) {
+      FileContents contents;
+      int fd = OpenFile(paths[i], &contents);
+      uint8_t *buffer = nullptr;
+      if (fd >= 0 && contents.size > 0) {
+        buffer = AllocateBuffer(&contents);
+      }
+      if (buffer == nullptr) {
+        if (fd >= 0) {
+          close(fd);
+        }
+        arrived.push_back(std::make_pair(paths[i], contents));
+        continue;
+      }
+      Read &read = reads[next_id];
+      read.path = paths[i];
+      read.fd = fd;
+      read.contents = contents;
+      read.num_read = 0;
+      read.buffer.iov_base = buffer;
+      read.buffer.iov_len = contents.size;
+      // The ring has room for as many reads as may be in flight.
+      ring_->PrepareRead(fd, &read.buffer, 0, next_id);
+      ++next_id;
+    }
+
+    int errnum = ring_->Submit(reads.empty() ? 0 : 1);
+    ring_->Reap([this, &reads, &arrived](uint64_t id, int result) {
+      unordered_map<uint64_t, Read>::iterator it = reads.find(id);
+      if (it == reads.end()) {
+        return;
+      }
+      Read &read = it->second;
+      if (result > 0) {
+        read.num_read += static_cast<size_t>(result);
+        if (read.num_read < read.contents.size) {
+          // Reads the rest of a file that arrived only in part.
+          uint8_t *buffer = const_cast<uint8_t *>(read.contents.data.get());
+          read.buffer.iov_base = buffer + read.num_read;
+          read.buffer.iov_len = read.contents.size - read.num_read;
+          ring_->PrepareRead(read.fd, &read.buffer, read.num_read, id);
+          return;
+        }
+      } else {
+        SetReadError(read.path, -result, &read.contents);
+      }
+      close(read.fd);
+      arrived.push_back(std::make_pair(read.path, read.contents));
+      reads.erase(it);
+    });
+
+    lock.lock();
+    for (size_t i = 0; i < arrived.size(); ++i) {
+      Deliver(arrived[i].first, arrived[i].second, &lock);
+    }
+    arrived.clear();
+    if (errnum != 0 && errnum != EAGAIN && errnum != EBUSY) {
+      // The ring cannot be relied upon, so the files in flight are read
+      // again along with the rest, as by a pool of one thread; their
+      // buffers are kept until then, in case the kernel still fills
+      // them.
+      for (unordered_map<uint64_t, Read>::iterator it = reads.begin();
+           it != reads.end(); ++it) {
+        close(it->second.fd);
+        queue_.push_front(it->second.path);
+      }
+      ring_.reset();
+      lock.unlock();
+      Work();
+      return;
+    }
+  }
+}
+
+void
+FileLoader::Deliver(const string &path, const FileContents &contents,
+                    std::unique_lock<std::mutex> *lock) {
+  // The request may have been forgotten by Clear in the meantime, or
+  // made again and satisfied by another worker.
+  unordered_map<string, Entry>::iterator it = entries_.find(path);
+  if (it == entries_.end() || it->second.loaded) {
+    return;
+  }
+  it->second.loaded = true;
+  it->second.contents = contents;
+  vector<Callback> callbacks;
+  callbacks.swap(it->second.callbacks);
+  if (it->second.num_requests == 0) {
+    entries_.erase(it);
+  }
+  loaded_.notify_all();
+  if (!callbacks.empty()) {
+    lock->unlock();
+    for (size_t i = 0; i < callbacks.size(); ++i) {
+      callbacks[i](path, contents);
+    }
+    lock->lock();
+  }
+}
+
+FileContents
+FileLoader::Load(const string &path, bool populate) {
+  FileContents contents;
+  int fd = OpenFile(path, &contents);
+  if (fd < 0) {
+    return contents;
+  }
+  if (contents.size == 0) {
+    close(fd);
+    return contents;
+  }
+  int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+  if (populate) {
+    flags |= MAP_POPULATE;
+  }
+#endif
+  void *addr = mmap(nullptr, contents.size, PROT_READ, flags, fd, 0);
+  if (addr != MAP_FAILED) {
+    size_t length = contents.size;
+    contents.data.reset(static_cast<const uint8_t *>(addr),
+                        [length](const uint8_t *p) {
+                          munmap(const_cast<uint8_t *>(p), length);
+                        });
+  } else {
+    uint8_t *buffer = AllocateBuffer(&contents);
+    size_t num_read = 0;
+    while (buffer != nullptr && num_read < contents.size) {
+      ssize_t n = read(fd, buffer + num_read, contents.size - num_read);
+      if (n <= 0) {
+        SetReadError(path, n < 0 ? errno : 0, &contents);
+        break;
+      }
+      num_read += n;
+    }
+  }
+  close(fd);
+  return contents;
+}
+
+size_t
+FindFileReferences(const string &spec, vector<string> *paths) {
+  if (spec.find("file") == string::npos) {
+    return 0;
+  }
+  // For each open bracket, whether it encloses the members of an
+  // object, whose names are not values.
+  vector<bool> encloses_members;
+  bool value_position = false;
+  bool opens_members = false;
+  size_t num_references = 0;
+  StreamTokenizer st(spec);
+#ifdef INFACT_THROW_EXCEPTIONS
+  try {
+#endif
+    while (st.HasNext()) {
+      StreamTokenizer::TokenType type = st.PeekTokenType();
+      string token = st.Next();
+      if (type == StreamTokenizer::IDENTIFIER) {
+        if (value_position && token == "file" && st.Peek() == "(") {
+          ++num_references;
+          st.Next();
+          if (paths != nullptr &&
+              st.PeekTokenType() == StreamTokenizer::STRING) {
+            paths->push_back(st.Peek());
+          }
+          encloses_members.push_back(false);
+          value_position = true;
+          continue;
+        }
+        // A value followed by a parenthesis names a type or generator,
+        // and a member name is followed by its value.
+        opens_members = value_position && !IsGeneratorName(token);
+        value_position = false;
+      } else if (type != StreamTokenizer::RESERVED_CHAR) {
+        value_position = false;
+      } else if (token == "=" || token == ":") {
+        value_position = true;
+      } else if (token == ";") {
+        encloses_members.clear();
+        value_position = false;
+      } else if (token == "{" || token == "(") {
+        bool members = token == "(" && opens_members;
+        encloses_members.push_back(members);
+        value_position = !members;
+      } else if (token == "}" || token == ")") {
+        if (!encloses_members.empty()) {
+          encloses_members.pop_back();
+        }
+        value_position = false;
+      } else if (token == ",") {
+        value_position = !encloses_members.empty() &&
+            !encloses_members.back();
+      }
+      opens_members = opens_members && type == StreamTokenizer::IDENTIFIER;
+    }
+#ifdef INFACT_THROW_EXCEPTIONS
+  } catch (std::runtime_error &e) {
+    // The remaining statements are not scanned.
+  }
+#endif
+  return num_references;
+}
+
+FileRequestScope::FileRequestScope(FileLoader *loader, const string &spec) :
+    loader_(loader) {
+  vector<string> paths;
+  FindFileReferences(spec, &paths);
+  for (size_t i = 0; i < paths.size(); ++i) {
+    loader_->Request(paths[i]);
+  }
+}
+
+}  // namespace infact
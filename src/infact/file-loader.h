@@ -0,0 +1,280 @@
+// Copyright 2014, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   * Redistributions of source code must retain the above copyright
+//     notice, this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above
+//     copyright notice, this list of conditions and the following disclaimer
+//     in the documentation and/or other materials provided with the
+//     distribution.
+//   * Neither the name of Google Inc. nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+//
+//
+//
+//
+/// \file
+/// Provides the \link infact::FileLoader FileLoader \endlink class,
+/// which reads the files referenced by a specification ahead of their
+/// use, several at a time.
+
+#ifndef INFACT_FILE_LOADER_H_
+#define INFACT_FILE_LOADER_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace infact {
+
+using std::shared_ptr;
+using std::string;
+using std::unordered_map;
+using std::vector;
+
+class IoRing;
+
+/// The contents of a file loaded by a \link FileLoader \endlink, or
+/// the reason it could not be loaded.
+struct FileContents {
+  FileContents() : size(0) { }
+
+  /// Returns whether the file was loaded.
+  bool ok() const { return error.empty(); }
+
+  /// The bytes of the file, which are either mapped read-only or held
+  /// in a buffer aligned to 64 bytes, or <tt>nullptr</tt> if the file
+  /// is empty or could not be loaded.
+  shared_ptr<const uint8_t> data;
+  /// The number of bytes in the file.
+  size_t size;
+  /// A description of the failure to load the file, or the empty
+  /// string if it was loaded.
+  string error;
+};
+
+/// Loads files in the background, so that the many side files a
+/// specification may reference, such as the external arrays of
+/// <tt>file(...)</tt> expressions, are read concurrently rather than
+/// one after another as each is reached.  A file is requested with
+/// \link Request \endlink as soon as it is known to be needed, and
+/// later claimed with \link Get\endlink, which waits only if it has not
+/// yet arrived; alternatively, a callback passed to \link Request
+/// \endlink receives the file as soon as it arrives.
+///
+/// An \link infact::Interpreter Interpreter \endlink requests every
+/// file named by a <tt>file(...)</tt> expression before evaluating a
+/// string, stream or file, and makes its loader available via \link
+/// current \endlink for the duration, so that consumers, including
+/// <tt>PostInit</tt> methods, can share it.
+///
+/// Where the kernel provides io_uring, a single worker thread keeps up
+/// to \link num_threads \endlink reads in flight through a submission
+/// ring, which is driven by raw system calls so that no library is
+/// required; otherwise, or if io_uring is disabled at run time, each of
+/// a pool of \link num_threads \endlink worker threads maps one file
+/// at a time.  Whichever is used is only started upon the first
+/// request.
+class FileLoader {
+ public:
+  /// A function invoked with the path and contents of a requested file
+  /// when it arrives.
+  typedef std::function<void(const string &path,
+                             const FileContents &contents)> Callback;
+
+  /// The number of worker threads used when none is specified.
+  static const size_t kDefaultNumThreads = 8;
+
+  /// Constructs a loader.
+  ///
+  /// \param num_threads  the maximum number of files to read at once
+  /// \param use_io_uring whether to read files through io_uring where
+  ///                     it is available, rather than on a thread pool
+  explicit FileLoader(size_t num_threads = kDefaultNumThreads,
+                      bool use_io_uring = true);
+
+  /// Waits for the files being read to arrive and stops the worker
+  /// threads.  Callbacks for files whose reading has not yet begun are
+  /// never invoked.
+  virtual ~FileLoader();
+
+  /// Requests that the specified file be loaded, to be claimed by a
+  /// later call to \link Get\endlink.  Each request should be matched
+  /// by one call to \link Get\endlink, after which the loader no longer
+  /// holds the file.
+  void Request(const string &path);
+
+  /// Requests that the specified file be loaded and passed to the
+  /// specified callback when it arrives, which may be on a worker
+  /// thread, or immediately, if it has already arrived.
+  void Request(const string &path, const Callback &callback);
+
+  /// Returns the contents of the specified file, waiting for it to
+  /// arrive if it has been requested, or reading it on the calling
+  /// thread if it has not.
+  FileContents Get(const string &path);
+
+  /// Forgets all requests made via \link Request(const string&)
+  /// \endlink that have not yet been claimed, abandoning any of their
+  /// files that have not yet been read.  Files still awaited by a
+  /// callback are kept.  This method must not be invoked concurrently
+  /// with \link Get\endlink.
+  void Clear();
+
+  /// Returns the maximum number of files this loader reads at once.
+  size_t num_threads() const { return num_threads_; }
+
+  /// Returns whether this loader reads files through io_uring, which is
+  /// only decided upon the first request.
+  bool uses_io_uring() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return ring_.get() != nullptr;
+  }
+
+  /// Returns whether io_uring can be used by this process, probing the
+  /// kernel upon the first call.
+  static bool IoUringSupported();
+
+  /// Loads the specified file on the calling thread, mapping it into
+  /// memory if possible and otherwise reading it into a buffer.
+  ///
+  /// \param path     the path of the file to load
+  /// \param populate whether to read the whole file now, rather than as
+  ///                 its mapped pages are first touched
+  static FileContents Load(const string &path, bool populate);
+
+  /// Returns the loader in use on this thread, or <tt>nullptr</tt> if
+  /// there is none.
+  static FileLoader *current() { return current_; }
+
+ private:
+  friend class FileLoaderScope;
+
+  /// The state of a requested file.
+  struct Entry {
+    Entry() : num_requests(0), loaded(false) { }
+
+    /// The number of requests yet to be claimed by \link Get\endlink.
+    size_t num_requests;
+    /// Whether the file has arrived.
+    bool loaded;
+    /// The contents of the file, once it has arrived.
+    FileContents contents;
+    /// The callbacks awaiting the file.
+    vector<Callback> callbacks;
+  };
+
+  /// Adds the specified file to the queue if it is not already known,
+  /// starting the worker threads if need be, and returns its entry.
+  /// The mutex must be held.
+  Entry &Enqueue(const string &path);
+
+  /// Reads queued files one at a time until this loader is destroyed.
+  void Work();
+
+  /// Reads queued files through the ring until this loader is
+  /// destroyed, keeping up to \link num_threads \endlink reads in
+  /// flight.
+  void WorkOnRing();
+
+  /// Records the arrival of the specified file and passes it to the
+  /// callbacks awaiting it.  The specified lock must hold the mutex,
+  /// which is released while the callbacks run.
+  void Deliver(const string &path, const FileContents &contents,
+               std::unique_lock<std::mutex> *lock);
+
+  size_t num_threads_;
+  bool use_io_uring_;
+  bool stopping_;
+  mutable std::mutex mutex_;
+  /// Signalled when a file is queued or this loader is being destroyed.
+  std::condition_variable queued_;
+  /// Signalled when a file arrives.
+  std::condition_variable loaded_;
+  std::deque<string> queue_;
+  unordered_map<string, Entry> entries_;
+  vector<std::thread> threads_;
+  /// The ring through which files are read, or <tt>nullptr</tt> if they
+  /// are read on a thread pool.
+  std::unique_ptr<IoRing> ring_;
+
+  static thread_local FileLoader *current_;
+};
+
+/// Finds the uses of the <tt>file</tt> generator in the specified
+/// specification, without evaluating it.  Only identifiers in the
+/// position of a value count, so that a member initializer that
+/// happens to be named <tt>file</tt> does not.  Scanning stops at the
+/// first malformed token, which evaluation will report.
+///
+/// \param      spec  the text of the statements to scan
+/// \param[out] paths if not <tt>nullptr</tt>, the paths given as string
+///                   literals, in order of appearance
+/// \return the number of uses of the generator, including those whose
+///         path is not a string literal
+size_t FindFileReferences(const string &spec, vector<string> *paths);
+
+/// Requests from a \link FileLoader \endlink every file referenced by a
+/// specification, so that the files are read while the statements
+/// before them are evaluated, and clears the loader&rsquo;s unclaimed
+/// requests when destroyed, however the evaluation ends.
+class FileRequestScope {
+ public:
+  /// Requests the files referenced by the specified specification
+  /// from the specified loader.
+  FileRequestScope(FileLoader *loader, const string &spec);
+
+  /// Clears the unclaimed requests of the loader.
+  ~FileRequestScope() { loader_->Clear(); }
+
+ private:
+  FileLoader *loader_;
+};
+
+/// Makes a \link FileLoader \endlink the one in use on the current
+/// thread for the lifetime of this object, restoring the previous one
+/// on destruction.
+class FileLoaderScope {
+ public:
+  /// Makes the specified loader the one in use.
+  explicit FileLoaderScope(FileLoader *loader) :
+      previous_(FileLoader::current_) {
+    FileLoader::current_ = loader;
+  }
+
+  /// Restores the previous loader.
+  ~FileLoaderScope() { FileLoader::current_ = previous_; }
+
+ private:
+  FileLoader *previous_;
+};
+
+}  // namespace infact
+
+#endif
@@ -0,0 +1,278 @@
+// Copyright 2014, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   * Redistributions of source code must retain the above copyright
+//     notice, this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above
+//     copyright notice, this list of conditions and the following disclaimer
+//     in the documentation and/or other materials provided with the
+//     distribution.
+//   * Neither the name of Google Inc. nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+//
+//
+/// \file
+/// Provides support for the generator expressions <tt>range</tt>,
+/// <tt>repeat</tt> and <tt>linspace</tt>, which may be used in place of
+/// a brace-enclosed list wherever a vector value is read.
+
+#ifndef INFACT_GENERATORS_H_
+#define INFACT_GENERATORS_H_
+
+#include <cmath>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "error.h"
+#include "external-array.h"
+#include "stream-init.h"
+#include "stream-tokenizer.h"
+
+namespace infact {
+
+using std::ostringstream;
+using std::string;
+using std::vector;
+
+/// Returns whether the specified string is the name of a generator
+/// expression.  An external array reference, <tt>file(...)</tt>, is
+/// read as a generator as well; see \link infact::ExternalArray
+/// ExternalArray \endlink.
+inline bool IsGeneratorName(const string &name) {
+  return name == "range" || name == "repeat" || name == "linspace" ||
+      name == "file";
+}
+
+/// Returns whether the next two tokens of the specified stream begin a
+/// generator expression, that is, whether they are the name of a
+/// generator followed by an open parenthesis.  The stream is left
+/// unchanged.
+///
+/// \param      st   the stream from which to peek
+/// \param[out] name the name of the generator, if this method returns
+///                  <tt>true</tt>
+inline bool PeekGenerator(StreamTokenizer &st, string *name) {
+  if (st.PeekTokenType() != StreamTokenizer::IDENTIFIER ||
+      !IsGeneratorName(st.Peek())) {
+    return false;
+  }
+  *name = st.Next();
+  bool is_generator = st.Peek() == "(";
+  st.Putback();
+  return is_generator;
+}
+
+/// Reads a single argument of a generator expression, along with the
+/// comma or close parenthesis that follows it.
+///
+/// \param      generator the name of the generator, for error messages
+/// \param      st        the stream from which to read
+/// \param[out] arg       the argument to be initialized
+/// \return whether this was the final argument, i.e., whether it was
+///         followed by a close parenthesis
+template <typename A>
+bool ReadGeneratorArgument(const string &generator, StreamTokenizer &st,
+                           A *arg) {
+  Initializer<A> initializer(arg);
+  initializer.Init(st);
+  if (st.Peek() != "," && st.Peek() != ")") {
+    ostringstream err_ss;
+    err_ss << "Generator " << generator << ": error: expected ',' or ')' "
+           << "at stream position " << st.PeekTokenStart()
+           << " but found \"" << st.Peek() << "\"";
+    Error(err_ss.str());
+  }
+  return st.Next() == ")";
+}
+
+/// Reads a generator&rsquo;s count argument, which must be the last
+/// argument and must not be negative.
+inline size_t ReadGeneratorCount(const string &generator,
+                                 StreamTokenizer &st) {
+  size_t count_start = st.PeekTokenStart();
+  int64_t count = 0;
+  if (!ReadGeneratorArgument(generator, st, &count)) {
+    ostringstream err_ss;
+    err_ss << "Generator " << generator << ": error: too many arguments at "
+           << "stream position " << st.PeekPrevTokenStart();
+    Error(err_ss.str());
+  }
+  if (count < 0) {
+    ostringstream err_ss;
+    err_ss << "Generator " << generator << ": error: negative count "
+           << count << " at stream position " << count_start;
+    Error(err_ss.str());
+  }
+  return static_cast<size_t>(count);
+}
+
+/// Fills vectors of non-numeric types.  Only the <tt>repeat</tt>
+/// generator applies to them, and it is handled by \link
+/// infact::VarMap VarMap \endlink itself, so callers must check
+/// \link kNumeric \endlink before invoking any method of this class.
+///
+/// \tparam T      the element type of the vector to be filled
+/// \tparam Enable a parameter allowing all numeric types to be handled
+///                by a single partial specialization
+template <typename T, typename Enable = void>
+class SequenceGenerator {
+ public:
+  /// Whether the <tt>range</tt>, <tt>linspace</tt> and <tt>file</tt>
+  /// generators may fill vectors with elements of type <tt>T</tt>.
+  static const bool kNumeric = false;
+
+  static void Range(StreamTokenizer &st, vector<T> *value) { }
+  static void Linspace(StreamTokenizer &st, vector<T> *value) { }
+  static void File(StreamTokenizer &st, vector<T> *value) { }
+};
+
+/// Fills vectors of numeric types with the <tt>range</tt>,
+/// <tt>linspace</tt> and <tt>file</tt> generators.  The number of
+/// elements is computed up front, so that each generator fills a
+/// pre-sized vector in a single loop the compiler can vectorize (or, for
+/// <tt>file</tt>, a single bulk copy).
+///
+/// \tparam T the element type of the vector to be filled
+template <typename T>
+class SequenceGenerator<
+  T, typename std::enable_if<std::is_arithmetic<T>::value &&
+                             !std::is_same<T, bool>::value>::type> {
+ public:
+  /// \copydoc SequenceGenerator::kNumeric
+  static const bool kNumeric = true;
+
+  /// Reads the arguments of <tt>range(stop)</tt>, <tt>range(start,
+  /// stop)</tt> or <tt>range(start, stop, step)</tt>, just after the
+  /// open parenthesis, and fills the specified vector with
+  /// <tt>start</tt>, <tt>start + step</tt>, &hellip;, up to but not
+  /// including <tt>stop</tt>.
+  static void Range(StreamTokenizer &st, vector<T> *value) {
+    size_t range_start = st.PeekPrevTokenStart();
+    T args[3];
+    size_t num_args = 0;
+    bool done = false;
+    while (!done) {
+      if (num_args == 3) {
+        ostringstream err_ss;
+        err_ss << "Generator range: error: too many arguments at stream "
+               << "position " << st.PeekTokenStart();
+        Error(err_ss.str());
+      }
+      done = ReadGeneratorArgument("range", st, &args[num_args++]);
+    }
+    T start = num_args == 1 ? T() : args[0];
+    T stop = num_args == 1 ? args[0] : args[1];
+    T step = num_args == 3 ? args[2] : T(1);
+    if (step == T()) {
+      ostringstream err_ss;
+      err_ss << "Generator range: error: zero step for range beginning at "
+             << "stream position " << range_start;
+      Error(err_ss.str());
+    }
+    size_t size = Count(start, stop, step, std::is_integral<T>());
+    value->resize(size);
+    T *data = value->data();
+    for (size_t i = 0; i < size; ++i) {
+      data[i] = static_cast<T>(start + static_cast<T>(i) * step);
+    }
+  }
+
+  /// Reads the arguments of <tt>linspace(start, stop, count)</tt>, just
+  /// after the open parenthesis, and fills the specified vector with
+  /// <tt>count</tt> evenly spaced values from <tt>start</tt> to
+  /// <tt>stop</tt>, inclusive.
+  static void Linspace(StreamTokenizer &st, vector<T> *value) {
+    size_t linspace_start = st.PeekPrevTokenStart();
+    if (!std::is_floating_point<T>::value) {
+      ostringstream err_ss;
+      err_ss << "Generator linspace: error: at stream position "
+             << linspace_start << ": linspace requires floating-point "
+             << "elements";
+      Error(err_ss.str());
+    }
+    T start = T();
+    T stop = T();
+    if (ReadGeneratorArgument("linspace", st, &start) ||
+        ReadGeneratorArgument("linspace", st, &stop)) {
+      ostringstream err_ss;
+      err_ss << "Generator linspace: error: expected three arguments for "
+             << "linspace beginning at stream position " << linspace_start;
+      Error(err_ss.str());
+    }
+    size_t size = ReadGeneratorCount("linspace", st);
+    value->resize(size);
+    T *data = value->data();
+    T delta = size > 1 ? (stop - start) / static_cast<T>(size - 1) : T();
+    for (size_t i = 0; i < size; ++i) {
+      data[i] = start + static_cast<T>(i) * delta;
+    }
+    // Make the final value exact, regardless of rounding.
+    if (size > 1) {
+      data[size - 1] = stop;
+    }
+  }
+
+  /// Reads the arguments of <tt>file("path" [, offset [, count]])</tt>,
+  /// just after the open parenthesis, and fills the specified vector with
+  /// the elements of the external array they specify in a single bulk
+  /// copy.
+  static void File(StreamTokenizer &st, vector<T> *value) {
+    const char *descr = NpyDescr<T>::Value();
+    if (descr == nullptr) {
+      ostringstream err_ss;
+      err_ss << "Generator file: error: at stream position "
+             << st.PeekPrevTokenStart() << ": unsupported element type";
+      Error(err_ss.str());
+    }
+    ExternalArray array;
+    array.Read(st, sizeof(T), descr);
+    value->resize(array.size());
+    array.CopyTo(value->data(), sizeof(T));
+  }
+
+ private:
+  // Returns the number of elements in an integral range, computed with
+  // unsigned arithmetic so that it cannot overflow.
+  static size_t Count(T start, T stop, T step, std::true_type) {
+    if (step > T() ? start >= stop : start <= stop) {
+      return 0;
+    }
+    uint64_t distance = step > T() ?
+        static_cast<uint64_t>(stop) - static_cast<uint64_t>(start) :
+        static_cast<uint64_t>(start) - static_cast<uint64_t>(stop);
+    uint64_t stride = step > T() ?
+        static_cast<uint64_t>(step) : uint64_t(0) - static_cast<uint64_t>(step);
+    return static_cast<size_t>((distance - 1) / stride + 1);
+  }
+
+  // Returns the number of elements in a floating-point range.
+  static size_t Count(T start, T stop, T step, std::false_type) {
+    double count = std::ceil((static_cast<double>(stop) - start) / step);
+    return count > 0 ? static_cast<size_t>(count) : 0;
+  }
+};
+
+}  // namespace infact
+
+#endif
@@ -0,0 +1,657 @@
+// Copyright 2014, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   * Redistributions of source code must retain the above copyright
+//     notice, this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above
+//     copyright notice, this list of conditions and the following disclaimer
+//     in the documentation and/or other materials provided with the
+//     distribution.
+//   * Neither the name of Google Inc. nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+//
+//
+/// \file
+/// Microbenchmarks for the hot paths of the InFact framework: the
+/// \link infact::StreamTokenizer StreamTokenizer \endlink, the \link
+/// infact::EnvironmentImpl EnvironmentImpl\endlink, \link
+/// infact::Binding Binding \endlink refreshes and \link infact::Factory
+/// Factory \endlink construction of the example classes.  The
+/// <tt>concurrent</tt> benchmarks measure reads of a \link
+/// infact::ConcurrentEnvironment ConcurrentEnvironment \endlink from a
+/// growing number of threads while another thread keeps writing, against
+/// an \link infact::EnvironmentImpl EnvironmentImpl \endlink guarded by
+/// a single mutex.  The <tt>config_holder</tt> benchmarks compare
+/// evaluating a whole specification against a \link
+/// infact::ConfigHolder ConfigHolder \endlink load that changes a single
+/// statement, and against rolling back to a retained generation.
+/// Results are written to standard output as a JSON object, so that they
+/// may be tracked across revisions.
+///
+/// The <tt>load</tt> benchmarks evaluate entire specification files,
+/// either those named by <tt>--load</tt> flags (such as ones written by
+/// <tt>infact-gen</tt>) or, by default, ones generated in-process with
+/// increasing numbers of statements.  Besides time, they report the
+/// heap allocations made by a single evaluation and the peak resident
+/// set size of the process so far.
+///
+/// With <tt>--perf</tt>, each result also reports hardware counters
+/// per operation (cycles, instructions, cache and branch misses), for
+/// whichever counters the system makes available.
+///
+/// Usage: <tt>infact-bench [--min-time=SECONDS] [--filter=SUBSTRING]
+/// [--load=FILE]... [--perf]</tt>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <sys/resource.h>
+
+#include "alloc-counter.h"
+#include "binding.h"
+#include "bytes.h"
+#include "concurrent-environment.h"
+#include "config-generator.h"
+#include "config-holder.h"
+#include "environment-impl.h"
+#include "example.h"
+#include "interpreter.h"
+#include "perf-counters.h"
+#include "stream-tokenizer.h"
+#include "trace.h"
+
+using namespace std;
+using namespace infact;
+
+namespace {
+
+/// The result of running a single benchmark.
+struct Result {
+  /// The name of the benchmark, such as <tt>"environment/copy"</tt>.
+  string name;
+  /// The value of the benchmark&rsquo;s size parameter, such as the
+  /// number of variables, or 0 if it has none.
+  size_t param;
+  /// The number of times the benchmarked operation was run.
+  size_t iterations;
+  /// The mean wall-clock time of the benchmarked operation.
+  double ns_per_op;
+  /// Additional named measurements, such as throughput.
+  vector<pair<string, double> > metrics;
+};
+
+/// Runs benchmarks and collects their results.
+class Runner {
+ public:
+  /// Constructs a runner.
+  ///
+  /// \param min_time the minimum time, in seconds, for each benchmark
+  /// \param filter   a substring of the names of the benchmarks to run,
+  ///                 or the empty string to run all of them
+  /// \param perf     the hardware counters to collect around each
+  ///                 benchmark, or <tt>nullptr</tt> to collect none
+  Runner(double min_time, const string &filter, PerfCounters *perf) :
+      min_time_(min_time), filter_(filter), perf_(perf) { }
+
+  /// Runs the specified operation enough times to take at least the
+  /// minimum time, doubling the number of iterations on each attempt.
+  /// Hardware counters, if any, cover the final attempt.
+  ///
+  /// \param name  the name of the benchmark
+  /// \param param the value of the size parameter of the benchmark
+  /// \param op    the operation to be benchmarked
+  /// \return the newly-added result, or <tt>nullptr</tt> if the benchmark
+  ///         was skipped by the filter
+  Result *Run(const string &name, size_t param, const function<void()> &op) {
+    if (!filter_.empty() && name.find(filter_) == string::npos) {
+      return nullptr;
+    }
+    // Warm up, e.g., so that lazily-initialized statics are built.
+    op();
+    size_t iterations = 1;
+    double elapsed_ns = 0.0;
+    while (true) {
+      if (perf_ != nullptr) {
+        perf_->Start();
+      }
+      chrono::steady_clock::time_point start = chrono::steady_clock::now();
+      for (size_t i = 0; i < iterations; ++i) {
+        op();
+      }
+      elapsed_ns = chrono::duration<double, nano>(
+          chrono::steady_clock::now() - start).count();
+      if (perf_ != nullptr) {
+        perf_->Stop();
+      }
+      if (elapsed_ns >= min_time_ * 1e9 || iterations >= (1UL << 30)) {
+        break;
+      }
+      iterations *= 2;
+    }
+    Result result;
+    result.name = name;
+    result.param = param;
+    result.iterations = iterations;
+    result.ns_per_op = elapsed_ns / iterations;
+    if (perf_ != nullptr) {
+      AddPerfMetrics(iterations, &result);
+    }
+    results_.push_back(result);
+    return &results_.back();
+  }
+
+  /// Writes all results as a JSON object to the specified stream.
+  void Print(ostream &os) const {
+    os << "{\n  \"benchmarks\": [";
+    for (size_t i = 0; i < results_.size(); ++i) {
+      const Result &result = results_[i];
+      os << (i == 0 ? "" : ",") << "\n    {"
+         << "\"name\": \"" << result.name << "\", "
+         << "\"param\": " << result.param << ", "
+         << "\"iterations\": " << result.iterations << ", "
+         << "\"ns_per_op\": " << result.ns_per_op;
+      for (size_t j = 0; j < result.metrics.size(); ++j) {
+        os << ", \"" << result.metrics[j].first << "\": "
+           << result.metrics[j].second;
+      }
+      os << "}";
+    }
+    os << "\n  ]\n}" << endl;
+  }
+
+ private:
+  /// Adds the per-operation value of each hardware counter to the
+  /// specified result, along with instructions per cycle.
+  void AddPerfMetrics(size_t iterations, Result *result) const {
+    vector<pair<string, uint64_t> > values = perf_->Read();
+    double cycles = 0.0;
+    double instructions = 0.0;
+    for (size_t i = 0; i < values.size(); ++i) {
+      double value = static_cast<double>(values[i].second);
+      result->metrics.push_back(make_pair(values[i].first + "_per_op",
+                                          value / iterations));
+      if (values[i].first == "cycles") {
+        cycles = value;
+      } else if (values[i].first == "instructions") {
+        instructions = value;
+      }
+    }
+    if (cycles > 0.0 && instructions > 0.0) {
+      result->metrics.push_back(make_pair("ipc", instructions / cycles));
+    }
+  }
+
+  double min_time_;
+  string filter_;
+  PerfCounters *perf_;
+  vector<Result> results_;
+};
+
+/// Prevents the compiler from optimizing away a computed value.
+volatile size_t sink;
+
+/// Returns a spec of approximately the specified number of bytes,
+/// exercising all of the kinds of tokens.
+string MakeSpec(size_t num_bytes) {
+  ostringstream oss;
+  for (size_t i = 0; oss.tellp() < static_cast<streamoff>(num_bytes); ++i) {
+    oss << "// Person number " << i << ".\n"
+        << "p" << i << " = PersonImpl(name(\"Fred\"), cm_height(180), "
+        << "birthday(DateImpl(year(1990), month(1), day(10))));\n"
+        << "v" << i << " = {1, 2.5, -3, 4e10};\n";
+  }
+  return oss.str();
+}
+
+/// Returns a spec defining the specified number of int variables, named
+/// <tt>x0</tt>, <tt>x1</tt>, and so on.
+string MakeIntVariables(size_t num_vars) {
+  ostringstream oss;
+  for (size_t i = 0; i < num_vars; ++i) {
+    oss << "x" << i << " = " << i << ";\n";
+  }
+  return oss.str();
+}
+
+void BenchmarkTokenizer(Runner &runner) {
+  const string spec = MakeSpec(1 << 20);
+  Result *result = runner.Run("tokenizer/throughput", spec.size(), [&spec]() {
+      StreamTokenizer st(spec);
+      size_t num_tokens = 0;
+      while (st.HasNext()) {
+        st.Next();
+        ++num_tokens;
+      }
+      sink = num_tokens;
+    });
+  if (result != nullptr) {
+    result->metrics.push_back(
+        make_pair("mb_per_s", spec.size() / result->ns_per_op * 1e3));
+  }
+}
+
+void BenchmarkEnvironment(Runner &runner) {
+  runner.Run("environment/construct", 0, []() {
+      delete new EnvironmentImpl(0);
+    });
+
+  size_t sizes[] = { 10, 100, 1000, 10000 };
+  for (size_t i = 0; i < sizeof(sizes) / sizeof(size_t); ++i) {
+    size_t num_vars = sizes[i];
+    Interpreter interpreter;
+    interpreter.EvalString(MakeIntVariables(num_vars));
+    EnvironmentImpl *env = interpreter.env();
+
+    runner.Run("environment/copy", num_vars, [env]() {
+        delete env->Copy();
+      });
+
+    vector<string> names;
+    for (size_t j = 0; j < num_vars; ++j) {
+      ostringstream oss;
+      oss << "x" << j;
+      names.push_back(oss.str());
+    }
+    size_t next = 0;
+    runner.Run("environment/get", num_vars, [env, &names, &next]() {
+        int value = 0;
+        env->Get(names[next], &value);
+        next = next + 1 == names.size() ? 0 : next + 1;
+        sink = value;
+      });
+  }
+}
+
+/// A configuration struct read by the <tt>binding</tt> benchmarks.
+struct BindingConfig {
+  int i0, i1, i2, i3;
+  double d0, d1;
+  string s0, s1;
+};
+
+void BenchmarkBinding(Runner &runner) {
+  const size_t kNumFields = 8;
+  Interpreter interpreter;
+  interpreter.EvalString("i0 = 0; i1 = 1; i2 = 2; i3 = 3; d0 = 0.5; "
+                         "d1 = 1.5; s0 = \"a\"; s1 = \"b\";");
+  EnvironmentImpl *env = interpreter.env();
+  BindingConfig config;
+
+  // Reading each field with its own lookup.
+  runner.Run("binding/get", kNumFields, [env, &config]() {
+      env->Get("i0", &config.i0);
+      env->Get("i1", &config.i1);
+      env->Get("i2", &config.i2);
+      env->Get("i3", &config.i3);
+      env->Get("d0", &config.d0);
+      env->Get("d1", &config.d1);
+      env->Get("s0", &config.s0);
+      env->Get("s1", &config.s1);
+      sink = config.i3;
+    });
+
+  // Reading all fields through pre-resolved slots.
+  Binding<BindingConfig> binding;
+  binding.Add("i0", &BindingConfig::i0).Add("i1", &BindingConfig::i1)
+         .Add("i2", &BindingConfig::i2).Add("i3", &BindingConfig::i3)
+         .Add("d0", &BindingConfig::d0).Add("d1", &BindingConfig::d1)
+         .Add("s0", &BindingConfig::s0).Add("s1", &BindingConfig::s1);
+  binding.Bind(env, &config);
+  runner.Run("binding/refresh", kNumFields, [&binding, &config]() {
+      binding.Refresh(&config);
+      sink = config.i3;
+    });
+}
+
+void BenchmarkFactory(Runner &runner) {
+  runner.Run("factory/create/DateImpl", 0, []() {
+      Factory<Date> factory;
+      sink = factory.CreateOrDie(
+          "DateImpl(year(1990), month(1), day(10))", "").use_count();
+    });
+  runner.Run("factory/create/PersonImpl", 0, []() {
+      Factory<Person> factory;
+      sink = factory.CreateOrDie(
+          "PersonImpl(name(\"Fred\"), cm_height(180), "
+          "birthday(DateImpl(year(1990), month(1), day(10))))",
+          "").use_count();
+    });
+  runner.Run("factory/create/Cow", 0, []() {
+      Factory<Animal> factory;
+      sink = factory.CreateOrDie(
+          "Cow(name(\"Bessie\"), age(3), color(WHITE))", "").use_count();
+    });
+  runner.Run("factory/create/HumanPetOwner", 0, []() {
+      Factory<PetOwner> factory;
+      sink = factory.CreateOrDie(
+          "HumanPetOwner(pets({Cow(name(\"Bessie\")), "
+          "Sheep(name(\"Sleepy\"), counts({1, 2}))}))", "").use_count();
+    });
+}
+
+void BenchmarkVectorLiteral(Runner &runner) {
+  size_t lengths[] = { 10, 100, 1000, 10000 };
+  for (size_t i = 0; i < sizeof(lengths) / sizeof(size_t); ++i) {
+    size_t length = lengths[i];
+    ostringstream oss;
+    oss << "v = {";
+    for (size_t j = 0; j < length; ++j) {
+      oss << (j == 0 ? "" : ", ") << j;
+    }
+    oss << "};";
+    const string spec = oss.str();
+    runner.Run("interpreter/vector_literal", length, [&spec]() {
+        Interpreter interpreter;
+        interpreter.EvalString(spec);
+      });
+  }
+}
+
+/// Measures the throughput of decoding base64 literals of several
+/// sizes, whose text is broken into lines as by MIME encoders.
+void BenchmarkBytesLiteral(Runner &runner) {
+  size_t sizes[] = { 1 << 10, 1 << 16, 1 << 20 };
+  for (size_t i = 0; i < sizeof(sizes) / sizeof(size_t); ++i) {
+    size_t size = sizes[i];
+    Bytes blob;
+    uint8_t *data = blob.Grow(size);
+    for (size_t j = 0; j < size; ++j) {
+      data[j] = static_cast<uint8_t>(j * 131);
+    }
+    const string encoded = Base64Encode(blob);
+    ostringstream oss;
+    oss << "b64\"";
+    for (size_t j = 0; j < encoded.size(); j += 76) {
+      oss << encoded.substr(j, 76) << "\n";
+    }
+    oss << "\"";
+    const string literal = oss.str();
+    Result *result = runner.Run("tokenizer/bytes_literal", size, [&literal]() {
+        StreamTokenizer st(literal);
+        sink = st.PeekBytes().size();
+      });
+    if (result != nullptr) {
+      result->metrics.push_back(
+          make_pair("mb_per_s", literal.size() / result->ns_per_op * 1e3));
+    }
+  }
+}
+
+/// Measures the cost of a trace span, with tracing both disabled and
+/// enabled.
+void BenchmarkTrace(Runner &runner) {
+  const size_t kNumSpans = 1000;
+  const string name = "span";
+  const char *benchmark_names[] = {
+    "trace/disabled_span", "trace/enabled_span"
+  };
+  for (int enabled = 0; enabled <= 1; ++enabled) {
+    if (enabled) {
+      Tracer::Enable();
+    }
+    Result *result =
+        runner.Run(benchmark_names[enabled], kNumSpans, [&name]() {
+            for (size_t i = 0; i < kNumSpans; ++i) {
+              TraceSpan span("bench", name);
+            }
+            Tracer::Clear();
+          });
+    Tracer::Disable();
+    if (result != nullptr) {
+      result->metrics.push_back(make_pair("ns_per_span",
+                                          result->ns_per_op / kNumSpans));
+    }
+  }
+}
+
+/// Measures reads of a variable by increasing numbers of threads while
+/// another thread writes a steady stream of values to variables of the
+/// same environment.  Each operation has every reader thread perform
+/// the same number of reads, so that with perfect scaling the time per
+/// read per thread stays flat as threads are added.
+void BenchmarkConcurrent(Runner &runner) {
+  const size_t kNumReadsPerThread = 10000;
+  const size_t kNumVariables = 256;
+  const size_t kNumReaders[] = { 1, 2, 4, 8 };
+
+  ConcurrentEnvironment env;
+  Interpreter interpreter;
+  EnvironmentImpl *locked_env = interpreter.env();
+  std::mutex env_mutex;
+  vector<string> varnames;
+  for (size_t i = 0; i < kNumVariables; ++i) {
+    ostringstream varname_ss;
+    varname_ss << "x" << i;
+    varnames.push_back(varname_ss.str());
+    env.Set(varnames[i], static_cast<int>(i));
+    interpreter.EvalString(varnames[i] + " = 0;");
+  }
+
+  // Writes one variable about every ten microseconds, to each
+  // environment in turn.
+  std::atomic<bool> stop(false);
+  std::thread writer([&]() {
+      for (size_t i = 0; !stop; ++i) {
+        const string &varname = varnames[i % kNumVariables];
+        env.Set(varname, static_cast<int>(i));
+        {
+          std::lock_guard<std::mutex> lock(env_mutex);
+          ostringstream statement_ss;
+          statement_ss << varname << " = " << (i % 1000) << ";";
+          interpreter.EvalString(statement_ss.str());
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(10));
+      }
+    });
+
+  std::function<void()> concurrent_reads = [&]() {
+    int value = 0;
+    for (size_t i = 0; i < kNumReadsPerThread; ++i) {
+      env.Get(varnames[i % kNumVariables], &value);
+    }
+    sink = value;
+  };
+  std::function<void()> locked_reads = [&]() {
+    int value = 0;
+    for (size_t i = 0; i < kNumReadsPerThread; ++i) {
+      std::lock_guard<std::mutex> lock(env_mutex);
+      locked_env->Get(varnames[i % kNumVariables], &value);
+    }
+    sink = value;
+  };
+  const char *benchmark_names[] = { "concurrent/get", "concurrent/get_mutex" };
+  std::function<void()> *reads[] = { &concurrent_reads, &locked_reads };
+  for (size_t b = 0; b < 2; ++b) {
+    for (size_t n = 0; n < sizeof(kNumReaders) / sizeof(size_t); ++n) {
+      size_t num_readers = kNumReaders[n];
+      std::function<void()> &read = *reads[b];
+      Result *result =
+          runner.Run(benchmark_names[b], num_readers, [num_readers, &read]() {
+              vector<std::thread> readers;
+              for (size_t i = 0; i < num_readers; ++i) {
+                readers.push_back(std::thread(read));
+              }
+              for (size_t i = 0; i < num_readers; ++i) {
+                readers[i].join();
+              }
+            });
+      if (result != nullptr) {
+        result->metrics.push_back(
+            make_pair("ns_per_read", result->ns_per_op / kNumReadsPerThread));
+      }
+    }
+  }
+  stop = true;
+  writer.join();
+}
+
+/// Measures the ways of switching between two specifications of
+/// objects differing in a single statement: evaluating one from scratch,
+/// loading it into a config holder, which evaluates only that statement,
+/// and rolling back to a generation the holder has retained.
+void BenchmarkConfigHolder(Runner &runner) {
+  const size_t kNumStatements = 100;
+  string specs[2];
+  for (size_t s = 0; s < 2; ++s) {
+    ostringstream spec_ss;
+    for (size_t i = 1; i < kNumStatements; ++i) {
+      spec_ss << "c" << i << " = Cow(name(\"c" << i << "\"), age(3), "
+              << "color(WHITE));\n";
+    }
+    spec_ss << "generation = " << s << ";\n";
+    specs[s] = spec_ss.str();
+  }
+  runner.Run("config_holder/evaluate", kNumStatements, [&specs]() {
+      Interpreter interpreter;
+      interpreter.EvalString(specs[1]);
+    });
+
+  ConfigHolder holder(2);
+  holder.LoadString(specs[0]);
+  size_t s = 0;
+  runner.Run("config_holder/load", kNumStatements, [&holder, &specs, &s]() {
+      s = 1 - s;
+      sink = holder.LoadString(specs[s]);
+    });
+
+  size_t ids[2];
+  ids[0] = holder.LoadString(specs[0]);
+  ids[1] = holder.LoadString(specs[1]);
+  runner.Run("config_holder/rollback", kNumStatements, [&holder, &ids, &s]() {
+      s = 1 - s;
+      sink = holder.Rollback(ids[s]);
+    });
+}
+
+/// Runs the load benchmark with the specified name on the specified
+/// specification file contents.
+void RunLoad(Runner &runner, const string &name, size_t param,
+             const string &spec) {
+  Result *result = runner.Run(name, param, [&spec]() {
+      Interpreter interpreter;
+      interpreter.EvalString(spec);
+    });
+  if (result == nullptr) {
+    return;
+  }
+  AllocationScope scope;
+  size_t environment_bytes;
+  {
+    Interpreter interpreter;
+    interpreter.EvalString(spec);
+    environment_bytes = interpreter.env()->MemoryUsage(0).total_bytes();
+  }
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  result->metrics.push_back(make_pair("spec_bytes", spec.size()));
+  result->metrics.push_back(make_pair("allocations", scope.allocations()));
+  result->metrics.push_back(make_pair("allocated_bytes", scope.bytes()));
+  result->metrics.push_back(make_pair("environment_bytes",
+                                      environment_bytes));
+  result->metrics.push_back(make_pair("peak_rss_kb", usage.ru_maxrss));
+}
+
+void BenchmarkLoad(Runner &runner, const vector<string> &files) {
+  if (files.empty()) {
+    size_t sizes[] = { 100, 1000, 10000 };
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(size_t); ++i) {
+      ConfigOptions options;
+      options.num_statements = sizes[i];
+      ConfigGenerator generator(options);
+      RunLoad(runner, "load/generated", sizes[i], generator.Generate());
+    }
+  }
+  for (size_t i = 0; i < files.size(); ++i) {
+    ifstream file(files[i].c_str());
+    if (!file) {
+      cerr << "infact-bench: error: could not open " << files[i] << endl;
+      continue;
+    }
+    ostringstream oss;
+    oss << file.rdbuf();
+    RunLoad(runner, "load/file:" + files[i], oss.str().size(), oss.str());
+  }
+}
+
+}  // namespace
+
+int
+main(int argc, char **argv) {
+  double min_time = 0.5;
+  string filter;
+  vector<string> load_files;
+  bool collect_perf = false;
+  for (int i = 1; i < argc; ++i) {
+    if (strncmp(argv[i], "--min-time=", 11) == 0) {
+      min_time = atof(argv[i] + 11);
+    } else if (strncmp(argv[i], "--filter=", 9) == 0) {
+      filter = argv[i] + 9;
+    } else if (strncmp(argv[i], "--load=", 7) == 0) {
+      load_files.push_back(argv[i] + 7);
+    } else if (strcmp(argv[i], "--perf") == 0) {
+      collect_perf = true;
+    } else {
+      cerr << "usage: " << argv[0]
+           << " [--min-time=SECONDS] [--filter=SUBSTRING] [--load=FILE]..."
+           << " [--perf]" << endl;
+      return 1;
+    }
+  }
+
+  // Hardware counters are often unavailable, e.g., in containers, in
+  // which case benchmarks still report time.
+  unique_ptr<PerfCounters> perf;
+  if (collect_perf) {
+    perf.reset(new PerfCounters());
+    if (!perf->error().empty()) {
+      cerr << "infact-bench: warning: some hardware counters are "
+           << "unavailable: " << perf->error() << endl;
+    }
+    if (!perf->available()) {
+      perf.reset();
+    }
+  }
+
+  Runner runner(min_time, filter, perf.get());
+  BenchmarkTokenizer(runner);
+  BenchmarkEnvironment(runner);
+  BenchmarkBinding(runner);
+  BenchmarkFactory(runner);
+  BenchmarkVectorLiteral(runner);
+  BenchmarkBytesLiteral(runner);
+  BenchmarkTrace(runner);
+  BenchmarkConcurrent(runner);
+  BenchmarkConfigHolder(runner);
+  BenchmarkLoad(runner, load_files);
+  runner.Print(cout);
+  return 0;
+}
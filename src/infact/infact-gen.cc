@@ -0,0 +1,105 @@
+// Copyright 2014, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   * Redistributions of source code must retain the above copyright
+//     notice, this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above
+//     copyright notice, this list of conditions and the following disclaimer
+//     in the documentation and/or other materials provided with the
+//     distribution.
+//   * Neither the name of Google Inc. nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+//
+//
+/// \file
+/// Writes a synthetic specification file to standard output, for load
+/// testing with <tt>infact-bench --load=FILE</tt>.
+///
+/// Usage: <tt>infact-gen [--statements=N] [--reference-density=P]
+/// [--max-depth=D] [--vector-length=L] [--string-length=S]
+/// [--mix=KIND=WEIGHT,...] [--seed=N]</tt>
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "config-generator.h"
+
+using namespace std;
+using namespace infact;
+
+namespace {
+
+/// If the specified argument has the specified flag as its prefix, sets
+/// <tt>value</tt> to the remainder of the argument.
+bool FlagValue(const char *arg, const char *flag, const char **value) {
+  size_t flag_length = strlen(flag);
+  if (strncmp(arg, flag, flag_length) == 0) {
+    *value = arg + flag_length;
+    return true;
+  }
+  return false;
+}
+
+void Usage(const char *program) {
+  cerr << "usage: " << program << " [--statements=N] "
+       << "[--reference-density=P] [--max-depth=D] [--vector-length=L] "
+       << "[--string-length=S] [--mix=KIND=WEIGHT,...] [--seed=N]\n"
+       << "where each KIND is one of int, double, string, int[], date, "
+       << "person, cow, sheep or owner" << endl;
+}
+
+}  // namespace
+
+int
+main(int argc, char **argv) {
+  ConfigOptions options;
+  for (int i = 1; i < argc; ++i) {
+    const char *value = nullptr;
+    if (FlagValue(argv[i], "--statements=", &value)) {
+      options.num_statements = strtoul(value, nullptr, 10);
+    } else if (FlagValue(argv[i], "--reference-density=", &value)) {
+      options.reference_density = atof(value);
+    } else if (FlagValue(argv[i], "--max-depth=", &value)) {
+      options.max_depth = strtoul(value, nullptr, 10);
+    } else if (FlagValue(argv[i], "--vector-length=", &value)) {
+      options.mean_vector_length = strtoul(value, nullptr, 10);
+    } else if (FlagValue(argv[i], "--string-length=", &value)) {
+      options.mean_string_length = strtoul(value, nullptr, 10);
+    } else if (FlagValue(argv[i], "--seed=", &value)) {
+      options.seed = strtoul(value, nullptr, 10);
+    } else if (FlagValue(argv[i], "--mix=", &value)) {
+      if (!options.ParseMix(value)) {
+        cerr << argv[0] << ": error: bad statement mix \"" << value << "\""
+             << endl;
+        Usage(argv[0]);
+        return 1;
+      }
+    } else {
+      Usage(argv[0]);
+      return 1;
+    }
+  }
+  ConfigGenerator generator(options);
+  generator.Generate(cout);
+  return 0;
+}
@@ -32,10 +32,13 @@
 /// Test driver for the Interpreter class.
 /// \author dbikel@google.com (Dan Bikel)
 
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
 #include <memory>
 
 #include "interpreter.h"
+#include "trace.h"
 
 using namespace std;
 using namespace infact;
@@ -48,6 +51,13 @@ main(int argc, char **argv) {
   int debug = 0;
   cout << "Debug level: " << debug << endl;
 
+  // When INFACT_TRACE_FILE is set, a timeline of the evaluation is
+  // written to the file it names.
+  const char *trace_file = getenv("INFACT_TRACE_FILE");
+  if (trace_file != nullptr) {
+    Tracer::Enable();
+  }
+
   Interpreter interpreter(debug);
 
   cout << endl;
@@ -75,6 +85,20 @@ main(int argc, char **argv) {
   cout << "\n\nEnvironment: " << endl;
   interpreter.PrintEnv(cout);
 
+  cout << "\nMemory usage:" << endl;
+  interpreter.env()->MemoryUsage().Print(cout);
+
+  if (trace_file != nullptr) {
+    Tracer::Disable();
+    ofstream trace_os(trace_file);
+    Tracer::Write(trace_os);
+  }
+
+#ifdef INFACT_COLLECT_STATS
+  cout << "\nEvaluation statistics:" << endl;
+  interpreter.stats().Print(cout);
+#endif
+
   cout << "\nHave a nice day!\n" << endl;
 }
 
@@ -33,7 +33,11 @@
 /// Interpreter implementation.
 /// Author: dbikel@google.com (Dan Bikel)
 
+#include <fstream>
+#include <iterator>
 #include <sstream>
+#include <utility>
+#include <vector>
 
 #include "error.h"
 #include "interpreter.h"
@@ -44,13 +48,48 @@ namespace infact {
 
 using std::ostringstream;
 
+void
+Interpreter::Eval(const string &filename) {
+  filename_ = filename;
+  ifstream file(filename_.c_str(), std::ios::binary);
+  if (!file) {
+    ostringstream err_ss;
+    err_ss << "Interpreter:" << filename_ << ": error: could not open file";
+    Error(err_ss.str());
+  }
+  // Reads the file straight into the string to be evaluated, reserving
+  // its size up front where the file is seekable.
+  string contents;
+  if (file.seekg(0, std::ios::end)) {
+    std::streamoff size = file.tellg();
+    if (size > 0) {
+      contents.reserve(static_cast<size_t>(size));
+    }
+    file.seekg(0, std::ios::beg);
+  }
+  file.clear();
+  contents.assign(std::istreambuf_iterator<char>(file),
+                  std::istreambuf_iterator<char>());
+  if (file.bad()) {
+    ostringstream err_ss;
+    err_ss << "Interpreter:" << filename_ << ": error: could not read file";
+    Error(err_ss.str());
+  }
+  EvalString(contents);
+}
+
 void
 Interpreter::Eval(StreamTokenizer &st) {
+  // Files requested up front are claimed from this interpreter's
+  // loader as they are reached.
+  FileLoaderScope loader_scope(&loader_);
+
   // Keeps reading assignment statements until there are no more tokens.
   while (st.PeekTokenType() != StreamTokenizer::EOF_TYPE) {
 #ifdef INFACT_THROW_EXCEPTIONS
     try {
 #endif
+    TraceSpan span("statement");
     // Read variable name or type specifier.
     StreamTokenizer::TokenType token_type = st.PeekTokenType();
     VarMapBase *varmap = env_->GetVarMapForType(st.Peek());
@@ -79,6 +118,20 @@ Interpreter::Eval(StreamTokenizer &st) {
     }
 
     string varname = st.Next();
+    span.SetName(varname);
+
+    // An append statement has a plus sign immediately before its
+    // equals sign, and never a type specifier.
+    bool is_append = st.Peek() == "+";
+    if (is_append) {
+      size_t plus_start = st.PeekTokenStart();
+      st.Next();
+      if (st.Peek() != "=" || st.PeekTokenStart() != plus_start + 1 ||
+          is_type_specifier) {
+        WrongTokenError(plus_start, is_type_specifier ? "=" : "+=",
+                        "+" + st.Peek(), st.PeekTokenType());
+      }
+    }
 
     // Next, read equals sign.
     token_type = st.PeekTokenType();
@@ -97,8 +150,14 @@ Interpreter::Eval(StreamTokenizer &st) {
       Error(err_ss.str());
     }
 
-    // Consume and set the value for this variable in the environment.
-    env_->ReadAndSet(varname, st, type);
+    // Consume and set the value for this variable in the environment,
+    // or append it to the variable's existing value.
+    if (is_append) {
+      env_->ReadAndAppend(varname, st);
+    } else {
+      env_->ReadAndSet(varname, st, type);
+    }
+    ++assignments_[varname];
 
     token_type = st.PeekTokenType();
     if (st.Peek() != ";") {
@@ -106,6 +165,7 @@ Interpreter::Eval(StreamTokenizer &st) {
     }
     // Consume semicolon.
     st.Next();
+    INFACT_STATS_INC(statements_evaluated);
 #ifdef INFACT_THROW_EXCEPTIONS
     }
     catch (std::runtime_error &e) {
@@ -117,6 +177,172 @@ Interpreter::Eval(StreamTokenizer &st) {
   }
 }
 
+void
+Interpreter::EvalOrIndex(StreamTokenizer &st) {
+  if (lazy_) {
+    if (index_.get() == nullptr) {
+      index_.reset(new StatementIndex());
+    }
+    string rejected;
+    if (index_->Add(st, &rejected)) {
+      return;
+    }
+    // The statements must be evaluated eagerly.
+    Flatten();
+    StreamTokenizer rejected_st(rejected);
+    Eval(rejected_st);
+    return;
+  }
+  Flatten();
+  Eval(st);
+}
+
+void
+Interpreter::Flatten() {
+  if (index_.get() == nullptr) {
+    return;
+  }
+  EvalIndexed(index_->Pending());
+  index_.reset();
+  if (budget_.get() != nullptr) {
+    budget_->Clear();
+  }
+}
+
+void
+Interpreter::Materialize(const string &varname) const {
+  if (index_.get() == nullptr) {
+    return;
+  }
+  size_t index = index_->Find(varname);
+  if (index == StatementIndex::kNone) {
+    return;
+  }
+  vector<size_t> closure = index_->Closure(index);
+  if (budget_.get() != nullptr) {
+    MemoryBudget::Counters &counters = budget_->counters();
+    if (closure.empty()) {
+      ++counters.hits;
+    } else {
+      ++counters.misses;
+    }
+  }
+  EvalIndexed(closure);
+  if (budget_.get() != nullptr) {
+    budget_->Touch(index);
+    EnforceBudget(index);
+  }
+}
+
+void
+Interpreter::MaterializeAll() const {
+  if (index_.get() != nullptr) {
+    EvalIndexed(index_->Pending());
+    EnforceBudget(StatementIndex::kNone);
+  }
+}
+
+void
+Interpreter::WarmUp(const AccessProfile &profile) const {
+  vector<string> variables = profile.Variables();
+  for (size_t i = 0; i < variables.size(); ++i) {
+    Materialize(variables[i]);
+  }
+}
+
+void
+Interpreter::EvalIndexed(const vector<size_t> &indices) const {
+  // Evaluating a deferred statement only adds the variable it would
+  // have defined had it been evaluated eagerly, so it is logically
+  // const.
+  Interpreter *self = const_cast<Interpreter *>(this);
+  for (size_t i = 0; i < indices.size(); ++i) {
+    StatementIndex::Statement &statement = index_->statement(indices[i]);
+    statement.evaluated = true;
+    StreamTokenizer st(statement.text);
+    self->Eval(st);
+    if (budget_.get() != nullptr) {
+      if (statement.evicted) {
+        ++budget_->counters().rebuilds;
+        statement.evicted = false;
+      }
+      budget_->Add(indices[i], env_->ValueBytes(statement.varname));
+    }
+  }
+}
+
+void
+Interpreter::EnforceBudget(size_t spared_index) const {
+  if (budget_.get() == nullptr || !budget_->exceeded()) {
+    return;
+  }
+  vector<size_t> candidates = budget_->LeastRecentlyUsed();
+  for (size_t i = 0; i < candidates.size() && budget_->exceeded(); ++i) {
+    StatementIndex::Statement &statement = index_->statement(candidates[i]);
+    if (candidates[i] == spared_index || env_->Shared(statement.varname)) {
+      continue;
+    }
+    env_->Erase(statement.varname);
+    statement.evaluated = false;
+    statement.evicted = true;
+    budget_->Remove(candidates[i]);
+    ++budget_->counters().evictions;
+  }
+}
+
+size_t
+Interpreter::Subscribe(const string &varname, Callback callback) {
+  Subscription &subscription = subscriptions_[next_subscription_id_];
+  subscription.varname = varname;
+  subscription.callback = callback;
+  Materialize(varname);
+  subscription.defined = env_->HashValue(varname, &subscription.hash);
+  subscription.assignments = assignments_[varname];
+  return next_subscription_id_++;
+}
+
+void
+Interpreter::NotifySubscribers() {
+  if (subscriptions_.empty()) {
+    return;
+  }
+  // Hash each subscribed variable once, however many subscriptions it
+  // has, and collect the callbacks before running any, since a
+  // callback may itself subscribe or unsubscribe.
+  unordered_map<string, std::pair<bool, size_t> > states;
+  vector<std::function<void()> > tasks;
+  for (map<size_t, Subscription>::iterator it = subscriptions_.begin();
+       it != subscriptions_.end(); ++it) {
+    Subscription &subscription = it->second;
+    Materialize(subscription.varname);
+    unordered_map<string, std::pair<bool, size_t> >::iterator state_it =
+        states.find(subscription.varname);
+    if (state_it == states.end()) {
+      std::pair<bool, size_t> state(false, 0);
+      state.first = env_->HashValue(subscription.varname, &state.second);
+      state_it = states.insert(make_pair(subscription.varname, state)).first;
+    }
+    bool defined = state_it->second.first;
+    size_t hash = state_it->second.second;
+    size_t assignments = assignments_[subscription.varname];
+    bool reassigned_objects = defined &&
+        assignments != subscription.assignments &&
+        !env_->GetVarMap(subscription.varname)->IsPrimitive();
+    if (defined != subscription.defined ||
+        (defined && hash != subscription.hash) || reassigned_objects) {
+      subscription.defined = defined;
+      subscription.hash = hash;
+      subscription.assignments = assignments;
+      Callback callback = subscription.callback;
+      string varname = subscription.varname;
+      tasks.push_back([callback, varname]() { callback(varname); });
+    }
+  }
+  for (size_t i = 0; i < tasks.size(); ++i) {
+    executor_(tasks[i]);
+  }
+}
+
 void
 Interpreter::WrongTokenError(size_t pos,
                              const string &expected,
@@ -39,16 +39,29 @@
 
 #include <iostream>
 #include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <sstream>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
 
+#include "access-profile.h"
 #include "environment-impl.h"
+#include "file-loader.h"
+#include "memory-budget.h"
+#include "statement-index.h"
+#include "stats.h"
+#include "trace.h"
 
 namespace infact {
 
 using std::iostream;
 using std::ifstream;
+using std::map;
+using std::ostringstream;
+using std::unique_ptr;
 
 class EnvironmentImpl;
 
@@ -68,8 +81,22 @@ class EnvironmentImpl;
 /// bool b = true;    // assigns the value true to the boolean variable "b"
 /// int f = 1;        // assigns the int value 1 to the variable "f"
 /// double g = 2.4;   // assigns the double value 2.4 to the variable "g"
+/// float h = 2.4f;   // assigns the float value 2.4 to the variable "h"
+/// int64 id = 9000000000L;  // assigns a 64-bit integer to the variable "id"
+/// count = 12345678901;  // too large for an int, so inferred as an int64
+/// uint64 sz = 18000000000000000000u;  // assigns an unsigned 64-bit integer
 /// string n = "foo"  // assigns the string value "foo" to the variable "n"
+/// bytes blob = b64"aGVsbG8=";  // assigns the five bytes "hello" to "blob"
 /// bool[] b_vec = {true, false, true};  // assigns a vector of bool to "b_vec"
+/// map<double> w = {"foo": 1.5, "bar": -2.0};  // assigns a map to "w"
+/// tensor<float> m = {{1, 2, 3}, {4, 5, 6}};  // assigns a 2x3 tensor to "m"
+/// Color c = WHITE;  // assigns a value of a registered enumerated type
+/// ids = range(0, 1000000);    // assigns {0, 1, ..., 999999} to "ids"
+/// double[] x = range(0, 10);  // a range fills any numeric vector or tensor
+/// zeros = repeat(0.0, 1000);  // assigns a vector of 1000 zeros to "zeros"
+/// thresholds = linspace(0, 1, 11);  // assigns {0, 0.1, ..., 1}
+/// double[] w = file("weights.f64", 0, 1000);  // reads 1000 raw doubles
+/// m = file("matrix.npy");  // maps a NumPy array file, e.g., as a tensor
 ///
 /// // Constructs an object of abstract type Model and assigns it to "m1"
 /// Model m1 = PerceptronModel(name("foo"));
@@ -136,10 +163,21 @@ class EnvironmentImpl;
 ///   <td valign=top><tt>::=</tt></td>
 ///   <td valign=top>
 ///     <table border="0">
-///       <tr><td><tt>"bool" | "int" | "string" | "double" | "bool[]" | "int[]"
-///                   "string[]" | "double[]" | T | T[]</tt></td></tr>
+///       <tr><td><tt>"bool" | "int" | "int64" | "uint64" | "string" |
+///                   "float" | "double" | "bytes" | "bool[]" | "int[]" |
+///                   "int64[]" | "uint64[]" | "string[]" | "float[]" |
+///                   "double[]" | "bytes[]" |
+///                   T | T[] | "map<" P ">" | "map<" T ">" |
+///                   "tensor<" N ">" | E | E[]</tt></td></tr>
+///       <tr><td>where <tt>P</tt> is any non-vector primitive type
+///               name, such as <tt>"double"</tt>, and <tt>N</tt> is
+///               any numeric primitive type name.  <tt>"long"</tt> is
+///               an alias for <tt>"int64"</tt> wherever the latter may
+///               appear.</td></tr>
 ///       <tr><td>where <tt>T</tt> is any \link infact::Factory
 ///               Factory\endlink-constructible type.</td></tr>
+///       <tr><td>where <tt>E</tt> is any enumerated type registered
+///               via \link IMPLEMENT_ENUM \endlink.</td></tr>
 ///     </table>
 ///   </td>
 /// </tr>
@@ -152,9 +190,35 @@ class EnvironmentImpl;
 ///   <td valign=top><tt>\<value\></tt></td>
 ///   <td valign=top><tt>::=</tt></td>
 ///   <td valign=top><tt>\<literal\> | '{' \<literal_list\> '}' |<br>
-///                      \<spec_or_null\> | '{' \<spec_list\> '}'</tt>
+///                      \<spec_or_null\> | '{' \<spec_list\> '}' |<br>
+///                      '{' \<map_entry_list\> '}' | \<tensor_literal\> |<br>
+///                      \<generator\></tt>
 ///   </td>
 /// </tr>
+/// <tr>
+///   <td valign=top><tt>\<generator\></tt></td>
+///   <td valign=top><tt>::=</tt></td>
+///   <td valign=top><tt>"range" '(' [ \<start\> ',' ] \<stop\>
+///                      [ ',' \<step\> ] ')' |<br>
+///                      "repeat" '(' \<value\> ',' \<count\> ')' |<br>
+///                      "linspace" '(' \<start\> ',' \<stop\> ','
+///                      \<count\> ')' |<br>
+///                      "file" '(' \<string_literal\> [ ',' \<offset\>
+///                      [ ',' \<count\> ] ] ')'</tt><br>
+///       where a <tt>range</tt> excludes <tt>stop</tt>, a
+///       <tt>linspace</tt> includes it, <tt>repeat</tt> of an
+///       object repeats the same instance, and <tt>file</tt> reads
+///       numbers from a binary file, as described for \link
+///       infact::ExternalArray ExternalArray \endlink</td>
+/// </tr>
+/// <tr>
+///   <td valign=top><tt>\<tensor_literal\></tt></td>
+///   <td valign=top><tt>::=</tt></td>
+///   <td valign=top><tt>'{' \<literal_list\> '}' |
+///                      '{' \<tensor_literal\> [ ',' \<tensor_literal\> ]*
+///                      [','] '}'</tt><br>
+///       where all lists at the same depth have the same length</td>
+/// </tr>
 /// </table>
 ///
 /// The above grammar doesn&rsquo;t contain rules covering C++ style
@@ -167,8 +231,10 @@ class Interpreter {
   /// Constructs a new instance with the specified debug level.  The
   /// wrapped \link infact::Environment Environment \endlink will
   /// also have the specified debug level.
-  Interpreter(int debug = 0) {
+  Interpreter(int debug = 0) :
+      lazy_(false), profile_(nullptr), next_subscription_id_(0) {
     env_ = new EnvironmentImpl(debug);
+    executor_ = [](const std::function<void()> &task) { task(); };
   }
 
   /// Destroys this interpreter.
@@ -176,23 +242,37 @@ class Interpreter {
     delete env_;
   }
 
-  /// Evaluates the statements in the specified text file.
-  void Eval(const string &filename) {
-    filename_ = filename;
-    ifstream file(filename_.c_str());
-    Eval(file);
-  }
+  /// Evaluates the statements in the specified text file.  Since the
+  /// whole file is available, the files it references are requested
+  /// up front, so that they are read concurrently while the statements
+  /// before them are evaluated.  It is an error if the file cannot be
+  /// read.
+  void Eval(const string &filename);
 
-  /// Evaluates the statements in the specified string.
+  /// Evaluates the statements in the specified string, requesting the
+  /// files they reference up front unless this interpreter is lazy.
   void EvalString(const string& input) {
-    StreamTokenizer st(input);
-    Eval(st);
+    Stats stats;
+    {
+      StatsScope scope(&stats);
+      FileRequestScope requests(&loader_, lazy_ ? "" : input);
+      StreamTokenizer st(input);
+      EvalOrIndex(st);
+    }
+    AddStats(stats);
+    NotifySubscribers();
   }
 
   /// Evaluates the statements in the specified stream.
   void Eval(istream &is) {
-    StreamTokenizer st(is);
-    Eval(st);
+    Stats stats;
+    {
+      StatsScope scope(&stats);
+      StreamTokenizer st(is);
+      EvalOrIndex(st);
+    }
+    AddStats(stats);
+    NotifySubscribers();
   }
 
 
@@ -215,9 +295,82 @@ class Interpreter {
   ///                method
   template<typename T>
   bool Get(const string &varname, T *value) const {
+    if (profile_ != nullptr) {
+      profile_->Record(varname);
+    }
+    Materialize(varname);
     return env_->Get(varname, value);
   }
 
+  /// Sets whether subsequent evaluations are lazy.  A lazy evaluation
+  /// only indexes its statements; each statement is evaluated when its
+  /// variable is first retrieved with \link Get\endlink, or is built
+  /// by \link Materialize\endlink, after the statements it depends
+  /// on.  Until then, the variable is absent from the environment, so
+  /// code reading the environment directly, such as a \link
+  /// infact::Binding Binding\endlink, should first build the variables
+  /// it reads.
+  ///
+  /// Statements are only deferred if every variable they assign is
+  /// assigned exactly once; otherwise, they are evaluated eagerly.
+  /// Errors in a deferred statement are reported when it is evaluated.
+  void set_lazy(bool lazy) { lazy_ = lazy; }
+
+  /// Returns whether evaluations are lazy.
+  bool lazy() const { return lazy_; }
+
+  /// Evaluates the deferred statement assigning the specified variable,
+  /// if any, along with the deferred statements on which it depends.
+  /// This does not change the value of any variable as observed
+  /// through \link Get\endlink, and so is <tt>const</tt>.
+  void Materialize(const string &varname) const;
+
+  /// Evaluates all deferred statements.
+  void MaterializeAll() const;
+
+  /// Builds the variables recorded in the specified profile, in order
+  /// of their first reads, so that they need not be built on demand.
+  /// An application would typically invoke this method after a lazy
+  /// evaluation and before reporting that it is ready, leaving the
+  /// remaining variables to be built on demand.
+  void WarmUp(const AccessProfile &profile) const;
+
+  /// Limits the memory held by variables built from the statements of
+  /// lazy evaluations to approximately the specified number of bytes.
+  /// When the limit is exceeded, such variables are evicted from the
+  /// environment in least-recently-used order and are rebuilt from
+  /// their statements when next retrieved with \link Get\endlink.  A
+  /// variable is not evicted while it is pinned, i.e., while its value
+  /// shares an object with code outside the environment, such as a
+  /// caller holding a <tt>shared_ptr</tt> returned by \link Get
+  /// \endlink or another variable whose value refers to it.  Since
+  /// statements must be retained, variables of eager evaluations are
+  /// never evicted.  Eviction invalidates pointers to values returned
+  /// by \link infact::EnvironmentImpl::Find EnvironmentImpl::Find
+  /// \endlink, and therefore \link infact::Binding Binding\endlink
+  /// slots.
+  ///
+  /// \param budget_bytes the budget in bytes, or zero for no budget
+  void set_memory_budget(size_t budget_bytes) {
+    if (budget_bytes == 0) {
+      budget_.reset();
+    } else if (budget_.get() == nullptr) {
+      budget_.reset(new MemoryBudget(budget_bytes));
+    } else {
+      budget_->set_budget_bytes(budget_bytes);
+    }
+  }
+
+  /// Returns the memory budget set by \link set_memory_budget\endlink,
+  /// along with its eviction, rebuild and hit-rate counters, or
+  /// <tt>nullptr</tt> if there is no budget.
+  const MemoryBudget *memory_budget() const { return budget_.get(); }
+
+  /// Records each subsequent invocation of \link Get \endlink in the
+  /// specified profile, which must outlive this interpreter or be
+  /// replaced; recording stops if the profile is <tt>nullptr</tt>.
+  void RecordAccesses(AccessProfile *profile) { profile_ = profile; }
+
   /// Returns a pointer to the environment of this interpreter.
   /// Crucially, this method returns a pointer to the Environment
   /// implementation class, \link infact::EnvironmentImpl
@@ -226,10 +379,94 @@ class Interpreter {
   /// method may be invoked.
   EnvironmentImpl *env() { return env_; }
 
+  /// Returns the counters describing all evaluations performed by this
+  /// interpreter.  The counters are only updated when the library is
+  /// compiled with <tt>INFACT_COLLECT_STATS</tt> defined.
+  const Stats &stats() const { return stats_; }
+
+  /// A function invoked with the name of a subscribed variable when
+  /// its value changes.
+  typedef std::function<void(const string &varname)> Callback;
+
+  /// A function that runs a task, for example by queueing it on a
+  /// thread pool.
+  typedef std::function<void(const std::function<void()> &task)> Executor;
+
+  /// Subscribes to changes of the specified variable.  After each
+  /// evaluation of a string, stream or file in which the variable is
+  /// defined, redefined or changed in value, the specified callback is
+  /// run once on this interpreter&rsquo;s executor, however many times
+  /// the variable was assigned.  Values are compared by a hash of their
+  /// content (see \link infact::ValueHash ValueHash\endlink), except
+  /// that every assignment to a variable holding objects is a change,
+  /// since a new object may occupy the address of the one it replaced.
+  ///
+  /// \param varname  the name of the variable whose changes to report
+  /// \param callback the function to invoke with the variable&rsquo;s
+  ///                 name when it changes
+  /// \return an identifier for the subscription, for use with \link
+  ///         Unsubscribe\endlink
+  size_t Subscribe(const string &varname, Callback callback);
+
+  /// Cancels the subscription with the specified identifier.
+  void Unsubscribe(size_t id) { subscriptions_.erase(id); }
+
+  /// Sets the executor on which subscription callbacks are run.  By
+  /// default, callbacks are run synchronously, at the end of the
+  /// evaluation that changed their variables.  Callbacks run elsewhere
+  /// must not access this interpreter while it is evaluating.
+  void SetExecutor(Executor executor) { executor_ = executor; }
+
  private:
+  /// The state of a subscription to a variable.
+  struct Subscription {
+    /// The name of the subscribed variable.
+    string varname;
+    /// The function to invoke when the variable changes.
+    Callback callback;
+    /// Whether the variable was defined after the last evaluation.
+    bool defined;
+    /// The hash of the variable&rsquo;s value after the last evaluation.
+    size_t hash;
+    /// The number of assignments to the variable as of the last
+    /// evaluation.
+    size_t assignments;
+  };
+
+  /// Runs the callbacks of all subscriptions whose variables have
+  /// changed since the last evaluation.
+  void NotifySubscribers();
+
+  /// Adds the counts of an evaluation to those of this interpreter and
+  /// to the process-wide counts.
+  void AddStats(const Stats &stats) {
+#ifdef INFACT_COLLECT_STATS
+    stats_.Add(stats);
+    Stats::AddToGlobal(stats);
+#endif
+  }
+
   /// Evalutes the expressions contained in the specified token stream.
   void Eval(StreamTokenizer &st);
 
+  /// Indexes the expressions contained in the specified token stream
+  /// if this interpreter is lazy and evaluates them otherwise.
+  void EvalOrIndex(StreamTokenizer &st);
+
+  /// Evaluates all deferred statements and forgets all indexed ones,
+  /// so that none of their variables may be evicted.  This precedes
+  /// each eager evaluation, whose statements might refer to or reassign
+  /// any variable.
+  void Flatten();
+
+  /// Evaluates the deferred statements with the specified indices.
+  void EvalIndexed(const vector<size_t> &indices) const;
+
+  /// Evicts unpinned variables in least-recently-used order until the
+  /// memory budget is no longer exceeded, sparing the variable assigned
+  /// by the statement with the specified index.
+  void EnforceBudget(size_t spared_index) const;
+
   void WrongTokenError(size_t pos,
                        const string &expected,
                        const string &found,
@@ -248,6 +485,41 @@ class Interpreter {
   /// The environment of this interpreter.
   EnvironmentImpl *env_;
 
+  /// Whether evaluations are lazy.
+  bool lazy_;
+
+  /// The statements of lazy evaluations, or <tt>nullptr</tt> if there
+  /// have been none.
+  unique_ptr<StatementIndex> index_;
+
+  /// The memory budget for variables built lazily, or <tt>nullptr</tt>
+  /// if there is none.
+  unique_ptr<MemoryBudget> budget_;
+
+  /// The profile in which reads of variables are recorded, or
+  /// <tt>nullptr</tt> if they are not being recorded.
+  AccessProfile *profile_;
+
+  /// The counters describing all evaluations by this interpreter.
+  Stats stats_;
+
+  /// The subscriptions to changes of variables, by identifier.
+  map<size_t, Subscription> subscriptions_;
+
+  /// The number of statements that have assigned each variable, by
+  /// which subscriptions detect reassigned objects.
+  unordered_map<string, size_t> assignments_;
+
+  /// The identifier of the next subscription.
+  size_t next_subscription_id_;
+
+  /// The executor on which subscription callbacks are run.
+  Executor executor_;
+
+  /// The loader that reads the files referenced by evaluations ahead
+  /// of their use.
+  FileLoader loader_;
+
   /// The name of the file being interpreted, or the empty string if there
   /// is no file associated with the stream being interpreted.
   string filename_;
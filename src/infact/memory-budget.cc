@@ -0,0 +1,82 @@
+// Copyright 2014, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   * Redistributions of source code must retain the above copyright
+//     notice, this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above
+//     copyright notice, this list of conditions and the following disclaimer
+//     in the documentation and/or other materials provided with the
+//     distribution.
+//   * Neither the name of Google Inc. nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+//
+//
+/// \file
+/// Implementation of the MemoryBudget class.
+
+#include "memory-budget.h"
+
+namespace infact {
+
+void
+MemoryBudget::Counters::Print(ostream &os) const {
+  os << "hits " << hits << "\n"
+     << "misses " << misses << "\n"
+     << "rebuilds " << rebuilds << "\n"
+     << "evictions " << evictions << "\n"
+     << "hit_rate " << hit_rate() << "\n";
+  os.flush();
+}
+
+void
+MemoryBudget::Add(size_t index, size_t bytes) {
+  Remove(index);
+  recency_.push_front(index);
+  Entry &entry = entries_[index];
+  entry.bytes = bytes;
+  entry.position = recency_.begin();
+  resident_bytes_ += bytes;
+}
+
+void
+MemoryBudget::Touch(size_t index) {
+  unordered_map<size_t, Entry>::iterator it = entries_.find(index);
+  if (it != entries_.end()) {
+    recency_.splice(recency_.begin(), recency_, it->second.position);
+  }
+}
+
+void
+MemoryBudget::Remove(size_t index) {
+  unordered_map<size_t, Entry>::iterator it = entries_.find(index);
+  if (it != entries_.end()) {
+    resident_bytes_ -= it->second.bytes;
+    recency_.erase(it->second.position);
+    entries_.erase(it);
+  }
+}
+
+vector<size_t>
+MemoryBudget::LeastRecentlyUsed() const {
+  return vector<size_t>(recency_.rbegin(), recency_.rend());
+}
+
+}  // namespace infact
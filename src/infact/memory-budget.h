@@ -0,0 +1,147 @@
+// Copyright 2014, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   * Redistributions of source code must retain the above copyright
+//     notice, this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above
+//     copyright notice, this list of conditions and the following disclaimer
+//     in the documentation and/or other materials provided with the
+//     distribution.
+//   * Neither the name of Google Inc. nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+//
+//
+/// \file
+/// Provides the \link infact::MemoryBudget MemoryBudget \endlink class,
+/// which tracks the memory held by the variables an \link
+/// infact::Interpreter Interpreter \endlink has built lazily, so that
+/// the least recently used may be evicted and later rebuilt.
+
+#ifndef INFACT_MEMORY_BUDGET_H_
+#define INFACT_MEMORY_BUDGET_H_
+
+#include <cstddef>
+#include <iostream>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+namespace infact {
+
+using std::list;
+using std::ostream;
+using std::unordered_map;
+using std::vector;
+
+/// A budget for the memory held by rebuildable variables, each
+/// identified by the index of the statement that builds it, along with
+/// the order in which they were last used.
+class MemoryBudget {
+ public:
+  /// Counters describing the effectiveness of a budget.
+  struct Counters {
+    Counters() : hits(0), misses(0), rebuilds(0), evictions(0) { }
+    /// The number of uses of a variable that was already built.
+    size_t hits;
+    /// The number of uses of a variable that had to be built.
+    size_t misses;
+    /// The number of builds of a variable that had been evicted.
+    size_t rebuilds;
+    /// The number of evictions.
+    size_t evictions;
+
+    /// Returns the fraction of uses that were hits, or zero if there
+    /// have been none.
+    double hit_rate() const {
+      size_t uses = hits + misses;
+      return uses == 0 ? 0.0 : static_cast<double>(hits) / uses;
+    }
+
+    /// Prints each counter on its own line as a name followed by a
+    /// value, like \link infact::Stats::Print Stats::Print\endlink.
+    void Print(ostream &os) const;
+  };
+
+  /// Constructs a budget of the specified number of bytes.
+  explicit MemoryBudget(size_t budget_bytes) :
+      budget_bytes_(budget_bytes), resident_bytes_(0) { }
+
+  /// Records that the variable with the specified index was built and
+  /// holds the specified number of bytes, making it the most recently
+  /// used.
+  void Add(size_t index, size_t bytes);
+
+  /// Makes the variable with the specified index the most recently used.
+  void Touch(size_t index);
+
+  /// Records that the variable with the specified index was evicted.
+  void Remove(size_t index);
+
+  /// Removes all resident variables from this budget, without counting
+  /// them as evicted, so that they are no longer candidates for eviction.
+  void Clear() {
+    recency_.clear();
+    entries_.clear();
+    resident_bytes_ = 0;
+  }
+
+  /// Returns the indices of the resident variables, from the least to
+  /// the most recently used.
+  vector<size_t> LeastRecentlyUsed() const;
+
+  /// Returns whether the resident variables hold more than the budget.
+  bool exceeded() const { return resident_bytes_ > budget_bytes_; }
+
+  /// Returns the budget, in bytes.
+  size_t budget_bytes() const { return budget_bytes_; }
+
+  /// Sets the budget, in bytes.
+  void set_budget_bytes(size_t budget_bytes) { budget_bytes_ = budget_bytes; }
+
+  /// Returns the number of bytes held by the resident variables.
+  size_t resident_bytes() const { return resident_bytes_; }
+
+  /// Returns the counters of this budget, for update by its user.
+  Counters &counters() { return counters_; }
+
+  /// Returns the counters of this budget.
+  const Counters &counters() const { return counters_; }
+
+ private:
+  /// A resident variable.
+  struct Entry {
+    /// The number of bytes held by the variable.
+    size_t bytes;
+    /// The position of the variable in the recency list.
+    list<size_t>::iterator position;
+  };
+
+  size_t budget_bytes_;
+  size_t resident_bytes_;
+  /// The indices of the resident variables, most recently used first.
+  list<size_t> recency_;
+  unordered_map<size_t, Entry> entries_;
+  Counters counters_;
+};
+
+}  // namespace infact
+
+#endif
@@ -0,0 +1,103 @@
+// Copyright 2014, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   * Redistributions of source code must retain the above copyright
+//     notice, this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above
+//     copyright notice, this list of conditions and the following disclaimer
+//     in the documentation and/or other materials provided with the
+//     distribution.
+//   * Neither the name of Google Inc. nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+//
+//
+/// \file
+/// Implementation of the \link infact::MemoryUsageReport
+/// MemoryUsageReport \endlink class.
+
+#include <algorithm>
+
+#include "memory-usage.h"
+
+namespace infact {
+
+using std::endl;
+
+void
+MemoryUsageReport::AddTypeOverhead(const string &type, size_t bytes) {
+  types_[type].bytes += bytes;
+  total_bytes_ += bytes;
+}
+
+void
+MemoryUsageReport::AddVariable(const string &name, const string &type,
+                               size_t bytes) {
+  TypeUsage &type_usage = types_[type];
+  ++type_usage.num_variables;
+  type_usage.bytes += bytes;
+  total_bytes_ += bytes;
+
+  if (num_largest_ == 0) {
+    return;
+  }
+  if (largest_.size() == num_largest_) {
+    if (bytes <= largest_.front().bytes) {
+      return;
+    }
+    std::pop_heap(largest_.begin(), largest_.end(), Larger);
+    largest_.pop_back();
+  }
+  VariableUsage variable_usage;
+  variable_usage.name = name;
+  variable_usage.type = type;
+  variable_usage.bytes = bytes;
+  largest_.push_back(variable_usage);
+  std::push_heap(largest_.begin(), largest_.end(), Larger);
+}
+
+vector<MemoryUsageReport::VariableUsage>
+MemoryUsageReport::Largest() const {
+  vector<VariableUsage> largest(largest_);
+  std::sort(largest.begin(), largest.end(), Larger);
+  return largest;
+}
+
+void
+MemoryUsageReport::Print(ostream &os) const {
+  os << "Total: " << total_bytes_ << " bytes" << endl;
+  os << "By type:" << endl;
+  for (map<string, TypeUsage>::const_iterator it = types_.begin();
+       it != types_.end(); ++it) {
+    if (it->second.num_variables == 0) {
+      continue;
+    }
+    os << "  " << it->first << ": " << it->second.num_variables
+       << " variables, " << it->second.bytes << " bytes" << endl;
+  }
+  vector<VariableUsage> largest = Largest();
+  os << "Largest variables:" << endl;
+  for (size_t i = 0; i < largest.size(); ++i) {
+    os << "  " << largest[i].type << " " << largest[i].name << ": "
+       << largest[i].bytes << " bytes" << endl;
+  }
+}
+
+}  // namespace infact
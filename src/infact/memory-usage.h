@@ -0,0 +1,301 @@
+// Copyright 2014, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   * Redistributions of source code must retain the above copyright
+//     notice, this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above
+//     copyright notice, this list of conditions and the following disclaimer
+//     in the documentation and/or other materials provided with the
+//     distribution.
+//   * Neither the name of Google Inc. nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+//
+//
+/// \file
+/// Provides approximate accounting of the memory held by the values in
+/// an \link infact::Environment Environment\endlink.  Sizes are
+/// computed from the sizes and capacities of containers rather than by
+/// walking the heap, so they omit allocator overhead and are only
+/// estimates.
+
+#ifndef INFACT_MEMORY_USAGE_H_
+#define INFACT_MEMORY_USAGE_H_
+
+#include <cstddef>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "bytes.h"
+
+namespace infact {
+
+using std::map;
+using std::ostream;
+using std::pair;
+using std::shared_ptr;
+using std::string;
+using std::unordered_map;
+using std::unordered_set;
+using std::vector;
+
+/// Remembers the buffers and objects already accounted for, so that
+/// data shared by several values, such as an object held by two
+/// <tt>shared_ptr</tt>&rsquo;s, is counted once, and so that cycles of
+/// objects are not followed forever.
+class MemoryVisitor {
+ public:
+  /// Returns <tt>true</tt> the first time it is invoked for the
+  /// specified address and <tt>false</tt> thereafter.
+  bool Visit(const void *address) {
+    return visited_.insert(address).second;
+  }
+
+ private:
+  unordered_set<const void *> visited_;
+};
+
+/// A template class that estimates the number of bytes owned by a
+/// value beyond its own <tt>sizeof</tt>, i.e., the heap buffers it
+/// holds and everything reachable from them.  The basic implementation
+/// works for arithmetic and enumerated types, which own nothing.
+///
+/// \tparam T      the type of value whose memory is to be estimated
+/// \tparam Enable a parameter allowing whole families of types, such as
+///                all enumerated types, to be handled by a single partial
+///                specialization
+template <typename T, typename Enable = void>
+class MemorySize {
+ public:
+  size_t HeapBytes(const T &value, MemoryVisitor *visitor) const {
+    return 0;
+  }
+};
+
+/// A specialization of the MemorySize class for strings, which own a
+/// heap buffer unless they are short enough to be stored inline.
+template<>
+class MemorySize<string> {
+ public:
+  size_t HeapBytes(const string &value, MemoryVisitor *visitor) const {
+    const char *inline_start = reinterpret_cast<const char *>(&value);
+    const char *inline_end = inline_start + sizeof(string);
+    if (value.data() >= inline_start && value.data() < inline_end) {
+      return 0;
+    }
+    return value.capacity() + 1;
+  }
+};
+
+/// A specialization of the MemorySize class for binary blobs, whose
+/// buffers may be shared among copies.
+template<>
+class MemorySize<Bytes> {
+ public:
+  size_t HeapBytes(const Bytes &value, MemoryVisitor *visitor) const {
+    if (value.data() == nullptr || !visitor->Visit(value.data())) {
+      return 0;
+    }
+    return value.capacity();
+  }
+};
+
+/// A partial specialization of the MemorySize class for vectors, which
+/// own their element buffer and whatever their elements own.
+///
+/// \tparam T the element type of the vector
+template <typename T>
+class MemorySize<vector<T> > {
+ public:
+  size_t HeapBytes(const vector<T> &value, MemoryVisitor *visitor) const {
+    size_t bytes = value.capacity() * sizeof(T);
+    MemorySize<T> element_size;
+    for (typename vector<T>::const_iterator it = value.begin();
+         it != value.end(); ++it) {
+      bytes += element_size.HeapBytes(*it, visitor);
+    }
+    return bytes;
+  }
+};
+
+/// The number of bytes of bookkeeping assumed for each entry of an
+/// <tt>unordered_map</tt>: a pointer to the next node and a cached hash.
+static const size_t kHashNodeOverhead = sizeof(void *) + sizeof(size_t);
+
+/// A partial specialization of the MemorySize class for maps from
+/// strings to values.
+///
+/// \tparam T the type of values in the map
+template <typename T>
+class MemorySize<unordered_map<string, T> > {
+ public:
+  size_t HeapBytes(const unordered_map<string, T> &value,
+                   MemoryVisitor *visitor) const {
+    size_t bytes = value.bucket_count() * sizeof(void *);
+    MemorySize<string> key_size;
+    MemorySize<T> value_size;
+    for (typename unordered_map<string, T>::const_iterator it = value.begin();
+         it != value.end(); ++it) {
+      bytes += kHashNodeOverhead + sizeof(*it) +
+          key_size.HeapBytes(it->first, visitor) +
+          value_size.HeapBytes(it->second, visitor);
+    }
+    return bytes;
+  }
+};
+
+/// A template class that reports whether a value shares ownership of
+/// an object with code outside the \link infact::Environment
+/// Environment\endlink holding it, in which case discarding the value
+/// would not free the object.  The basic implementation is for values
+/// that own nothing shared.
+///
+/// \tparam T      the type of value
+/// \tparam Enable a parameter allowing whole families of types to be
+///                handled by a single partial specialization
+template <typename T, typename Enable = void>
+class ValueSharing {
+ public:
+  bool Shared(const T &value) const { return false; }
+};
+
+/// A partial specialization of the ValueSharing class for objects,
+/// which are shared if any other <tt>shared_ptr</tt> refers to them.
+///
+/// \tparam T the type of object
+template <typename T>
+class ValueSharing<shared_ptr<T> > {
+ public:
+  bool Shared(const shared_ptr<T> &value) const {
+    return value.use_count() > 1;
+  }
+};
+
+/// A partial specialization of the ValueSharing class for vectors,
+/// which are shared if any of their elements is.
+///
+/// \tparam T the element type of the vector
+template <typename T>
+class ValueSharing<vector<T> > {
+ public:
+  bool Shared(const vector<T> &value) const {
+    ValueSharing<T> element_sharing;
+    for (typename vector<T>::const_iterator it = value.begin();
+         it != value.end(); ++it) {
+      if (element_sharing.Shared(*it)) {
+        return true;
+      }
+    }
+    return false;
+  }
+};
+
+/// A partial specialization of the ValueSharing class for maps from
+/// strings to values, which are shared if any of their values is.
+///
+/// \tparam T the type of values in the map
+template <typename T>
+class ValueSharing<unordered_map<string, T> > {
+ public:
+  bool Shared(const unordered_map<string, T> &value) const {
+    ValueSharing<T> value_sharing;
+    for (typename unordered_map<string, T>::const_iterator it = value.begin();
+         it != value.end(); ++it) {
+      if (value_sharing.Shared(it->second)) {
+        return true;
+      }
+    }
+    return false;
+  }
+};
+
+/// A report of the approximate memory held by the variables of an
+/// \link infact::Environment Environment\endlink, as returned by \link
+/// infact::Environment::MemoryUsage Environment::MemoryUsage\endlink.
+/// An object or buffer reachable from several variables is counted
+/// only once, against the first variable found to reach it.
+class MemoryUsageReport {
+ public:
+  /// The memory held by the variables of a single type.
+  struct TypeUsage {
+    TypeUsage() : num_variables(0), bytes(0) { }
+    /// The number of variables of the type.
+    size_t num_variables;
+    /// The number of bytes held by those variables, including the
+    /// storage of the VarMap holding them.
+    size_t bytes;
+  };
+
+  /// The memory held by a single variable.
+  struct VariableUsage {
+    /// The name of the variable.
+    string name;
+    /// The type of the variable.
+    string type;
+    /// The number of bytes held by the variable.
+    size_t bytes;
+  };
+
+  /// Constructs an empty report that retains the specified number of
+  /// largest variables.
+  explicit MemoryUsageReport(size_t num_largest = 10) :
+      num_largest_(num_largest), total_bytes_(0) { }
+
+  /// Accounts for the specified number of bytes of overhead, such as
+  /// the storage of a VarMap, against the specified type.
+  void AddTypeOverhead(const string &type, size_t bytes);
+
+  /// Accounts for the specified variable.
+  void AddVariable(const string &name, const string &type, size_t bytes);
+
+  /// Returns the approximate total number of bytes held.
+  size_t total_bytes() const { return total_bytes_; }
+
+  /// Returns the memory held per type, keyed by type name.
+  const map<string, TypeUsage> &types() const { return types_; }
+
+  /// Returns the largest variables, in decreasing order of size.
+  vector<VariableUsage> Largest() const;
+
+  /// Prints a human-readable summary of this report.
+  void Print(ostream &os) const;
+
+ private:
+  /// Orders variables so that the smallest is at the front of a heap.
+  static bool Larger(const VariableUsage &a, const VariableUsage &b) {
+    return a.bytes > b.bytes;
+  }
+
+  size_t num_largest_;
+  size_t total_bytes_;
+  map<string, TypeUsage> types_;
+  /// A min-heap of the largest variables seen so far.
+  vector<VariableUsage> largest_;
+};
+
+}  // namespace infact
+
+#endif
@@ -0,0 +1,175 @@
+// Copyright 2014, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   * Redistributions of source code must retain the above copyright
+//     notice, this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above
+//     copyright notice, this list of conditions and the following disclaimer
+//     in the documentation and/or other materials provided with the
+//     distribution.
+//   * Neither the name of Google Inc. nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+//
+//
+/// \file
+/// Implementation of the \link infact::PerfCounters PerfCounters
+/// \endlink class.
+
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "perf-counters.h"
+
+namespace infact {
+
+using std::ostringstream;
+
+#ifdef __linux__
+
+namespace {
+
+/// The value read from a counter opened with the read format below.
+struct CounterValue {
+  uint64_t value;
+  uint64_t time_enabled;
+  uint64_t time_running;
+};
+
+/// Opens a counter of the specified type and configuration for the
+/// calling thread, returning its file descriptor or -1 on failure.
+int OpenCounter(uint32_t type, uint64_t config) {
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = type;
+  attr.config = config;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format =
+      PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+}  // namespace
+
+PerfCounters::PerfCounters() {
+  struct {
+    const char *name;
+    uint32_t type;
+    uint64_t config;
+  } specs[] = {
+    { "cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { "instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { "l1d_misses", PERF_TYPE_HW_CACHE,
+      PERF_COUNT_HW_CACHE_L1D |
+      (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+    { "llc_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+    { "branch_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+  };
+  ostringstream err_ss;
+  for (size_t i = 0; i < sizeof(specs) / sizeof(specs[0]); ++i) {
+    int fd = OpenCounter(specs[i].type, specs[i].config);
+    if (fd < 0) {
+      err_ss << (err_ss.tellp() > 0 ? "; " : "") << specs[i].name << ": "
+             << strerror(errno);
+      continue;
+    }
+    Counter counter;
+    counter.name = specs[i].name;
+    counter.fd = fd;
+    counters_.push_back(counter);
+  }
+  error_ = err_ss.str();
+}
+
+PerfCounters::~PerfCounters() {
+  for (size_t i = 0; i < counters_.size(); ++i) {
+    close(counters_[i].fd);
+  }
+}
+
+void
+PerfCounters::Start() {
+  for (size_t i = 0; i < counters_.size(); ++i) {
+    ioctl(counters_[i].fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(counters_[i].fd, PERF_EVENT_IOC_ENABLE, 0);
+  }
+}
+
+void
+PerfCounters::Stop() {
+  for (size_t i = 0; i < counters_.size(); ++i) {
+    ioctl(counters_[i].fd, PERF_EVENT_IOC_DISABLE, 0);
+  }
+}
+
+vector<pair<string, uint64_t> >
+PerfCounters::Read() const {
+  vector<pair<string, uint64_t> > values;
+  for (size_t i = 0; i < counters_.size(); ++i) {
+    CounterValue counter_value;
+    if (read(counters_[i].fd, &counter_value, sizeof(counter_value)) !=
+        sizeof(counter_value)) {
+      continue;
+    }
+    uint64_t value = counter_value.value;
+    if (counter_value.time_running > 0 &&
+        counter_value.time_running < counter_value.time_enabled) {
+      value = static_cast<uint64_t>(
+          static_cast<double>(value) * counter_value.time_enabled /
+          counter_value.time_running);
+    }
+    values.push_back(make_pair(counters_[i].name, value));
+  }
+  return values;
+}
+
+#else
+
+PerfCounters::PerfCounters() :
+    error_("perf_event_open is only available on Linux") { }
+
+PerfCounters::~PerfCounters() { }
+
+void
+PerfCounters::Start() { }
+
+void
+PerfCounters::Stop() { }
+
+vector<pair<string, uint64_t> >
+PerfCounters::Read() const {
+  return vector<pair<string, uint64_t> >();
+}
+
+#endif
+
+}  // namespace infact
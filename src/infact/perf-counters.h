@@ -0,0 +1,97 @@
+// Copyright 2014, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   * Redistributions of source code must retain the above copyright
+//     notice, this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above
+//     copyright notice, this list of conditions and the following disclaimer
+//     in the documentation and/or other materials provided with the
+//     distribution.
+//   * Neither the name of Google Inc. nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+//
+//
+/// \file
+/// Provides hardware performance counters for benchmarks, read through
+/// the Linux <tt>perf_event_open</tt> system call.
+
+#ifndef INFACT_PERF_COUNTERS_H_
+#define INFACT_PERF_COUNTERS_H_
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace infact {
+
+using std::pair;
+using std::string;
+using std::vector;
+
+/// Counts cycles, instructions, L1 data cache read misses, last-level
+/// cache misses and branch misses of the calling thread between
+/// invocations of \link Start \endlink and \link Stop\endlink.  Each
+/// counter is opened independently, so that those the kernel or a
+/// container refuses are simply omitted; if none can be opened,
+/// \link available \endlink returns <tt>false</tt> and \link Read
+/// \endlink returns nothing.
+class PerfCounters {
+ public:
+  /// Opens all counters supported by the current system.
+  PerfCounters();
+
+  /// Closes all open counters.
+  ~PerfCounters();
+
+  /// Returns whether at least one counter could be opened.
+  bool available() const { return !counters_.empty(); }
+
+  /// Returns a description of why counters could not be opened, or
+  /// the empty string if all were opened.
+  const string &error() const { return error_; }
+
+  /// Resets all counters and starts counting.
+  void Start();
+
+  /// Stops counting.
+  void Stop();
+
+  /// Returns the name and value of each open counter, as counted
+  /// between the most recent invocations of \link Start \endlink and
+  /// \link Stop\endlink.  Values are scaled up when the kernel had to
+  /// multiplex the counters.
+  vector<pair<string, uint64_t> > Read() const;
+
+ private:
+  /// An open counter.
+  struct Counter {
+    string name;
+    int fd;
+  };
+
+  vector<Counter> counters_;
+  string error_;
+};
+
+}  // namespace infact
+
+#endif
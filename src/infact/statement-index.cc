@@ -0,0 +1,154 @@
+// Copyright 2014, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   * Redistributions of source code must retain the above copyright
+//     notice, this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above
+//     copyright notice, this list of conditions and the following disclaimer
+//     in the documentation and/or other materials provided with the
+//     distribution.
+//   * Neither the name of Google Inc. nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+//
+//
+/// \file
+/// Implementation of the StatementIndex class.
+
+#include <algorithm>
+#include <unordered_set>
+
+#include "statement-index.h"
+
+namespace infact {
+
+using std::unordered_set;
+
+const size_t StatementIndex::kNone;
+
+bool
+StatementIndex::Add(StreamTokenizer &st, string *rejected) {
+  vector<Statement> statements;
+  unordered_map<string, size_t> assignments;
+  bool ok = true;
+  size_t first_start = st.PeekTokenStart();
+  while (st.HasNext()) {
+    size_t start = st.PeekTokenStart();
+    // The variable is the identifier immediately preceding the first
+    // equals sign; any tokens before it are a type specifier.
+    string varname;
+    string prev;
+    StreamTokenizer::TokenType prev_type = StreamTokenizer::EOF_TYPE;
+    while (st.HasNext() && st.Peek() != "=" && st.Peek() != ";") {
+      prev_type = st.PeekTokenType();
+      prev = st.Next();
+    }
+    // An append statement modifies a variable defined earlier, so
+    // deferring it would break the one-statement-per-variable index.
+    if (st.HasNext() && st.Peek() == "=" &&
+        prev_type == StreamTokenizer::IDENTIFIER && prev != "+") {
+      varname = prev;
+    } else {
+      ok = false;
+    }
+    Statement statement;
+    statement.varname = varname;
+    statement.evaluated = false;
+    statement.evicted = false;
+    // Any identifier in the value naming a variable assigned by an
+    // earlier statement is a dependency.  Identifiers such as member
+    // names that happen to name variables only cause extra work.
+    while (st.HasNext() && st.Peek() != ";") {
+      StreamTokenizer::TokenType type = st.PeekTokenType();
+      string token = st.Next();
+      if (type != StreamTokenizer::IDENTIFIER) {
+        continue;
+      }
+      size_t dependency = Find(token);
+      unordered_map<string, size_t>::const_iterator it =
+          assignments.find(token);
+      if (it != assignments.end()) {
+        dependency = it->second;
+      }
+      if (dependency != kNone &&
+          std::find(statement.dependencies.begin(),
+                    statement.dependencies.end(),
+                    dependency) == statement.dependencies.end()) {
+        statement.dependencies.push_back(dependency);
+      }
+    }
+    if (!st.HasNext()) {
+      ok = false;
+      break;
+    }
+    // Consume semicolon.
+    st.Next();
+    statement.text = st.substr(start, st.tellg() - start);
+    if (!ok || Find(varname) != kNone || assignments.count(varname) > 0) {
+      ok = false;
+      continue;
+    }
+    assignments[varname] = statements_.size() + statements.size();
+    statements.push_back(statement);
+  }
+  if (!ok) {
+    *rejected = st.substr(first_start, st.tellg() - first_start);
+    return false;
+  }
+  for (size_t i = 0; i < statements.size(); ++i) {
+    statements_.push_back(statements[i]);
+  }
+  assignments_.insert(assignments.begin(), assignments.end());
+  return true;
+}
+
+vector<size_t>
+StatementIndex::Closure(size_t index) const {
+  // Statements only depend on earlier ones, so sorting the closure by
+  // index puts every statement after its dependencies.
+  vector<size_t> closure;
+  vector<size_t> to_visit(1, index);
+  unordered_set<size_t> visited;
+  while (!to_visit.empty()) {
+    size_t i = to_visit.back();
+    to_visit.pop_back();
+    if (statements_[i].evaluated || !visited.insert(i).second) {
+      continue;
+    }
+    closure.push_back(i);
+    const vector<size_t> &dependencies = statements_[i].dependencies;
+    to_visit.insert(to_visit.end(), dependencies.begin(), dependencies.end());
+  }
+  std::sort(closure.begin(), closure.end());
+  return closure;
+}
+
+vector<size_t>
+StatementIndex::Pending() const {
+  vector<size_t> pending;
+  for (size_t i = 0; i < statements_.size(); ++i) {
+    if (!statements_[i].evaluated) {
+      pending.push_back(i);
+    }
+  }
+  return pending;
+}
+
+}  // namespace infact
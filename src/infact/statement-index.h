@@ -0,0 +1,131 @@
+// Copyright 2014, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   * Redistributions of source code must retain the above copyright
+//     notice, this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above
+//     copyright notice, this list of conditions and the following disclaimer
+//     in the documentation and/or other materials provided with the
+//     distribution.
+//   * Neither the name of Google Inc. nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+//
+//
+/// \file
+/// Provides the \link infact::StatementIndex StatementIndex \endlink
+/// class, which records the assignment statements of a specification
+/// without evaluating them, so that an \link infact::Interpreter
+/// Interpreter \endlink may evaluate each one only when its variable is
+/// first needed.
+
+#ifndef INFACT_STATEMENT_INDEX_H_
+#define INFACT_STATEMENT_INDEX_H_
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "stream-tokenizer.h"
+
+namespace infact {
+
+using std::string;
+using std::unordered_map;
+using std::vector;
+
+/// An index of assignment statements, each with the variable it
+/// assigns and the earlier statements whose variables it refers to.
+/// Statements are only indexed if every variable is assigned exactly
+/// once, since otherwise the value a statement sees for a variable
+/// would depend on the order in which statements were evaluated.
+class StatementIndex {
+ public:
+  /// An indexed assignment statement.
+  struct Statement {
+    /// The text of the statement, including its terminating semicolon.
+    string text;
+    /// The name of the variable assigned by the statement.
+    string varname;
+    /// The indices of the statements assigning variables to which this
+    /// statement refers.
+    vector<size_t> dependencies;
+    /// Whether the statement has been evaluated.
+    bool evaluated;
+    /// Whether the variable assigned by the statement has been evicted
+    /// since the statement was last evaluated.
+    bool evicted;
+  };
+
+  /// Reads all the statements available from the specified stream
+  /// tokenizer and adds them to this index.  If any statement is
+  /// malformed or assigns a variable assigned by another statement,
+  /// this index is left unchanged and the statements are returned in
+  /// <tt>rejected</tt>, so that they may be evaluated eagerly, with any
+  /// errors reported as usual.
+  ///
+  /// \param      st       the stream tokenizer providing the statements
+  /// \param[out] rejected the text of the statements, if they could not
+  ///                      be indexed
+  /// \return whether the statements were added to this index
+  bool Add(StreamTokenizer &st, string *rejected);
+
+  /// Returns the index of the statement assigning the specified
+  /// variable, or <tt>kNone</tt> if there is no such statement.
+  size_t Find(const string &varname) const {
+    unordered_map<string, size_t>::const_iterator it =
+        assignments_.find(varname);
+    return it == assignments_.end() ? kNone : it->second;
+  }
+
+  /// Returns the indices of the unevaluated statements that must be
+  /// evaluated, in order, for the specified statement to be evaluated:
+  /// those of its unevaluated dependencies, transitively, followed by
+  /// itself if it is unevaluated.
+  vector<size_t> Closure(size_t index) const;
+
+  /// Returns the indices of all unevaluated statements, in order.
+  vector<size_t> Pending() const;
+
+  /// Returns the statement with the specified index.
+  Statement &statement(size_t index) { return statements_[index]; }
+
+  /// Returns the statement with the specified index.
+  const Statement &statement(size_t index) const {
+    return statements_[index];
+  }
+
+  /// Returns the number of statements in this index.
+  size_t size() const { return statements_.size(); }
+
+  /// The value returned by \link Find \endlink when there is no
+  /// statement assigning a variable.
+  static const size_t kNone = static_cast<size_t>(-1);
+
+ private:
+  vector<Statement> statements_;
+  /// A map from each variable to the index of the statement assigning it.
+  unordered_map<string, size_t> assignments_;
+};
+
+}  // namespace infact
+
+#endif
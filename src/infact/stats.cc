@@ -0,0 +1,108 @@
+// Copyright 2014, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   * Redistributions of source code must retain the above copyright
+//     notice, this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above
+//     copyright notice, this list of conditions and the following disclaimer
+//     in the documentation and/or other materials provided with the
+//     distribution.
+//   * Neither the name of Google Inc. nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+//
+//
+/// \file
+/// Implementation of the \link infact::Stats Stats \endlink class.
+
+#include <mutex>
+
+#include "stats.h"
+
+namespace infact {
+
+using std::lock_guard;
+using std::mutex;
+
+thread_local Stats *Stats::current_ = nullptr;
+
+namespace {
+
+mutex global_stats_mutex;
+
+Stats &global_stats() {
+  static Stats stats;
+  return stats;
+}
+
+}  // namespace
+
+void
+Stats::Add(const Stats &other) {
+  tokens_lexed += other.tokens_lexed;
+  bytes_lexed += other.bytes_lexed;
+  statements_evaluated += other.statements_evaluated;
+  environment_copies += other.environment_copies;
+  variables_copied += other.variables_copied;
+  dynamic_casts += other.dynamic_casts;
+  for (map<string, size_t>::const_iterator it =
+           other.objects_constructed.begin();
+       it != other.objects_constructed.end(); ++it) {
+    objects_constructed[it->first] += it->second;
+  }
+  for (map<string, double>::const_iterator it =
+           other.post_init_seconds.begin();
+       it != other.post_init_seconds.end(); ++it) {
+    post_init_seconds[it->first] += it->second;
+  }
+}
+
+void
+Stats::Print(ostream &os) const {
+  os << "tokens_lexed " << tokens_lexed << "\n"
+     << "bytes_lexed " << bytes_lexed << "\n"
+     << "statements_evaluated " << statements_evaluated << "\n"
+     << "environment_copies " << environment_copies << "\n"
+     << "variables_copied " << variables_copied << "\n"
+     << "dynamic_casts " << dynamic_casts << "\n";
+  for (map<string, size_t>::const_iterator it = objects_constructed.begin();
+       it != objects_constructed.end(); ++it) {
+    os << "objects_constructed." << it->first << " " << it->second << "\n";
+  }
+  for (map<string, double>::const_iterator it = post_init_seconds.begin();
+       it != post_init_seconds.end(); ++it) {
+    os << "post_init_seconds." << it->first << " " << it->second << "\n";
+  }
+  os.flush();
+}
+
+Stats
+Stats::Global() {
+  lock_guard<mutex> lock(global_stats_mutex);
+  return global_stats();
+}
+
+void
+Stats::AddToGlobal(const Stats &stats) {
+  lock_guard<mutex> lock(global_stats_mutex);
+  global_stats().Add(stats);
+}
+
+}  // namespace infact
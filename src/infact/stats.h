@@ -0,0 +1,200 @@
+// Copyright 2014, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   * Redistributions of source code must retain the above copyright
+//     notice, this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above
+//     copyright notice, this list of conditions and the following disclaimer
+//     in the documentation and/or other materials provided with the
+//     distribution.
+//   * Neither the name of Google Inc. nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+//
+//
+/// \file
+/// Provides the \link infact::Stats Stats \endlink class, which holds
+/// counters describing the work done while evaluating specifications,
+/// along with the macros used to update them.  Collection is enabled
+/// by defining <tt>INFACT_COLLECT_STATS</tt> when compiling the
+/// library (e.g., with <tt>CPPFLAGS=-DINFACT_COLLECT_STATS</tt>);
+/// otherwise, the macros expand to nothing and all counters stay zero.
+
+#ifndef INFACT_STATS_H_
+#define INFACT_STATS_H_
+
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <map>
+#include <string>
+
+namespace infact {
+
+using std::map;
+using std::ostream;
+using std::string;
+
+/// Counters describing the work done while evaluating specifications.
+/// An \link infact::Interpreter Interpreter \endlink keeps one instance
+/// covering its own evaluations, and adds each evaluation&rsquo;s counts
+/// to the process-wide instance returned by \link Stats::Global
+/// \endlink.  Counters are only updated when
+/// <tt>INFACT_COLLECT_STATS</tt> is defined.
+class Stats {
+ public:
+  /// Constructs an instance with all counters set to zero.
+  Stats() { Clear(); }
+
+  /// Sets all counters to zero.
+  void Clear() {
+    tokens_lexed = 0;
+    bytes_lexed = 0;
+    statements_evaluated = 0;
+    environment_copies = 0;
+    variables_copied = 0;
+    dynamic_casts = 0;
+    objects_constructed.clear();
+    post_init_seconds.clear();
+  }
+
+  /// Adds the counts of the specified instance to this one.
+  void Add(const Stats &other);
+
+  /// Prints each counter on its own line as a name followed by a
+  /// value, suitable for export to a metrics system.  Per-type
+  /// counters have names of the form
+  /// <tt>objects_constructed.</tt><i>type</i>.
+  void Print(ostream &os) const;
+
+  /// Returns the instance currently collecting counts on this thread,
+  /// or <tt>nullptr</tt> if there is none.
+  static Stats *current() { return current_; }
+
+  /// Returns a copy of the process-wide counts.
+  static Stats Global();
+
+  /// Adds the specified counts to the process-wide counts.
+  static void AddToGlobal(const Stats &stats);
+
+  /// The number of tokens read by stream tokenizers.
+  size_t tokens_lexed;
+  /// The number of characters read by stream tokenizers.
+  size_t bytes_lexed;
+  /// The number of assignment statements evaluated by an interpreter.
+  size_t statements_evaluated;
+  /// The number of invocations of \link infact::Environment::Copy
+  /// Environment::Copy \endlink.
+  size_t environment_copies;
+  /// The total number of variable bindings duplicated by those copies.
+  size_t variables_copied;
+  /// The number of <tt>dynamic_cast</tt> operations performed to reach
+  /// a type-specific \link infact::VarMap VarMap \endlink.
+  size_t dynamic_casts;
+  /// The number of objects constructed by factories, per concrete type.
+  map<string, size_t> objects_constructed;
+  /// The total time spent in <tt>PostInit</tt> methods, in seconds, per
+  /// concrete type.
+  map<string, double> post_init_seconds;
+
+ private:
+  friend class StatsScope;
+
+  static thread_local Stats *current_;
+};
+
+/// Directs the counts collected on the current thread to a \link
+/// Stats \endlink instance for the lifetime of this object, restoring
+/// the previous collector on destruction.  When
+/// <tt>INFACT_COLLECT_STATS</tt> is not defined, this class does nothing.
+class StatsScope {
+ public:
+  /// Starts collecting counts into the specified instance.
+  explicit StatsScope(Stats *stats) {
+#ifdef INFACT_COLLECT_STATS
+    previous_ = Stats::current_;
+    Stats::current_ = stats;
+#endif
+  }
+
+  /// Restores the previous collector.
+  ~StatsScope() {
+#ifdef INFACT_COLLECT_STATS
+    Stats::current_ = previous_;
+#endif
+  }
+
+ private:
+#ifdef INFACT_COLLECT_STATS
+  Stats *previous_;
+#endif
+};
+
+/// Counts the construction of an object of the specified concrete type
+/// and measures the time until destruction of this object, which is
+/// attributed to the type&rsquo;s <tt>PostInit</tt> method.
+class PostInitTimer {
+ public:
+  /// Starts timing the <tt>PostInit</tt> method of the specified type.
+  explicit PostInitTimer(const string &type) :
+      type_(type), start_(std::chrono::steady_clock::now()) { }
+
+  /// Attributes the elapsed time to the type passed at construction.
+  ~PostInitTimer() {
+    Stats *stats = Stats::current();
+    if (stats != nullptr) {
+      std::chrono::duration<double> elapsed =
+          std::chrono::steady_clock::now() - start_;
+      ++stats->objects_constructed[type_];
+      stats->post_init_seconds[type_] += elapsed.count();
+    }
+  }
+
+ private:
+  const string &type_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+}  // namespace infact
+
+#ifdef INFACT_COLLECT_STATS
+/// Adds the specified amount to the specified counter of the current
+/// thread&rsquo;s \link infact::Stats Stats \endlink collector, if any.
+#define INFACT_STATS_ADD(counter, amount)                               \
+  do {                                                                  \
+    infact::Stats *infact_stats = infact::Stats::current();             \
+    if (infact_stats != nullptr) {                                      \
+      infact_stats->counter += (amount);                                \
+    }                                                                   \
+  } while (0)
+/// Times the remainder of the enclosing scope as the <tt>PostInit</tt>
+/// method of the specified concrete type.
+#define INFACT_STATS_TIME_POST_INIT(type) \
+  infact::PostInitTimer infact_post_init_timer(type)
+#else
+#define INFACT_STATS_ADD(counter, amount)
+#define INFACT_STATS_TIME_POST_INIT(type)
+#endif
+
+/// Increments the specified counter of the current thread&rsquo;s
+/// \link infact::Stats Stats \endlink collector, if any.
+#define INFACT_STATS_INC(counter) INFACT_STATS_ADD(counter, 1)
+
+#endif
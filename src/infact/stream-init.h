@@ -36,8 +36,12 @@
 #ifndef INFACT_STREAM_INIT_H_
 #define INFACT_STREAM_INIT_H_
 
+#include <cerrno>
+#include <cstdint>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <limits>
 #include <sstream>
 #include <memory>
 #include <unordered_map>
@@ -79,8 +83,12 @@ template <typename T> class Factory;
 /// A class to initialize a \link Factory\endlink-constructible
 /// object.
 ///
-/// \tparam T a <tt>shared_ptr</tt> to any type constructible by a Factory
-template <typename T>
+/// \tparam T      a <tt>shared_ptr</tt> to any type constructible by a
+///                Factory
+/// \tparam Enable a parameter allowing whole families of types, such as
+///                all enumerated types, to be handled by a single partial
+///                specialization
+template <typename T, typename Enable = void>
 class Initializer : public StreamInitializer {
  public:
   Initializer(T *member) : member_(member) { }
@@ -107,7 +115,8 @@ class Initializer : public StreamInitializer {
 };
 
 /// A specialization to allow Factory-constructible objects to initialize
-/// <tt>int</tt> data members.
+/// <tt>int</tt> data members.  A literal out of the range of an
+/// <tt>int</tt> is an error rather than being truncated.
 template<>
 class Initializer<int> : public StreamInitializer {
  public:
@@ -123,12 +132,140 @@ class Initializer<int> : public StreamInitializer {
              << st.Peek() << "\"";
       Error(err_ss.str());
     }
-    (*member_) = atoi(st.Next().c_str());
+    size_t next_tok_start = st.PeekTokenStart();
+    string next_tok = st.Next();
+    const char *begin = next_tok.c_str();
+    char *end = nullptr;
+    errno = 0;
+    long value = strtol(begin, &end, 10);
+    if (end == begin || *end != '\0' || errno == ERANGE ||
+        value < std::numeric_limits<int>::min() ||
+        value > std::numeric_limits<int>::max()) {
+      ostringstream err_ss;
+      err_ss << "IntInitializer: could not parse integer at stream "
+             << "position " << next_tok_start << " from token: \""
+             << next_tok << "\"";
+      Error(err_ss.str());
+    }
+    (*member_) = static_cast<int>(value);
   }
  private:
   int *member_;
 };
 
+/// A specialization to initialize <tt>int64_t</tt> data members.  The
+/// literal may optionally carry an <tt>L</tt> or <tt>LL</tt> suffix.
+template<>
+class Initializer<int64_t> : public StreamInitializer {
+ public:
+  Initializer(int64_t *member) : member_(member) { }
+  virtual ~Initializer() { }
+  virtual void Init(StreamTokenizer &st, Environment *env = nullptr) {
+    StreamTokenizer::TokenType token_type = st.PeekTokenType();
+    if (token_type != StreamTokenizer::NUMBER) {
+      ostringstream err_ss;
+      err_ss << "Int64Initializer: expected NUMBER token at stream "
+             << "position " << st.PeekTokenStart() << " but found "
+             << StreamTokenizer::TypeName(token_type) << " token: \""
+             << st.Peek() << "\"";
+      Error(err_ss.str());
+    }
+    size_t next_tok_start = st.PeekTokenStart();
+    string next_tok = st.Next();
+    const char *begin = next_tok.c_str();
+    char *end = nullptr;
+    errno = 0;
+    long long value = strtoll(begin, &end, 10);
+    if (end == begin || errno == ERANGE ||
+        strspn(end, "lL") != strlen(end)) {
+      ostringstream err_ss;
+      err_ss << "Int64Initializer: could not parse 64-bit integer "
+             << "at stream position " << next_tok_start << " from token: \""
+             << next_tok << "\"";
+      Error(err_ss.str());
+    }
+    (*member_) = static_cast<int64_t>(value);
+  }
+ private:
+  int64_t *member_;
+};
+
+/// A specialization to initialize <tt>uint64_t</tt> data members.  The
+/// literal may optionally carry a <tt>U</tt>, <tt>UL</tt> or <tt>ULL</tt>
+/// suffix.
+template<>
+class Initializer<uint64_t> : public StreamInitializer {
+ public:
+  Initializer(uint64_t *member) : member_(member) { }
+  virtual ~Initializer() { }
+  virtual void Init(StreamTokenizer &st, Environment *env = nullptr) {
+    StreamTokenizer::TokenType token_type = st.PeekTokenType();
+    if (token_type != StreamTokenizer::NUMBER) {
+      ostringstream err_ss;
+      err_ss << "Uint64Initializer: expected NUMBER token at stream "
+             << "position " << st.PeekTokenStart() << " but found "
+             << StreamTokenizer::TypeName(token_type) << " token: \""
+             << st.Peek() << "\"";
+      Error(err_ss.str());
+    }
+    size_t next_tok_start = st.PeekTokenStart();
+    string next_tok = st.Next();
+    const char *begin = next_tok.c_str();
+    char *end = nullptr;
+    errno = 0;
+    // Note that strtoull happily negates a value with a leading minus sign,
+    // so we reject those explicitly.
+    unsigned long long value = strtoull(begin, &end, 10);
+    if (end == begin || errno == ERANGE || next_tok[0] == '-' ||
+        strspn(end, "uUlL") != strlen(end)) {
+      ostringstream err_ss;
+      err_ss << "Uint64Initializer: could not parse unsigned 64-bit "
+             << "integer at stream position " << next_tok_start
+             << " from token: \"" << next_tok << "\"";
+      Error(err_ss.str());
+    }
+    (*member_) = static_cast<uint64_t>(value);
+  }
+ private:
+  uint64_t *member_;
+};
+
+/// A specialization to initialize <tt>float</tt> data members.  The
+/// literal may optionally carry an <tt>f</tt> or <tt>F</tt> suffix.
+template<>
+class Initializer<float> : public StreamInitializer {
+ public:
+  Initializer(float *member) : member_(member) { }
+  virtual ~Initializer() { }
+  virtual void Init(StreamTokenizer &st, Environment *env = nullptr) {
+    StreamTokenizer::TokenType token_type = st.PeekTokenType();
+    if (token_type != StreamTokenizer::NUMBER) {
+      ostringstream err_ss;
+      err_ss << "FloatInitializer: expected NUMBER token at stream "
+             << "position " << st.PeekTokenStart() << " but found "
+             << StreamTokenizer::TypeName(token_type) << " token: \""
+             << st.Peek() << "\"";
+      Error(err_ss.str());
+    }
+    size_t next_tok_start = st.PeekTokenStart();
+    string next_tok = st.Next();
+    const char *begin = next_tok.c_str();
+    char *end = nullptr;
+    float value = strtof(begin, &end);
+    if (end == begin ||
+        (*end != '\0' && (strchr("fF", *end) == nullptr || end[1] != '\0'))) {
+      ostringstream err_ss;
+      err_ss << "FloatInitializer: could not parse float at stream "
+             << "position " << next_tok_start << " from token: \""
+             << next_tok << "\"";
+      Error(err_ss.str());
+    }
+    (*member_) = value;
+  }
+ private:
+  float *member_;
+};
+
 /// A specialization to initialize <tt>double</tt> data members.
 template<>
 class Initializer<double> : public StreamInitializer {
@@ -207,6 +344,31 @@ class Initializer<string> : public StreamInitializer {
   string *member_;
 };
 
+/// A specialization to initialize <tt>Bytes</tt> data members from
+/// base64 literals, which are decoded by the \link StreamTokenizer
+/// \endlink itself.
+template<>
+class Initializer<Bytes> : public StreamInitializer {
+ public:
+  Initializer(Bytes *member) : member_(member) { }
+  virtual ~Initializer() { }
+  virtual void Init(StreamTokenizer &st, Environment *env = nullptr) {
+    StreamTokenizer::TokenType token_type = st.PeekTokenType();
+    if (token_type != StreamTokenizer::BYTES) {
+      ostringstream err_ss;
+      err_ss << "BytesInitializer: expected BYTES token at stream "
+             << "position " << st.PeekTokenStart() << " but found "
+             << StreamTokenizer::TypeName(token_type) << " token: \""
+             << st.Peek() << "\"";
+      Error(err_ss.str());
+    }
+    (*member_) = st.PeekBytes();
+    st.Next();
+  }
+ private:
+  Bytes *member_;
+};
+
 }  // namespace infact
 
 #endif
@@ -34,6 +34,7 @@
 /// class.
 /// \author dbikel@google.com (Dan Bikel)
 
+#include <cstdlib>
 #include <iostream>
 #include <string>
 
@@ -102,6 +103,19 @@ main(int argc, char **argv) {
     cout << "chars so far: '" << st1.str() << "'" << endl;
   }
 
+  cerr << "\nMemory held: " << st1.TokenHistoryBytes()
+       << " bytes of token history, " << st1.BufferBytes()
+       << " bytes of buffered characters" << endl;
+
+  // The buffer holds every character read, and the history grows with
+  // the number of tokens.
+  StreamTokenizer one_token("foo");
+  one_token.Next();
+  bool memory_ok = st1.BufferBytes() >= test_string.size() &&
+      one_token.BufferBytes() >= 3 && one_token.TokenHistoryBytes() > 0 &&
+      st1.TokenHistoryBytes() > one_token.TokenHistoryBytes();
+  cerr << (memory_ok ? "PASS" : "FAIL") << " memory usage" << endl;
+
   cerr << "\nReading from stdin until EOF:" << endl;
 
   StreamTokenizer st2(cin);
@@ -110,4 +124,5 @@ main(int argc, char **argv) {
     cout << "token: \"" << st2.Next() << "\""
          << "; type=" << StreamTokenizer::TypeName(type) << endl;
   }
+  return memory_ok ? EXIT_SUCCESS : EXIT_FAILURE;
 }
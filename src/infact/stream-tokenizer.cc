@@ -34,6 +34,7 @@
 /// \endlink class.
 /// \author dbikel@google.com (Dan Bikel)
 
+#include <algorithm>
 #include <ctype.h>
 #include <sstream>
 #include <stdexcept>
@@ -44,7 +45,7 @@ namespace infact {
 
 void
 StreamTokenizer::ConsumeChar(char c) {
-  oss_ << c;
+  chars_ += c;
   ++num_read_;
   if (c == '\n') {
     ++line_number_;
@@ -63,6 +64,66 @@ StreamTokenizer::ReadChar(char *c) {
   }
 }
 
+void
+StreamTokenizer::ReadBase64Literal(Token *next) {
+  // Base64 literals may be very large, so rather than reading them one
+  // character at a time via ReadChar, pull characters straight from the
+  // stream buffer and decode them a chunk at a time.
+  size_t literal_start_pos = num_read_ - 4;
+  std::streambuf *buf = is_.rdbuf();
+  Base64Decoder decoder;
+  char chunk[4096];
+  bool found_closing_quote = false;
+  bool valid = true;
+  size_t invalid_pos = 0;
+  while (!found_closing_quote) {
+    size_t length = 0;
+    int ch = EOF;
+    while (length < sizeof(chunk)) {
+      ch = buf->sbumpc();
+      if (ch == EOF || ch == '"') {
+        break;
+      }
+      chunk[length++] = static_cast<char>(ch);
+    }
+    if (valid) {
+      size_t decoded = decoder.Decode(chunk, length);
+      if (decoded < length) {
+        valid = false;
+        invalid_pos = num_read_ + decoded;
+      }
+    }
+    chars_.append(chunk, length);
+    num_read_ += length;
+    line_number_ += std::count(chunk, chunk + length, '\n');
+    if (ch == '"') {
+      ConsumeChar('"');
+      found_closing_quote = true;
+    } else if (ch == EOF) {
+      is_.setstate(std::ios::eofbit);
+      break;
+    }
+  }
+  if (!found_closing_quote) {
+    ostringstream err_ss;
+    err_ss << "StreamTokenizer: error: could not find closing "
+           << "double quote for base64 literal beginning at stream index "
+           << literal_start_pos;
+    Error(err_ss.str());
+  }
+  if (!valid || !decoder.Finish(&next->bytes)) {
+    ostringstream err_ss;
+    err_ss << "StreamTokenizer: error: invalid base64 literal beginning at "
+           << "stream index " << literal_start_pos;
+    if (!valid) {
+      err_ss << "; bad character at stream index " << invalid_pos;
+    }
+    Error(err_ss.str());
+  }
+  next->tok = "b64\"...\"";
+  next->type = BYTES;
+}
+
 bool
 StreamTokenizer::GetNext(Token *next) {
   if (!is_.good()) {
@@ -150,7 +211,11 @@ StreamTokenizer::GetNext(Token *next) {
       int peek = is_.peek();
       if (peek != EOF) {
         char next_char = static_cast<char>(peek);
-        if (ReservedChar(next_char) || next_char == '"' || isspace(next_char)) {
+        // A plus sign also ends an identifier, so that the variable
+        // name of an append statement like "v+={1};" stands alone.
+        bool ends_identifier = next->type == IDENTIFIER && next_char == '+';
+        if (ReservedChar(next_char) || next_char == '"' || isspace(next_char) ||
+            ends_identifier) {
           // Now that we've finished reading something that is not a
           // string literal, change its type to be RESERVED_WORD if it
           // exactly matches something in the set of reserved words.
@@ -166,6 +231,12 @@ StreamTokenizer::GetNext(Token *next) {
 	eof_reached_ = true;
       }
     }
+    // An identifier "b64" immediately followed by a double quote begins a
+    // base64 literal.
+    if (next->type == IDENTIFIER && next->tok == "b64" && is_.peek() == '"') {
+      ReadChar(&c);
+      ReadBase64Literal(next);
+    }
   }
   // We're about to return a successfully read token, so we make sure to record
   // the stream position at this point in the Token object.
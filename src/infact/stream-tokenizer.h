@@ -44,7 +44,10 @@
 #include <string.h>
 #include <vector>
 
+#include "bytes.h"
 #include "error.h"
+#include "memory-usage.h"
+#include "stats.h"
 
 namespace infact {
 
@@ -70,16 +73,40 @@ static const char *default_reserved_words[] = {
   "true",
   "bool",
   "int",
+  "int64",
+  "long",
+  "uint64",
+  "float",
   "double",
   "string",
   "bool[]",
   "int[]",
+  "int64[]",
+  "long[]",
+  "uint64[]",
+  "float[]",
   "double[]",
   "string[]",
+  "map<bool>",
+  "map<int>",
+  "map<int64>",
+  "map<long>",
+  "map<uint64>",
+  "map<float>",
+  "map<double>",
+  "map<string>",
+  "tensor<int>",
+  "tensor<int64>",
+  "tensor<long>",
+  "tensor<uint64>",
+  "tensor<float>",
+  "tensor<double>",
+  "bytes",
+  "bytes[]",
 };
 
 /// Default set of reserved characters for the StreamTokenizer class.
-#define DEFAULT_RESERVED_CHARS "(){},=;/"
+#define DEFAULT_RESERVED_CHARS "(){},=;/:"
 
 /// \class StreamTokenizer
 ///
@@ -97,13 +124,15 @@ class StreamTokenizer {
     RESERVED_WORD,
     STRING,
     NUMBER,
-    IDENTIFIER
+    IDENTIFIER,
+    BYTES
   };
 
   /// Returns a string type name for the specified TokenType constant.
   static const char *TypeName(TokenType token_type) {
     static const char *names[] = {
-      "EOF", "RESERVED_CHAR", "RESERVED_WORD", "STRING", "NUMBER", "IDENTIFIER"
+      "EOF", "RESERVED_CHAR", "RESERVED_WORD", "STRING", "NUMBER", "IDENTIFIER",
+      "BYTES"
     };
     return names[token_type];
   }
@@ -114,6 +143,9 @@ class StreamTokenizer {
     string tok;
     /// The token&rsquo;s type.
     TokenType type;
+    /// The decoded contents of a base64 literal, when this token is of
+    /// type <tt>BYTES</tt>.
+    Bytes bytes;
 
     // The following three fields capture information about the underlying
     // byte stream at the time this token was read from it.
@@ -161,12 +193,44 @@ class StreamTokenizer {
 
   /// Destroys this instance.
   virtual ~StreamTokenizer() {
+    INFACT_STATS_ADD(tokens_lexed, token_.size());
+    INFACT_STATS_ADD(bytes_lexed, num_read_);
     delete[] reserved_chars_;
   }
 
   /// Returns the entire sequence of characters read so far by this
   /// stream tokenizer as a newly constructed string object.
-  string str() { return oss_.str(); }
+  string str() const { return chars_; }
+
+  /// Returns the specified range of the characters read so far by this
+  /// stream tokenizer.  Unlike extracting the range from \link str
+  /// \endlink, this takes time proportional to the length of the range
+  /// rather than to the number of characters read.
+  ///
+  /// \param pos the stream position of the first character of the range
+  /// \param len the number of characters in the range
+  string substr(size_t pos, size_t len) const {
+    return chars_.substr(pos, len);
+  }
+
+  /// Returns an estimate of the number of bytes held by the history of
+  /// tokens retained by this stream tokenizer to support \link Rewind
+  /// \endlink and \link Putback\endlink.
+  size_t TokenHistoryBytes() const {
+    size_t bytes = token_.capacity() * sizeof(Token);
+    MemoryVisitor visitor;
+    MemorySize<string> tok_size;
+    MemorySize<Bytes> bytes_size;
+    for (size_t i = 0; i < token_.size(); ++i) {
+      bytes += tok_size.HeapBytes(token_[i].tok, &visitor) +
+          bytes_size.HeapBytes(token_[i].bytes, &visitor);
+    }
+    return bytes;
+  }
+
+  /// Returns the number of bytes held by the buffer of characters read
+  /// so far, as returned by \link str\endlink.
+  size_t BufferBytes() const { return chars_.capacity(); }
 
   /// Returns the number of bytes read from the underlying byte
   /// stream just after scanning the most recent token, or 0 if this stream
@@ -270,6 +334,13 @@ class StreamTokenizer {
   /// when \link HasNext \endlink returns <tt>true</tt>.
   string Peek() const { return HasNext() ? token_[next_token_idx_].tok : ""; }
 
+  /// Returns the decoded contents of the next token if it is a base64
+  /// literal of the form <tt>b64"..."</tt> (i.e., if \link PeekTokenType
+  /// \endlink returns <tt>BYTES</tt>), or an empty blob otherwise.
+  Bytes PeekBytes() const {
+    return HasNext() ? token_[next_token_idx_].bytes : Bytes();
+  }
+
  private:
   void Init(const char *reserved_chars) {
     num_reserved_chars_ = strlen(reserved_chars);
@@ -298,6 +369,11 @@ class StreamTokenizer {
   ///         it was successfully gotten
   bool GetNext(Token *next);
 
+  /// Reads the remainder of a base64 literal, just after its opening
+  /// double quote, decoding it directly into the <tt>bytes</tt> field of
+  /// the specified token.
+  void ReadBase64Literal(Token *next);
+
   /// Returns whether the specified character represents a
   /// &ldquo;reserved character&rdquo;.
   bool ReservedChar(char c) const {
@@ -327,7 +403,8 @@ class StreamTokenizer {
   size_t num_read_;
   size_t line_number_;
   bool eof_reached_;
-  ostringstream oss_;
+  /// The characters read so far.
+  string chars_;
 
   // The sequence of tokens read so far.
   vector<Token> token_;
@@ -0,0 +1,240 @@
+// Copyright 2014, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   * Redistributions of source code must retain the above copyright
+//     notice, this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above
+//     copyright notice, this list of conditions and the following disclaimer
+//     in the documentation and/or other materials provided with the
+//     distribution.
+//   * Neither the name of Google Inc. nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+//
+//
+//
+//
+/// \file
+/// Implementation of the \link infact::StringArray StringArray \endlink
+/// class.
+
+#include <algorithm>
+
+#include "string-array.h"
+
+namespace infact {
+
+namespace {
+
+// Appends the specified value to the specified buffer as a varint of
+// seven bits per byte, least significant first.
+void
+WriteVarint(size_t value, vector<char> *chars) {
+  while (value >= 0x80) {
+    chars->push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  chars->push_back(static_cast<char>(value));
+}
+
+// Reads a varint written by WriteVarint, returning the position just
+// past it.
+const char *
+ReadVarint(const char *p, size_t *value) {
+  size_t result = 0;
+  int shift = 0;
+  uint8_t byte;
+  do {
+    byte = static_cast<uint8_t>(*p++);
+    result |= static_cast<size_t>(byte & 0x7f) << shift;
+    shift += 7;
+  } while (byte & 0x80);
+  *value = result;
+  return p;
+}
+
+}  // namespace
+
+const size_t StringArray::npos;
+const size_t StringArray::kBlockSize;
+
+void
+StringArray::const_iterator::Load() {
+  if (!array_->front_coded_ || index_ >= array_->size_) {
+    return;
+  }
+  if (index_ % kBlockSize == 0) {
+    const Buffer &buffer = *array_->buffer_;
+    next_ = buffer.chars.data() + buffer.offsets[index_ / kBlockSize];
+  }
+  next_ = DecodeElement(next_, &element_);
+}
+
+string
+StringArray::Get(size_t i) const {
+  if (!front_coded_) {
+    return (*this)[i].ToString();
+  }
+  const char *p = buffer_->chars.data() + buffer_->offsets[i / kBlockSize];
+  string element;
+  for (size_t j = i - i % kBlockSize; j <= i; ++j) {
+    p = DecodeElement(p, &element);
+  }
+  return element;
+}
+
+size_t
+StringArray::Find(const StringRef &s) const {
+  if (!sorted_) {
+    size_t i = 0;
+    for (const_iterator it = begin(); it != end(); ++it, ++i) {
+      if (*it == s) {
+        return i;
+      }
+    }
+    return npos;
+  }
+
+  if (!front_coded_) {
+    size_t low = 0;
+    size_t high = size_;
+    while (low < high) {
+      size_t mid = low + (high - low) / 2;
+      if ((*this)[mid] < s) {
+        low = mid + 1;
+      } else {
+        high = mid;
+      }
+    }
+    return low < size_ && (*this)[low] == s ? low : npos;
+  }
+
+  // Find the last block whose first element, which is stored in full
+  // after its two varints, is no greater than the target.
+  const vector<uint32_t> &offsets = buffer_->offsets;
+  size_t low = 0;
+  size_t high = offsets.size();
+  while (low < high) {
+    size_t mid = low + (high - low) / 2;
+    size_t prefix_length, suffix_length;
+    const char *p = buffer_->chars.data() + offsets[mid];
+    p = ReadVarint(ReadVarint(p, &prefix_length), &suffix_length);
+    if (s < StringRef(p, suffix_length)) {
+      high = mid;
+    } else {
+      low = mid + 1;
+    }
+  }
+  if (low == 0) {
+    return npos;
+  }
+  size_t block = low - 1;
+  const char *p = buffer_->chars.data() + offsets[block];
+  string element;
+  size_t end_index = std::min(size_, (block + 1) * kBlockSize);
+  for (size_t i = block * kBlockSize; i < end_index; ++i) {
+    p = DecodeElement(p, &element);
+    int comparison = StringRef(element).compare(s);
+    if (comparison == 0) {
+      return i;
+    } else if (comparison > 0) {
+      break;
+    }
+  }
+  return npos;
+}
+
+void
+StringArray::Append(const char *data, size_t length) {
+  if (front_coded_) {
+    Error("StringArray::Append: error: cannot append to a front-coded array");
+  }
+  if (buffer_ == nullptr) {
+    buffer_.reset(new Buffer());
+    buffer_->offsets.push_back(0);
+  }
+  StringRef element(data, length);
+  if (sorted_ && size_ > 0 && element < (*this)[size_ - 1]) {
+    sorted_ = false;
+  }
+  vector<char> &chars = buffer_->chars;
+  CheckOffset(chars.size() + length);
+  chars.insert(chars.end(), data, data + length);
+  buffer_->offsets.push_back(static_cast<uint32_t>(chars.size()));
+  ++size_;
+}
+
+void
+StringArray::ShrinkToFit() {
+  if (buffer_ != nullptr) {
+    buffer_->chars.shrink_to_fit();
+    buffer_->offsets.shrink_to_fit();
+  }
+}
+
+bool
+StringArray::FrontCode() {
+  if (front_coded_ || !sorted_) {
+    return front_coded_;
+  }
+  shared_ptr<Buffer> coded(new Buffer());
+  for (size_t i = 0; i < size_; ++i) {
+    StringRef element = (*this)[i];
+    size_t prefix_length = 0;
+    if (i % kBlockSize == 0) {
+      CheckOffset(coded->chars.size());
+      coded->offsets.push_back(static_cast<uint32_t>(coded->chars.size()));
+    } else {
+      StringRef previous = (*this)[i - 1];
+      size_t max_length = std::min(previous.size(), element.size());
+      while (prefix_length < max_length &&
+             previous[prefix_length] == element[prefix_length]) {
+        ++prefix_length;
+      }
+    }
+    WriteVarint(prefix_length, &coded->chars);
+    WriteVarint(element.size() - prefix_length, &coded->chars);
+    coded->chars.insert(coded->chars.end(), element.begin() + prefix_length,
+                        element.end());
+  }
+  coded->chars.shrink_to_fit();
+  coded->offsets.shrink_to_fit();
+  buffer_ = coded;
+  front_coded_ = true;
+  return true;
+}
+
+void
+StringArray::CheckOffset(size_t offset) {
+  if (offset > UINT32_MAX) {
+    Error("StringArray: error: buffer would exceed 4 GiB");
+  }
+}
+
+const char *
+StringArray::DecodeElement(const char *p, string *element) {
+  size_t prefix_length, suffix_length;
+  p = ReadVarint(ReadVarint(p, &prefix_length), &suffix_length);
+  element->resize(prefix_length);
+  element->append(p, suffix_length);
+  return p + suffix_length;
+}
+
+}  // namespace infact
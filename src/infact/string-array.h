@@ -0,0 +1,440 @@
+// Copyright 2014, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   * Redistributions of source code must retain the above copyright
+//     notice, this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above
+//     copyright notice, this list of conditions and the following disclaimer
+//     in the documentation and/or other materials provided with the
+//     distribution.
+//   * Neither the name of Google Inc. nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+//
+//
+//
+//
+/// \file
+/// Provides the \link infact::StringArray StringArray \endlink class, a
+/// compact, immutable array of strings, along with the specializations
+/// needed for string arrays to be the values of variables and
+/// \link infact::Factory Factory\endlink-constructible members.
+
+#ifndef INFACT_STRING_ARRAY_H_
+#define INFACT_STRING_ARRAY_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "environment.h"
+#include "error.h"
+#include "factory.h"
+#include "stream-tokenizer.h"
+
+namespace infact {
+
+using std::ostringstream;
+using std::shared_ptr;
+using std::string;
+using std::vector;
+
+/// A read-only view of a sequence of characters owned elsewhere, in the
+/// manner of C++17&rsquo;s <tt>std::string_view</tt>.  A view is only
+/// valid for as long as the characters it refers to.
+class StringRef {
+ public:
+  /// Constructs a view of the empty string.
+  StringRef() : data_(""), size_(0) { }
+
+  /// Constructs a view of the specified characters.
+  StringRef(const char *data, size_t size) : data_(data), size_(size) { }
+
+  /// Constructs a view of the characters of the specified string.
+  StringRef(const string &s) : data_(s.data()), size_(s.size()) { }
+
+  /// Returns a pointer to the first character of this view.
+  const char *data() const { return data_; }
+
+  /// Returns the number of characters in this view.
+  size_t size() const { return size_; }
+
+  /// Returns whether this view is empty.
+  bool empty() const { return size_ == 0; }
+
+  /// Returns the character at the specified offset.
+  char operator[](size_t i) const { return data_[i]; }
+
+  /// Returns a pointer to the first character of this view.
+  const char *begin() const { return data_; }
+
+  /// Returns a pointer just past the last character of this view.
+  const char *end() const { return data_ + size_; }
+
+  /// Returns a copy of the characters of this view.
+  string ToString() const { return string(data_, size_); }
+
+  /// Compares this view lexicographically, byte by byte, with the
+  /// specified one, returning a negative number, zero or a positive
+  /// number if this view is less than, equal to or greater than it.
+  int compare(const StringRef &other) const {
+    size_t length = size_ < other.size_ ? size_ : other.size_;
+    int result = length == 0 ? 0 : memcmp(data_, other.data_, length);
+    if (result != 0) {
+      return result;
+    }
+    return size_ < other.size_ ? -1 : (size_ > other.size_ ? 1 : 0);
+  }
+
+  bool operator==(const StringRef &other) const {
+    return size_ == other.size_ &&
+        (size_ == 0 || memcmp(data_, other.data_, size_) == 0);
+  }
+
+  bool operator!=(const StringRef &other) const { return !(*this == other); }
+
+  bool operator<(const StringRef &other) const { return compare(other) < 0; }
+
+ private:
+  const char *data_;
+  size_t size_;
+};
+
+/// An array of strings held in a single contiguous character buffer
+/// with an array of offsets, rather than as one <tt>std::string</tt>
+/// per element, which saves a heap allocation and string header per
+/// element and keeps neighboring elements adjacent in memory.  This
+/// makes it well suited to large vocabularies of short strings.
+///
+/// An array whose elements were appended in sorted order may
+/// additionally be front-coded via \link FrontCode \endlink: each
+/// element is then stored as the length of the prefix it shares with
+/// its predecessor followed by the rest of its characters, with every
+/// \link kBlockSize \endlink-th element stored in full so that lookups
+/// need only decode a single block.
+///
+/// As with \link infact::Tensor Tensor \endlink, copies share the same
+/// buffer, so an array should be treated as immutable once it has been
+/// built.  Offsets are 32-bit, limiting the buffer to 4&nbsp;GiB.
+class StringArray {
+ public:
+  /// The value returned by \link Find \endlink when no element matches.
+  static const size_t npos = static_cast<size_t>(-1);
+
+  /// The number of elements per block of a front-coded array.
+  static const size_t kBlockSize = 16;
+
+  /// An iterator over the elements of an array, each of which is
+  /// presented as a \link StringRef \endlink.  For an array that is not
+  /// front-coded, the view refers directly to the array&rsquo;s buffer;
+  /// otherwise, it refers to a copy held by the iterator and is only
+  /// valid until the iterator is next incremented.
+  class const_iterator {
+   public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef StringRef value_type;
+    typedef ptrdiff_t difference_type;
+    typedef const StringRef *pointer;
+    typedef StringRef reference;
+
+    /// Returns the current element.
+    StringRef operator*() const {
+      return array_->front_coded_ ? StringRef(element_) : (*array_)[index_];
+    }
+
+    /// Advances to the next element.
+    const_iterator &operator++() {
+      ++index_;
+      Load();
+      return *this;
+    }
+
+    bool operator==(const const_iterator &other) const {
+      return array_ == other.array_ && index_ == other.index_;
+    }
+
+    bool operator!=(const const_iterator &other) const {
+      return !(*this == other);
+    }
+
+   private:
+    friend class StringArray;
+
+    const_iterator(const StringArray *array, size_t index) :
+        array_(array), index_(index), next_(nullptr) {
+      Load();
+    }
+
+    /// Decodes the current element of a front-coded array.
+    void Load();
+
+    const StringArray *array_;
+    size_t index_;
+    const char *next_;
+    string element_;
+  };
+
+  /// Constructs an empty array.
+  StringArray() : size_(0), sorted_(true), front_coded_(false) { }
+
+  /// Returns the number of elements in this array.
+  size_t size() const { return size_; }
+
+  /// Returns whether this array is empty.
+  bool empty() const { return size_ == 0; }
+
+  /// Returns whether the elements of this array are in ascending,
+  /// bytewise order.
+  bool sorted() const { return sorted_; }
+
+  /// Returns whether this array is front-coded.
+  bool front_coded() const { return front_coded_; }
+
+  /// Returns the number of bytes allocated for the buffer of this
+  /// array, including its offsets.
+  size_t capacity_bytes() const {
+    return buffer_ == nullptr ? 0 : sizeof(Buffer) +
+        buffer_->chars.capacity() +
+        buffer_->offsets.capacity() * sizeof(uint32_t);
+  }
+
+  /// Returns an address identifying the buffer of this array, which is
+  /// shared by its copies, or <tt>nullptr</tt> if it has none.
+  const void *buffer() const { return buffer_.get(); }
+
+  /// Returns a view of the element at the specified index.  It is an
+  /// error to invoke this method on a front-coded array, whose elements
+  /// are not stored in full; use \link Get \endlink or iterate instead.
+  StringRef operator[](size_t i) const {
+    if (front_coded_) {
+      Error("StringArray: error: operator[] requires an array that is "
+            "not front-coded");
+    }
+    const vector<uint32_t> &offsets = buffer_->offsets;
+    return StringRef(buffer_->chars.data() + offsets[i],
+                     offsets[i + 1] - offsets[i]);
+  }
+
+  /// Returns a copy of the element at the specified index, which is
+  /// supported for all arrays.
+  string Get(size_t i) const;
+
+  /// Returns the index of the first element equal to the specified
+  /// string, or \link npos \endlink if there is none.  The search is
+  /// logarithmic for a sorted array and linear otherwise.
+  size_t Find(const StringRef &s) const;
+
+  /// Returns an iterator pointing to the first element of this array.
+  const_iterator begin() const { return const_iterator(this, 0); }
+
+  /// Returns an iterator pointing just past the last element of this
+  /// array.
+  const_iterator end() const { return const_iterator(this, size_); }
+
+  /// Appends a copy of the specified characters as a new element.  This
+  /// method is intended only for use while building an array, before it
+  /// is shared with any copies, and may not be invoked on a front-coded
+  /// array.
+  void Append(const char *data, size_t length);
+
+  /// Appends a copy of the specified string as a new element.
+  void Append(const StringRef &s) { Append(s.data(), s.size()); }
+
+  /// Releases any excess capacity of the buffer of this array.
+  void ShrinkToFit();
+
+  /// Front-codes this array, if its elements are sorted.
+  ///
+  /// \return whether this array is now front-coded
+  bool FrontCode();
+
+ private:
+  /// The characters of the elements and the offsets at which they
+  /// start.  An array that is not front-coded has one offset per
+  /// element, plus one for the end of the last; a front-coded array has
+  /// one per block.
+  struct Buffer {
+    vector<char> chars;
+    vector<uint32_t> offsets;
+  };
+
+  /// Checks that the specified buffer size fits in an offset.
+  static void CheckOffset(size_t offset);
+
+  /// Decodes the front-coded element starting at the specified
+  /// position, which shares a prefix with the specified previous
+  /// element, replacing the latter with the former.
+  ///
+  /// \return the position just past the decoded element
+  static const char *DecodeElement(const char *p, string *element);
+
+  size_t size_;
+  bool sorted_;
+  bool front_coded_;
+  shared_ptr<Buffer> buffer_;
+};
+
+/// A specialization so that a \link StringArray \endlink gets converted
+/// to the string <tt>"array<string>"</tt>.
+template <>
+class TypeName<StringArray> {
+ public:
+  string ToString() { return "array<string>"; }
+};
+
+/// A specialization of the ValueString class to support printing of
+/// string arrays using the same syntax as string vectors.
+template <>
+class ValueString<StringArray> {
+ public:
+  string ToString(const StringArray &value) const {
+    ostringstream oss;
+    oss << "{";
+    for (StringArray::const_iterator it = value.begin();
+         it != value.end(); ++it) {
+      if (it != value.begin()) {
+        oss << ", ";
+      }
+      oss << "\"";
+      oss.write((*it).data(), (*it).size());
+      oss << "\"";
+    }
+    oss << "}";
+    return oss.str();
+  }
+};
+
+/// A specialization of the MemorySize class for string arrays, whose
+/// buffers may be shared among copies.
+template <>
+class MemorySize<StringArray> {
+ public:
+  size_t HeapBytes(const StringArray &value, MemoryVisitor *visitor) const {
+    if (value.buffer() == nullptr || !visitor->Visit(value.buffer())) {
+      return 0;
+    }
+    return value.capacity_bytes();
+  }
+};
+
+/// A specialization of the ValueHash class for string arrays, which
+/// combines the hashes of their elements in order, and so agrees for
+/// arrays with the same elements whether or not they are front-coded.
+template <>
+class ValueHash<StringArray> {
+ public:
+  size_t Hash(const StringArray &value) const {
+    size_t hash = value.size();
+    for (StringArray::const_iterator it = value.begin();
+         it != value.end(); ++it) {
+      hash = HashCombine(hash, HashBytes((*it).data(), (*it).size()));
+    }
+    return hash;
+  }
+};
+
+/// A specialization to allow initialization of a string array from a
+/// brace-enclosed list of string literals, such as
+/// <tt>{"the", "of", "and"}</tt>.  As with tensors, elements must be
+/// literals rather than variable names, which lets them be appended
+/// directly to the array&rsquo;s buffer without consulting the
+/// environment.
+template <>
+class VarMap<StringArray> :
+      public VarMapImpl<StringArray, VarMap<StringArray> > {
+ public:
+  typedef VarMapImpl<StringArray, VarMap<StringArray> > Base;
+
+  /// Constructs a mapping from variables of a particular type to their values.
+  ///
+  /// \param name         the type name of the variables in this instance
+  /// \param env          the \link infact::Environment Environment \endlink
+  ///                     that contains this VarMap instance
+  /// \param is_primitive whether this instance contains primitive variables
+  VarMap(const string &name, Environment *env, bool is_primitive = true) :
+      Base(name, env, is_primitive) { }
+
+  /// Constructs an empty mapping for variables of the same type as the
+  /// specified instance.
+  ///
+  /// \param other the instance whose type name and primitiveness to copy
+  /// \param env   the \link infact::Environment Environment \endlink
+  ///              that contains this VarMap instance
+  VarMap(const VarMap &other, Environment *env) :
+      Base(other.Name(), env, other.IsPrimitive()) { }
+
+  virtual ~VarMap() { }
+
+  /// \copydoc VarMapBase::ReadAndSet
+  virtual void ReadAndSet(const string &varname, StreamTokenizer &st) {
+    if (Base::ReadAndSetFromExistingVariable(varname, st)) {
+      return;
+    }
+    if (st.Peek() != "{") {
+      ostringstream err_ss;
+      err_ss << "VarMap<" << Base::Name() << ">::ReadAndSet: "
+             << "error: expected '{' at stream position "
+             << st.PeekTokenStart() << " but found \"" << st.Peek() << "\"";
+      Error(err_ss.str());
+    }
+    // Consume open brace.
+    st.Next();
+
+    StringArray value;
+    while (st.Peek() != "}") {
+      if (st.PeekTokenType() != StreamTokenizer::STRING) {
+        ostringstream err_ss;
+        err_ss << "VarMap<" << Base::Name() << ">::ReadAndSet: "
+               << "error: expected string literal at stream position "
+               << st.PeekTokenStart() << " but found \"" << st.Peek()
+               << "\"";
+        Error(err_ss.str());
+      }
+      value.Append(st.Next());
+
+      // Each element must be followed by a comma or the final closing brace.
+      if (st.Peek() != ","  && st.Peek() != "}") {
+        ostringstream err_ss;
+        err_ss << "VarMap<" << Base::Name() << ">::ReadAndSet: "
+               << "error: expected ',' or '}' at stream position "
+               << st.PeekTokenStart() << " but found \"" << st.Peek() << "\"";
+        Error(err_ss.str());
+      }
+      // Read comma, if present.
+      if (st.Peek() == ",") {
+        st.Next();
+      }
+    }
+    // Consume close brace.
+    st.Next();
+
+    value.ShrinkToFit();
+    this->Set(varname, value);
+  }
+};
+
+}  // namespace infact
+
+#endif
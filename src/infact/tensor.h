@@ -0,0 +1,454 @@
+// Copyright 2014, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   * Redistributions of source code must retain the above copyright
+//     notice, this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above
+//     copyright notice, this list of conditions and the following disclaimer
+//     in the documentation and/or other materials provided with the
+//     distribution.
+//   * Neither the name of Google Inc. nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+//
+//
+/// \file
+/// Provides the \link infact::Tensor Tensor \endlink class, a dense,
+/// multi-dimensional array of numbers, along with the specializations
+/// needed for tensors to be the values of variables and
+/// \link infact::Factory Factory\endlink-constructible members.
+
+#ifndef INFACT_TENSOR_H_
+#define INFACT_TENSOR_H_
+
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "environment.h"
+#include "error.h"
+#include "external-array.h"
+#include "factory.h"
+#include "generators.h"
+#include "stream-init.h"
+#include "stream-tokenizer.h"
+
+namespace infact {
+
+using std::ostringstream;
+using std::shared_ptr;
+using std::string;
+using std::vector;
+
+/// A dense, row-major, multi-dimensional array of numbers.  The
+/// elements live in a single contiguous buffer aligned to \link
+/// kAlignment \endlink bytes, so that they may be handed directly to
+/// vectorized linear algebra code via \link data \endlink.
+///
+/// Copies of a tensor share the same buffer, which makes storing and
+/// retrieving tensors from an \link infact::Environment Environment
+/// \endlink cheap; a tensor should therefore be treated as immutable
+/// once it has been built.
+///
+/// \tparam T the element type, which must be a primitive numeric type
+template <typename T>
+class Tensor {
+ public:
+  /// The alignment, in bytes, of the buffer holding the elements.
+  static const size_t kAlignment = 64;
+
+  /// Constructs an empty, one-dimensional tensor.
+  Tensor() : shape_(1, 0), size_(0), capacity_(0) { }
+
+  /// Constructs a tensor around an existing buffer, such as one mapped
+  /// from a file by an \link infact::ExternalArray ExternalArray
+  /// \endlink, which the tensor shares rather than copies.  The buffer
+  /// is never written to: appending to such a tensor first copies it.
+  ///
+  /// \param data  the buffer holding the elements, in row-major order
+  /// \param shape the size of each dimension of the tensor
+  Tensor(const shared_ptr<T> &data, const vector<size_t> &shape) :
+      shape_(1, 0), size_(0), capacity_(0), data_(data) {
+    size_ = 1;
+    for (size_t i = 0; i < shape.size(); ++i) {
+      size_ *= shape[i];
+    }
+    capacity_ = size_;
+    set_shape(shape);
+  }
+
+  /// Returns the size of each dimension of this tensor.
+  const vector<size_t> &shape() const { return shape_; }
+
+  /// Returns the number of dimensions of this tensor.
+  size_t rank() const { return shape_.size(); }
+
+  /// Returns the total number of elements in this tensor.
+  size_t size() const { return size_; }
+
+  /// Returns the number of elements the buffer of this tensor can hold.
+  size_t capacity() const { return capacity_; }
+
+  /// Returns a pointer to the first element of this tensor, or
+  /// <tt>nullptr</tt> if it has no elements.
+  const T *data() const { return data_.get(); }
+
+  /// Returns the element at the specified row-major offset.
+  const T &operator[](size_t i) const { return data_.get()[i]; }
+
+  /// Returns a pointer to the first element of this tensor.
+  const T *begin() const { return data_.get(); }
+
+  /// Returns a pointer just past the last element of this tensor.
+  const T *end() const { return data_.get() + size_; }
+
+  /// Appends an element to the buffer of this tensor, growing it
+  /// geometrically as needed.  This method is intended only for use
+  /// while building a tensor, before it is shared with any copies.
+  void Append(T value) {
+    if (size_ == capacity_) {
+      Reserve(capacity_ == 0 ? 16 : 2 * capacity_);
+    }
+    data_.get()[size_++] = value;
+  }
+
+  /// Extends the buffer of this tensor by the specified number of
+  /// elements, returning a pointer to the first of them, which are
+  /// uninitialized.  Like \link Append \endlink, this method is intended
+  /// only for use while building a tensor.
+  T *Grow(size_t num_elements) {
+    Reserve(size_ + num_elements);
+    T *start = data_.get() + size_;
+    size_ += num_elements;
+    return start;
+  }
+
+  /// Ensures the buffer of this tensor can hold at least the specified
+  /// number of elements without reallocation.
+  void Reserve(size_t capacity) {
+    if (capacity <= capacity_) {
+      return;
+    }
+    void *buffer = nullptr;
+    if (posix_memalign(&buffer, kAlignment, capacity * sizeof(T)) != 0) {
+      Error("Tensor: error: could not allocate aligned buffer");
+    }
+    if (size_ > 0) {
+      memcpy(buffer, data_.get(), size_ * sizeof(T));
+    }
+    data_.reset(static_cast<T *>(buffer), free);
+    capacity_ = capacity;
+  }
+
+  /// Sets the shape of this tensor.  It is an error if the product of
+  /// the sizes of the dimensions does not equal \link size \endlink.
+  void set_shape(const vector<size_t> &shape) {
+    size_t product = 1;
+    for (size_t i = 0; i < shape.size(); ++i) {
+      product *= shape[i];
+    }
+    if (product != size_) {
+      ostringstream err_ss;
+      err_ss << "Tensor: error: shape with " << product << " elements "
+             << "does not match tensor with " << size_ << " elements";
+      Error(err_ss.str());
+    }
+    shape_ = shape;
+  }
+
+ private:
+  vector<size_t> shape_;
+  size_t size_;
+  size_t capacity_;
+  shared_ptr<T> data_;
+};
+
+/// A partial specialization so that an object of type
+/// <tt>Tensor\<T\></tt> gets converted to the string <tt>"tensor<"</tt>
+/// followed by the type name of <tt>T</tt> followed by <tt>">"</tt>; for
+/// example, <tt>Tensor\<double\></tt> converts to <tt>"tensor<double>"</tt>.
+template <typename T>
+class TypeName<Tensor<T> > {
+ public:
+  string ToString() {
+    return "tensor<" + TypeName<T>().ToString() + ">";
+  }
+};
+
+/// A partial specialization of the ValueString class to support
+/// printing of tensors as nested brace-enclosed lists.
+///
+/// \tparam T the element type of a tensor to be printed out to an ostream
+template <typename T>
+class ValueString<Tensor<T> > {
+ public:
+  string ToString(const Tensor<T> &value) const {
+    ostringstream oss;
+    size_t offset = 0;
+    Print(value, 0, &offset, oss);
+    return oss.str();
+  }
+ private:
+  void Print(const Tensor<T> &value, size_t dim, size_t *offset,
+             ostringstream &oss) const {
+    ValueString<T> value_string;
+    oss << "{";
+    for (size_t i = 0; i < value.shape()[dim]; ++i) {
+      if (i > 0) {
+        oss << ", ";
+      }
+      if (dim + 1 < value.rank()) {
+        Print(value, dim + 1, offset, oss);
+      } else {
+        oss << value_string.ToString(value[(*offset)++]);
+      }
+    }
+    oss << "}";
+  }
+};
+
+/// A partial specialization of the MemorySize class for tensors, whose
+/// buffers may be shared among copies or mapped from a file.
+///
+/// \tparam T the element type of the tensor
+template <typename T>
+class MemorySize<Tensor<T> > {
+ public:
+  size_t HeapBytes(const Tensor<T> &value, MemoryVisitor *visitor) const {
+    size_t bytes = value.shape().capacity() * sizeof(size_t);
+    if (value.data() != nullptr && visitor->Visit(value.data())) {
+      bytes += value.capacity() * sizeof(T);
+    }
+    return bytes;
+  }
+};
+
+/// A partial specialization of the ValueHash class for tensors, which
+/// hashes their shape and the bytes of their elements.
+///
+/// \tparam T the element type of the tensor
+template <typename T>
+class ValueHash<Tensor<T> > {
+ public:
+  size_t Hash(const Tensor<T> &value) const {
+    ValueHash<vector<size_t> > shape_hash;
+    return HashCombine(shape_hash.Hash(value.shape()),
+                       HashBytes(value.data(), value.size() * sizeof(T)));
+  }
+};
+
+/// A partial specialization to allow initialization of a tensor from
+/// nested brace-enclosed lists of numeric literals, such as
+/// <tt>{{1, 2, 3}, {4, 5, 6}}</tt> for a tensor of shape 2&times;3.
+/// Unlike vectors, elements must be literals rather than variable
+/// names, which lets them be parsed directly into the tensor&rsquo;s
+/// buffer without consulting the environment.  A one-dimensional tensor
+/// may also be initialized by a <tt>range</tt> or <tt>linspace</tt>
+/// generator expression, and a tensor of any shape by <tt>file</tt>.
+///
+/// \tparam T the element type of tensors stored in this variable map
+template <typename T>
+class VarMap<Tensor<T> > : public VarMapImpl<Tensor<T>, VarMap<Tensor<T> > > {
+ public:
+  typedef VarMapImpl<Tensor<T>, VarMap<Tensor<T> > > Base;
+
+  /// Constructs a mapping from variables of a particular type to their values.
+  ///
+  /// \param name         the type name of the variables in this instance
+  /// \param env          the \link infact::Environment Environment \endlink
+  ///                     that contains this VarMap instance
+  /// \param is_primitive whether this instance contains primitive variables
+  VarMap(const string &name, Environment *env, bool is_primitive = true) :
+      Base(name, env, is_primitive) { }
+
+  /// Constructs an empty mapping for variables of the same type as the
+  /// specified instance.
+  ///
+  /// \param other the instance whose type name and primitiveness to copy
+  /// \param env   the \link infact::Environment Environment \endlink
+  ///              that contains this VarMap instance
+  VarMap(const VarMap &other, Environment *env) :
+      Base(other.Name(), env, other.IsPrimitive()) { }
+
+  virtual ~VarMap() { }
+
+  /// \copydoc VarMapBase::ReadAndSet
+  virtual void ReadAndSet(const string &varname, StreamTokenizer &st) {
+    if (Base::ReadAndSetFromExistingVariable(varname, st)) {
+      return;
+    }
+    string generator;
+    if (PeekGenerator(st, &generator)) {
+      if (generator == "file") {
+        ReadFile(st, varname);
+        return;
+      }
+      if (generator == "range" || generator == "linspace") {
+        ReadSequence(st, varname, generator);
+        return;
+      }
+      ostringstream err_ss;
+      err_ss << "VarMap<" << Base::Name() << ">::ReadAndSet: error: "
+             << "generator " << generator << " at stream position "
+             << st.PeekTokenStart() << " cannot initialize a tensor";
+      Error(err_ss.str());
+    }
+    Tensor<T> value;
+    vector<size_t> shape;
+    size_t leaf_dim = kUnknown;
+    ReadDimension(varname, st, 0, &shape, &leaf_dim, &value);
+    value.set_shape(shape);
+    this->Set(varname, value);
+  }
+
+ private:
+  /// Reads a <tt>range(...)</tt> or <tt>linspace(...)</tt> generator
+  /// expression into a one-dimensional tensor.
+  void ReadSequence(StreamTokenizer &st, const string &varname,
+                    const string &generator) {
+    // Consume generator name and open parenthesis.
+    st.Next();
+    st.Next();
+    vector<T> elements;
+    if (generator == "range") {
+      SequenceGenerator<T>::Range(st, &elements);
+    } else {
+      SequenceGenerator<T>::Linspace(st, &elements);
+    }
+    Tensor<T> value;
+    if (!elements.empty()) {
+      memcpy(value.Grow(elements.size()), elements.data(),
+             elements.size() * sizeof(T));
+    }
+    value.set_shape(vector<size_t>(1, elements.size()));
+    this->Set(varname, value);
+  }
+
+  /// Reads an external array reference, <tt>file(...)</tt>.  The tensor
+  /// uses the mapped file in place when its elements are of native byte
+  /// order and aligned to \link Tensor::kAlignment kAlignment \endlink
+  /// bytes, as promised by \link Tensor::data data\endlink, and
+  /// otherwise a copy.
+  void ReadFile(StreamTokenizer &st, const string &varname) {
+    // Consume generator name and open parenthesis.
+    st.Next();
+    st.Next();
+    ExternalArray array;
+    array.Read(st, sizeof(T), NpyDescr<T>::Value());
+    if (array.size() > 0 && array.InPlace(Tensor<T>::kAlignment)) {
+      // Share ownership of the mapping, but point to the elements.
+      shared_ptr<T> data(array.mapping(),
+                         reinterpret_cast<T *>(
+                             const_cast<uint8_t *>(array.data())));
+      this->Set(varname, Tensor<T>(data, array.shape()));
+    } else {
+      Tensor<T> value;
+      array.CopyTo(value.Grow(array.size()), sizeof(T));
+      value.set_shape(array.shape());
+      this->Set(varname, value);
+    }
+  }
+
+  /// Marks a dimension whose size or depth has not yet been determined.
+  static const size_t kUnknown = static_cast<size_t>(-1);
+
+  /// Reads the brace-enclosed list for the specified dimension,
+  /// appending its elements to the specified tensor.  The first list
+  /// read at each depth determines the size of that dimension, and the
+  /// first literal read determines the depth at which literals appear;
+  /// all other lists must agree with both.
+  void ReadDimension(const string &varname, StreamTokenizer &st, size_t dim,
+                     vector<size_t> *shape, size_t *leaf_dim,
+                     Tensor<T> *value) {
+    if (st.Peek() != "{") {
+      ostringstream err_ss;
+      err_ss << "VarMap<" << Base::Name() << ">::ReadAndSet: "
+             << "error: expected '{' at stream position "
+             << st.PeekTokenStart() << " but found \"" << st.Peek() << "\"";
+      Error(err_ss.str());
+    }
+    // Consume open brace.
+    st.Next();
+    if (shape->size() == dim) {
+      shape->push_back(kUnknown);
+    }
+
+    size_t length = 0;
+    while (st.Peek() != "}") {
+      if (st.Peek() == "{") {
+        if (*leaf_dim != kUnknown && *leaf_dim <= dim) {
+          RaggedError(varname, st);
+        }
+        ReadDimension(varname, st, dim + 1, shape, leaf_dim, value);
+      } else {
+        if (*leaf_dim == kUnknown) {
+          *leaf_dim = dim;
+        }
+        if (*leaf_dim != dim) {
+          RaggedError(varname, st);
+        }
+        T element = T();
+        Initializer<T> initializer(&element);
+        initializer.Init(st);
+        value->Append(element);
+      }
+      ++length;
+
+      // Each element must be followed by a comma or the final closing brace.
+      if (st.Peek() != ","  && st.Peek() != "}") {
+        ostringstream err_ss;
+        err_ss << "VarMap<" << Base::Name() << ">::ReadAndSet: "
+               << "error: expected ',' or '}' at stream position "
+               << st.PeekTokenStart() << " but found \"" << st.Peek() << "\"";
+        Error(err_ss.str());
+      }
+      // Read comma, if present.
+      if (st.Peek() == ",") {
+        st.Next();
+      }
+    }
+    // Consume close brace.
+    st.Next();
+
+    if ((*shape)[dim] == kUnknown) {
+      (*shape)[dim] = length;
+    } else if ((*shape)[dim] != length) {
+      RaggedError(varname, st);
+    }
+  }
+
+  void RaggedError(const string &varname, StreamTokenizer &st) {
+    ostringstream err_ss;
+    err_ss << "VarMap<" << Base::Name() << ">::ReadAndSet: "
+           << "error: tensor " << varname << " is not rectangular "
+           << "(stream position " << st.PeekPrevTokenStart() << ")";
+    Error(err_ss.str());
+  }
+};
+
+template <typename T>
+const size_t VarMap<Tensor<T> >::kUnknown;
+
+}  // namespace infact
+
+#endif
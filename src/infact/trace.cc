@@ -0,0 +1,165 @@
+// Copyright 2014, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   * Redistributions of source code must retain the above copyright
+//     notice, this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above
+//     copyright notice, this list of conditions and the following disclaimer
+//     in the documentation and/or other materials provided with the
+//     distribution.
+//   * Neither the name of Google Inc. nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+//
+//
+/// \file
+/// Implementation of the \link infact::Tracer Tracer \endlink class.
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "trace.h"
+
+namespace infact {
+
+using std::lock_guard;
+using std::mutex;
+using std::shared_ptr;
+using std::vector;
+
+std::atomic<bool> Tracer::enabled_(false);
+
+namespace {
+
+/// A completed span.
+struct TraceEvent {
+  const char *category;
+  string name;
+  const char *arg_name;
+  string arg_value;
+  int64_t start_ns;
+  int64_t end_ns;
+};
+
+/// The spans recorded by a single thread.  The mutex is only ever
+/// contended while the buffers are being written out or cleared.
+struct TraceBuffer {
+  mutex buffer_mutex;
+  int tid;
+  vector<TraceEvent> events;
+};
+
+/// All buffers ever created, so that they may be written out after
+/// their threads have exited.
+mutex buffers_mutex;
+
+vector<shared_ptr<TraceBuffer> > &buffers() {
+  static vector<shared_ptr<TraceBuffer> > all_buffers;
+  return all_buffers;
+}
+
+TraceBuffer *ThreadBuffer() {
+  static thread_local TraceBuffer *buffer = nullptr;
+  if (buffer == nullptr) {
+    shared_ptr<TraceBuffer> new_buffer(new TraceBuffer());
+    lock_guard<mutex> lock(buffers_mutex);
+    new_buffer->tid = buffers().size() + 1;
+    buffers().push_back(new_buffer);
+    buffer = new_buffer.get();
+  }
+  return buffer;
+}
+
+/// Writes the specified string as a JSON string literal.
+void WriteJsonString(ostream &os, const string &s) {
+  os << '"';
+  for (size_t i = 0; i < s.size(); ++i) {
+    char c = s[i];
+    if (c == '"' || c == '\\') {
+      os << '\\' << c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      os << ' ';
+    } else {
+      os << c;
+    }
+  }
+  os << '"';
+}
+
+}  // namespace
+
+void
+Tracer::Record(const char *category, const string &name,
+               const char *arg_name, const string &arg_value,
+               int64_t start_ns, int64_t end_ns) {
+  TraceBuffer *buffer = ThreadBuffer();
+  TraceEvent event = {
+    category, name, arg_name, arg_value, start_ns, end_ns
+  };
+  lock_guard<mutex> lock(buffer->buffer_mutex);
+  buffer->events.push_back(event);
+}
+
+void
+Tracer::Write(ostream &os) {
+  lock_guard<mutex> lock(buffers_mutex);
+  // Timestamps are in microseconds; keep nanosecond resolution.
+  std::ios_base::fmtflags flags = os.flags();
+  std::streamsize precision = os.precision();
+  os.setf(std::ios_base::fixed, std::ios_base::floatfield);
+  os.precision(3);
+  os << "{\"traceEvents\": [";
+  bool first = true;
+  for (size_t i = 0; i < buffers().size(); ++i) {
+    TraceBuffer *buffer = buffers()[i].get();
+    lock_guard<mutex> buffer_lock(buffer->buffer_mutex);
+    for (size_t j = 0; j < buffer->events.size(); ++j) {
+      const TraceEvent &event = buffer->events[j];
+      os << (first ? "\n  " : ",\n  ") << "{\"name\": ";
+      WriteJsonString(os, event.name);
+      os << ", \"cat\": \"" << event.category << "\", \"ph\": \"X\""
+         << ", \"ts\": " << event.start_ns / 1000.0
+         << ", \"dur\": " << (event.end_ns - event.start_ns) / 1000.0
+         << ", \"pid\": 1, \"tid\": " << buffer->tid;
+      if (event.arg_name != nullptr) {
+        os << ", \"args\": {\"" << event.arg_name << "\": ";
+        WriteJsonString(os, event.arg_value);
+        os << "}";
+      }
+      os << "}";
+      first = false;
+    }
+  }
+  os << "\n]}" << std::endl;
+  os.flags(flags);
+  os.precision(precision);
+}
+
+void
+Tracer::Clear() {
+  lock_guard<mutex> lock(buffers_mutex);
+  for (size_t i = 0; i < buffers().size(); ++i) {
+    lock_guard<mutex> buffer_lock(buffers()[i]->buffer_mutex);
+    buffers()[i]->events.clear();
+  }
+}
+
+}  // namespace infact
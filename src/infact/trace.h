@@ -0,0 +1,154 @@
+// Copyright 2014, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   * Redistributions of source code must retain the above copyright
+//     notice, this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above
+//     copyright notice, this list of conditions and the following disclaimer
+//     in the documentation and/or other materials provided with the
+//     distribution.
+//   * Neither the name of Google Inc. nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+//
+//
+/// \file
+/// Provides the \link infact::Tracer Tracer \endlink, which records a
+/// timeline of scoped spans covering the evaluation of specifications
+/// and writes it in the Chrome trace-event format, for viewing with
+/// <tt>chrome://tracing</tt> or Perfetto.
+
+#ifndef INFACT_TRACE_H_
+#define INFACT_TRACE_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+namespace infact {
+
+using std::ostream;
+using std::string;
+
+/// The process-wide switch and sink for trace spans.  Tracing is
+/// disabled by default, in which case a \link TraceSpan \endlink costs
+/// a single relaxed atomic load.  When enabled, each thread appends
+/// completed spans to its own buffer.
+class Tracer {
+ public:
+  /// Starts recording spans.
+  static void Enable() { enabled_.store(true, std::memory_order_relaxed); }
+
+  /// Stops recording spans.  Spans already recorded are kept.
+  static void Disable() { enabled_.store(false, std::memory_order_relaxed); }
+
+  /// Returns whether spans are currently being recorded.
+  static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+
+  /// Writes all spans recorded so far, across all threads, as a Chrome
+  /// trace-event JSON object.
+  static void Write(ostream &os);
+
+  /// Discards all spans recorded so far.
+  static void Clear();
+
+  /// Returns the current time on the clock used for spans, in
+  /// nanoseconds.
+  static int64_t Now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+ private:
+  friend class TraceSpan;
+
+  /// Appends a completed span to the current thread&rsquo;s buffer.
+  static void Record(const char *category, const string &name,
+                     const char *arg_name, const string &arg_value,
+                     int64_t start_ns, int64_t end_ns);
+
+  static std::atomic<bool> enabled_;
+};
+
+/// Records a span covering the lifetime of an instance, provided
+/// tracing was enabled at construction.  For example:
+/// \code
+/// TraceSpan span("create", type);
+/// span.SetArg("member", member_name);
+/// \endcode
+/// The strings passed to this class are only copied when tracing is
+/// enabled.
+class TraceSpan {
+ public:
+  /// Starts a span in the specified category with the specified name.
+  /// The category must be a string literal or otherwise outlive all
+  /// recorded spans.
+  TraceSpan(const char *category, const string &name = string()) :
+      active_(Tracer::enabled()), category_(category), arg_name_(nullptr) {
+    if (active_) {
+      name_ = name;
+      start_ns_ = Tracer::Now();
+    }
+  }
+
+  /// Ends this span and records it, unless it was discarded.
+  ~TraceSpan() {
+    if (active_) {
+      Tracer::Record(category_, name_, arg_name_, arg_value_, start_ns_,
+                     Tracer::Now());
+    }
+  }
+
+  /// Sets the name of this span, for names not known at construction.
+  void SetName(const string &name) {
+    if (active_) {
+      name_ = name;
+    }
+  }
+
+  /// Attaches an argument to this span, replacing any previous one.
+  /// The argument name must be a string literal.
+  void SetArg(const char *arg_name, const string &arg_value) {
+    if (active_) {
+      arg_name_ = arg_name;
+      arg_value_ = arg_value;
+    }
+  }
+
+  /// Prevents this span from being recorded.
+  void Discard() { active_ = false; }
+
+  /// Returns whether this span will be recorded.
+  bool active() const { return active_; }
+
+ private:
+  bool active_;
+  const char *category_;
+  const char *arg_name_;
+  string name_;
+  string arg_value_;
+  int64_t start_ns_;
+};
+
+}  // namespace infact
+
+#endif
@@ -0,0 +1,168 @@
+// Copyright 2014, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   * Redistributions of source code must retain the above copyright
+//     notice, this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above
+//     copyright notice, this list of conditions and the following disclaimer
+//     in the documentation and/or other materials provided with the
+//     distribution.
+//   * Neither the name of Google Inc. nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+//
+//
+/// \file
+/// Provides the \link infact::ValueHash ValueHash \endlink class
+/// template, which computes a hash of the content of a variable&rsquo;s
+/// value, so that a change to the value can be detected by comparing
+/// hashes rather than by keeping a copy of the value and comparing it
+/// element by element.
+
+#ifndef INFACT_VALUE_HASH_H_
+#define INFACT_VALUE_HASH_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "bytes.h"
+
+namespace infact {
+
+using std::shared_ptr;
+using std::string;
+using std::unordered_map;
+using std::vector;
+
+/// Returns the FNV-1a hash of the specified sequence of bytes.
+inline size_t
+HashBytes(const void *data, size_t size) {
+  const uint8_t *bytes = static_cast<const uint8_t *>(data);
+  uint64_t hash = 14695981039346656037ULL;
+  for (size_t i = 0; i < size; ++i) {
+    hash = (hash ^ bytes[i]) * 1099511628211ULL;
+  }
+  return static_cast<size_t>(hash);
+}
+
+/// Returns the combination of the specified hash with the hash of the
+/// next item of an ordered sequence.
+inline size_t
+HashCombine(size_t hash, size_t next) {
+  return hash ^ (next + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2));
+}
+
+/// A template class that computes a hash of the content of a value.
+/// The basic implementation works for arithmetic types and strings,
+/// using <tt>std::hash</tt>.
+///
+/// \tparam T      the type of value to hash
+/// \tparam Enable a parameter allowing whole families of types, such as
+///                all enumerated types, to be handled by a single partial
+///                specialization
+template <typename T, typename Enable = void>
+class ValueHash {
+ public:
+  size_t Hash(const T &value) const {
+    return std::hash<T>()(value);
+  }
+};
+
+/// A partial specialization of the ValueHash class for enumerated
+/// types, which hashes the underlying integral value.
+template <typename E>
+class ValueHash<E, typename std::enable_if<std::is_enum<E>::value>::type> {
+ public:
+  size_t Hash(const E &value) const {
+    typedef typename std::underlying_type<E>::type Underlying;
+    return std::hash<Underlying>()(static_cast<Underlying>(value));
+  }
+};
+
+/// A specialization of the ValueHash class for binary blobs.
+template<>
+class ValueHash<Bytes> {
+ public:
+  size_t Hash(const Bytes &value) const {
+    return HashBytes(value.data(), value.size());
+  }
+};
+
+/// A partial specialization of the ValueHash class for objects, which
+/// hashes the identity of the object rather than its content, so that
+/// constructing a new object, even an identical one, is a change.
+///
+/// \tparam T the type of object
+template <typename T>
+class ValueHash<shared_ptr<T> > {
+ public:
+  size_t Hash(const shared_ptr<T> &value) const {
+    return std::hash<T *>()(value.get());
+  }
+};
+
+/// A partial specialization of the ValueHash class for vectors, which
+/// combines the hashes of their elements in order.
+///
+/// \tparam T the element type of the vector
+template <typename T>
+class ValueHash<vector<T> > {
+ public:
+  size_t Hash(const vector<T> &value) const {
+    ValueHash<T> element_hash;
+    size_t hash = value.size();
+    for (typename vector<T>::const_iterator it = value.begin();
+         it != value.end(); ++it) {
+      hash = HashCombine(hash, element_hash.Hash(*it));
+    }
+    return hash;
+  }
+};
+
+/// A partial specialization of the ValueHash class for maps from
+/// strings to values.  Since the iteration order of a map is
+/// unspecified, the hashes of its entries are combined by addition.
+///
+/// \tparam T the type of values in the map
+template <typename T>
+class ValueHash<unordered_map<string, T> > {
+ public:
+  size_t Hash(const unordered_map<string, T> &value) const {
+    ValueHash<string> key_hash;
+    ValueHash<T> value_hash;
+    size_t hash = value.size();
+    for (typename unordered_map<string, T>::const_iterator it = value.begin();
+         it != value.end(); ++it) {
+      hash += HashCombine(key_hash.Hash(it->first),
+                          value_hash.Hash(it->second));
+    }
+    return hash;
+  }
+};
+
+}  // namespace infact
+
+#endif
@@ -0,0 +1,269 @@
+// Copyright 2014, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//   * Redistributions of source code must retain the above copyright
+//     notice, this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above
+//     copyright notice, this list of conditions and the following disclaimer
+//     in the documentation and/or other materials provided with the
+//     distribution.
+//   * Neither the name of Google Inc. nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// -----------------------------------------------------------------------------
+//
+//
+/// \file
+/// Provides support for registering domain value types, such as
+/// durations or byte sizes, so that they may be the types of variables
+/// and of members of \link infact::Factory Factory\endlink-constructible
+/// objects, and so that their literals are decoded into native values
+/// once, when a specification is read, rather than kept as strings and
+/// re-parsed by each object.
+
+#ifndef INFACT_VALUE_TYPE_H_
+#define INFACT_VALUE_TYPE_H_
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "environment.h"
+#include "error.h"
+#include "factory.h"
+#include "stream-init.h"
+#include "stream-tokenizer.h"
+
+namespace infact {
+
+using std::ostringstream;
+using std::string;
+using std::vector;
+
+/// A function that returns whether a token of the specified type and
+/// text is a literal of a particular value type, so that the type of a
+/// variable initialized by such a literal may be inferred.
+typedef bool (*LiteralRecognizer)(StreamTokenizer::TokenType token_type,
+                                  const string &token);
+
+/// An interface for all \link ValueType \endlink instances, allowing an
+/// \link infact::Environment Environment \endlink to create variable
+/// maps for every registered value type and to recognize its literals.
+class ValueTypeBase {
+ public:
+  virtual ~ValueTypeBase() { }
+  /// Returns the name of the value type, as it appears in type
+  /// specifiers.
+  virtual const string BaseName() const = 0;
+
+  /// Returns whether the specified token is a literal of this value
+  /// type.  A value type without a literal recognizer recognizes no
+  /// tokens, so that variables of that type require an explicit type
+  /// specifier.
+  virtual bool Recognizes(StreamTokenizer::TokenType token_type,
+                          const string &token) const = 0;
+
+  virtual VarMapBase *CreateVarMap(Environment *env) const = 0;
+
+  virtual VarMapBase *CreateVectorVarMap(Environment *env) const = 0;
+};
+
+/// A class to hold all \link ValueType \endlink instances that have
+/// been registered.
+class ValueTypeContainer {
+ public:
+  typedef vector<ValueTypeBase *>::iterator iterator;
+
+  /// Adds the specified value type to this container.
+  static void Add(ValueTypeBase *value_type) {
+    value_types()->push_back(value_type);
+  }
+
+  /// Clears this container of value types.
+  static void Clear() {
+    if (value_types_ != nullptr) {
+      for (iterator it = value_types_->begin(); it != value_types_->end();
+           ++it) {
+        delete *it;
+      }
+      delete value_types_;
+      value_types_ = nullptr;
+    }
+  }
+
+  // Provide two methods to iterate over the ValueTypeBase instances
+  // held by this ValueTypeContainer.
+  static iterator begin() { return value_types()->begin(); }
+  static iterator end() { return value_types()->end(); }
+
+ private:
+  static vector<ValueTypeBase *> *value_types() {
+    if (value_types_ == nullptr) {
+      value_types_ = new vector<ValueTypeBase *>();
+    }
+    return value_types_;
+  }
+
+  static vector<ValueTypeBase *> *value_types_;
+};
+
+/// Makes the value type <tt>T</tt> available to every \link
+/// infact::Environment Environment \endlink, under the name given by
+/// its \link TypeName \endlink specialization.  Besides that
+/// specialization, a value type provides an \link Initializer \endlink
+/// specialization to decode its literals, most easily by deriving from
+/// \link LiteralInitializer \endlink, a \link ValueString \endlink
+/// specialization to print them and, unless <tt>std::hash</tt> supports
+/// the type, a \link ValueHash \endlink specialization so that changes
+/// to variables of the type may be detected.  A registered type lacking
+/// any of these fails to compile.  For example:
+/// \code
+/// // In a header file:
+/// struct Duration { int64_t nanos; };
+///
+/// template <> class TypeName<Duration> {
+///  public:
+///   string ToString() { return "duration"; }
+/// };
+///
+/// template <> class Initializer<Duration> :
+///       public LiteralInitializer<Duration> {
+///  public:
+///   Initializer(Duration *member) : LiteralInitializer<Duration>(member) { }
+///   virtual bool Decode(const string &literal, Duration *value) const;
+/// };
+///
+/// template <> class ValueString<Duration> { ... };
+///
+/// template <> class ValueHash<Duration> {
+///  public:
+///   size_t Hash(const Duration &value) const {
+///     return std::hash<int64_t>()(value.nanos);
+///   }
+/// };
+///
+/// // In an implementation file:
+/// REGISTER_VALUE_TYPE_WITH_RECOGNIZER(Duration, IsDurationLiteral)
+/// \endcode
+/// after which a variable may be initialized as, say,
+/// <tt>duration timeout = 30s;</tt> or simply <tt>timeout = 30s;</tt>.
+///
+/// \tparam T the value type
+template <typename T>
+class ValueType : public ValueTypeBase {
+ public:
+  /// Constructs a new instance.
+  ///
+  /// \param recognizer the function recognizing literals of this type,
+  ///                   or <tt>nullptr</tt> if there is none
+  explicit ValueType(LiteralRecognizer recognizer) :
+      recognizer_(recognizer) { }
+
+  /// \copydoc ValueTypeBase::BaseName
+  virtual const string BaseName() const {
+    return TypeName<T>().ToString();
+  }
+
+  /// \copydoc ValueTypeBase::Recognizes
+  virtual bool Recognizes(StreamTokenizer::TokenType token_type,
+                          const string &token) const {
+    return recognizer_ != nullptr && recognizer_(token_type, token);
+  }
+
+  virtual VarMapBase *CreateVarMap(Environment *env) const {
+    return new VarMap<T>(BaseName(), env);
+  }
+
+  virtual VarMapBase *CreateVectorVarMap(Environment *env) const {
+    return new VarMap<vector<T> >(BaseName() + "[]", BaseName(), env);
+  }
+
+  /// The method used by the \link REGISTER_VALUE_TYPE \endlink and
+  /// \link REGISTER_VALUE_TYPE_WITH_RECOGNIZER \endlink macros to
+  /// register this value type.
+  ///
+  /// \param recognizer the function recognizing literals of this type,
+  ///                   or <tt>nullptr</tt> if there is none
+  /// \return whether this type was registered
+  static bool Register(LiteralRecognizer recognizer) {
+    ValueTypeContainer::Add(new ValueType<T>(recognizer));
+    return true;
+  }
+
+ private:
+  LiteralRecognizer recognizer_;
+};
+
+/// A base class for the \link Initializer \endlink specialization of a
+/// value type whose literals are single tokens, such as <tt>30s</tt>
+/// or <tt>"10.0.0.0/8"</tt>.  It decodes the next token directly into
+/// the member being initialized, and reports a malformed literal along
+/// with its position in the specification.
+///
+/// \tparam T the value type
+template <typename T>
+class LiteralInitializer : public StreamInitializer {
+ public:
+  LiteralInitializer(T *member) : member_(member) { }
+  virtual ~LiteralInitializer() { }
+
+  /// Decodes the specified literal, which is the text of a number or
+  /// identifier token or the contents of a string literal.
+  ///
+  /// \param      literal the literal to decode
+  /// \param[out] value   the decoded value
+  /// \return whether the literal was well formed
+  virtual bool Decode(const string &literal, T *value) const = 0;
+
+  virtual void Init(StreamTokenizer &st, Environment *env = nullptr) {
+    StreamTokenizer::TokenType token_type = st.PeekTokenType();
+    size_t next_tok_start = st.PeekTokenStart();
+    string next_tok = st.Next();
+    bool is_literal = token_type == StreamTokenizer::NUMBER ||
+        token_type == StreamTokenizer::IDENTIFIER ||
+        token_type == StreamTokenizer::STRING;
+    if (!is_literal || !Decode(next_tok, member_)) {
+      ostringstream err_ss;
+      err_ss << "Initializer<" << TypeName<T>().ToString() << ">: malformed "
+             << "literal \"" << next_tok << "\" (token type: "
+             << StreamTokenizer::TypeName(token_type) << ") at stream "
+             << "position " << next_tok_start;
+      Error(err_ss.str());
+    }
+  }
+ private:
+  T *member_;
+};
+
+/// Registers the value type <tt>TYPE</tt>, whose variables must be
+/// declared with an explicit type specifier.
+#define REGISTER_VALUE_TYPE(TYPE) \
+  REGISTER_VALUE_TYPE_WITH_RECOGNIZER(TYPE,nullptr)
+
+/// Registers the value type <tt>TYPE</tt>, whose literals are
+/// recognized by the \link infact::LiteralRecognizer LiteralRecognizer
+/// \endlink <tt>RECOGNIZER</tt>, so that the type of a variable
+/// initialized by one may be inferred.
+#define REGISTER_VALUE_TYPE_WITH_RECOGNIZER(TYPE,RECOGNIZER) \
+  static const bool TYPE ## _value_type_registered = \
+      infact::ValueType<TYPE>::Register(RECOGNIZER);
+
+}  // namespace infact
+
+#endif